@@ -58,7 +58,26 @@ AS_IF([test "$enable_resiliency" = "yes"],[
     ])
 
   AC_DEFINE([NANOS_RESILIENCY_ENABLED],[],[Indicates whether resiliency features should be used or not.])
-  resiliency_flags=-fnon-call-exceptions -march=native
+  resiliency_flags=-fnon-call-exceptions
+
+  # CRC-32C engine: ISA-specific kernels are selected at runtime, so we only
+  # need to know whether the compiler is able to build the AVX-512 one.
+  AC_MSG_CHECKING([if the compiler supports VPCLMULQDQ intrinsics])
+  AC_LANG_PUSH(C++)
+  AC_COMPILE_IFELSE(
+      [AC_LANG_PROGRAM(
+          [[@%:@include <immintrin.h>
+          __attribute__((target("avx512f,vpclmulqdq")))
+          __m512i fold( __m512i a, __m512i b ) { return _mm512_clmulepi64_epi128( a, b, 0x00 ); }
+          ]], [[
+          ]])],
+      [vpclmulqdq_support=yes],
+      [vpclmulqdq_support=no])
+  AC_LANG_POP([C++])
+  AC_MSG_RESULT([$vpclmulqdq_support])
+  AS_IF([test "$vpclmulqdq_support" = "yes"],[
+      AC_DEFINE([HAVE_VPCLMULQDQ_INTRINSICS],[1],[Defined when the compiler can build the VPCLMULQDQ CRC-32C kernel.])
+  ])
 ])
 
 # Fault injection
@@ -84,7 +103,7 @@ AS_IF([test "$enable_fault_injection" = "yes"],[
         [stl_random_support=yes],
         [stl_random_support=no])
     AC_LANG_POP([C++])
-    AS_IF([test "$stl_random_support" != "xyes"],[
+    AS_IF([test "$stl_random_support" != "yes"],[
         AC_MSG_ERROR([fault injection module depends on standard random number library. Try using a newer compiler version.])
     ])
 
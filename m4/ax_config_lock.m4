@@ -0,0 +1,38 @@
+#
+# SYNOPSIS
+#
+#   AX_CONFIG_LOCK
+#
+# DESCRIPTION
+#
+#   Selects the implementation of the runtime locks (--with-lock) and
+#   enables their contention counters (--enable-lock-stats).
+#
+#   tas:    test-and-test-and-set with pause (default).
+#   ticket: FIFO ticket lock with proportional backoff.
+#
+AC_DEFUN([AX_CONFIG_LOCK],
+[
+   AC_ARG_WITH([lock],
+      AS_HELP_STRING([--with-lock=@<:@tas|ticket@:>@], [Implementation of the runtime locks (tas by default)]),
+      [],
+      [with_lock=tas]
+   )
+
+   AS_CASE([$with_lock],
+      [tas], [],
+      [ticket], [AC_DEFINE([NANOS_TICKET_LOCK],[],[Runtime locks are ticket locks])],
+      [AC_MSG_ERROR([unknown lock implementation '$with_lock': use tas or ticket])]
+   )
+   AC_MSG_CHECKING([runtime lock implementation])
+   AC_MSG_RESULT([$with_lock])
+
+   AC_ARG_ENABLE([lock-stats],
+      AS_HELP_STRING([--enable-lock-stats], [Counts lock acquisitions, spins and hold time per site and reports them at shutdown (disabled by default)]),
+      [
+         AS_IF([test "$enableval" = yes],[AC_DEFINE([NANOS_LOCK_STATS],[],[Enables lock contention counters])])
+      ]
+   )
+
+]
+)dnl AX_CONFIG_LOCK
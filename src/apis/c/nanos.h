@@ -236,6 +236,11 @@ NANOS_API_DECL(nanos_err_t, nanos_set_final, ( bool value ));
 NANOS_API_DECL(nanos_err_t, nanos_switch_to_thread, ( unsigned int *thid ));
 NANOS_API_DECL(nanos_err_t, nanos_is_tied, ( bool *result ));
 
+// Time and bytes spent in resiliency operations, for a task type (outline function) or a thread.
+// Threads are queried by id (NANOS_INVALID_PARAM past the last accounted one, 255); the operations of the
+// remaining threads are only returned for NANOS_RESILIENCY_OTHER_THREADS, and any other negative value returns the total
+NANOS_API_DECL(nanos_err_t, nanos_resiliency_stats, ( nanos_resiliency_stats_t *stats, void *task_type, int thread ));
+
 // Team related functions
 
 NANOS_API_DECL(nanos_err_t, nanos_create_team,(nanos_team_t *team, nanos_sched_t sg, unsigned int *nthreads,
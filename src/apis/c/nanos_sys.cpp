@@ -29,6 +29,8 @@
 
 // atexit
 #include <stdlib.h>
+// memset
+#include <string.h>
 
 using namespace nanos;
 
@@ -56,6 +58,39 @@ NANOS_API_DEF(nanos_err_t, nanos_get_default_binding, ( bool *res ))
    return NANOS_OK;
 }
 
+/*! \brief Returns the time and bytes spent in resiliency operations
+ *
+ *  \param [out] stats costs of every operation, indexed by nanos_resiliency_op_t
+ *  \param [in] task_type outline function of the task type, or NULL for all the types
+ *  \param [in] thread runtime thread id, or -1 for all the threads (can not be combined with a task type)
+ */
+NANOS_API_DEF(nanos_err_t, nanos_resiliency_stats, ( nanos_resiliency_stats_t *stats, void *task_type, int thread ))
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","resiliency_stats",NANOS_RUNTIME) );
+   if ( stats == NULL || ( task_type != NULL && thread >= 0 ) ) return NANOS_INVALID_PARAM;
+   memset( stats, 0, sizeof( nanos_resiliency_stats_t ) );
+#ifdef NANOS_RESILIENCY_ENABLED
+   try {
+      ResiliencyCosts &costs = sys.getResiliencyCosts();
+      if ( task_type != NULL ) {
+         // Types that have not been accounted yet cost nothing
+         costs.getTaskType( task_type, *stats );
+      } else if ( thread >= 0 ) {
+         if ( !costs.getThread( (unsigned) thread, *stats ) ) return NANOS_INVALID_PARAM;
+      } else if ( thread == NANOS_RESILIENCY_OTHER_THREADS ) {
+         costs.getOtherThreads( *stats );
+      } else {
+         costs.getTotal( *stats );
+      }
+   } catch ( nanos_err_t e ) {
+      return e;
+   }
+   return NANOS_OK;
+#else
+   return NANOS_UNIMPLEMENTED;
+#endif
+}
+
 NANOS_API_DEF(nanos_err_t, nanos_delay_start, ())
 {
    try {
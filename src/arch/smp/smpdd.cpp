@@ -121,23 +121,57 @@ void SMPDD::execute ( WD &wd ) throw ()
       error::FailureStats<error::DiscardedTask>::increase();
    } else {
       bool restart = false;
+      unsigned executions = 0;
       do {
          try {
-        	 if(sys._crc_enabled){
-        		 bool res = sys.checkSDCviaCRC32(wd);
-        		 if(res){
-        			 sys.restore(wd);
-        		 }
-        	 }
+            WD *recoverable = NULL;
+            if ( sys._crc_enabled && sys.checkSDCviaCRC32( wd ) && !sys.restore( wd ) ) {
+               // Neither the inputs nor their backup can be trusted: a recoverable ancestor has to produce them again
+               for ( WD *parent = wd.getParent(); parent != NULL && recoverable == NULL; parent = parent->getParent() ) {
+                  if ( parent->isRecoverable() ) recoverable = parent;
+               }
+               if ( recoverable != NULL ) {
+                  wd.increaseFailedExecutions();
+                  wd.getParent()->propagateInvalidationAndGetRecoverableAncestor();
+               } else {
+                  debug( "Resiliency: task ", wd.getId(), " runs on corrupted inputs, nothing can recover them." );
+               }
+            }
 
-            // Call to the user function
-            getWorkFct()( wd.getData() );
+            // Call to the user function, timed if protection depends on the task cost
+            if ( recoverable != NULL ) {
+               debug( "Resiliency: task ", wd.getId(), " skipped, its inputs will be produced again." );
+            } else if ( sys.getRedundancy().isSelected( wd ) ) {
+               if ( !sys.getRedundancy().execute( wd, getWorkFct() ) ) {
+                  // No two executions agree: the outputs of the task can not be trusted
+                  WD *ancestor = &wd;
+                  while ( ancestor != NULL && !ancestor->isRecoverable() ) ancestor = ancestor->getParent();
+                  if ( ancestor != NULL ) {
+                     error::FailureStats<error::ExecutionFailure>::increase();
+                     wd.increaseFailedExecutions();
+                     wd.propagateInvalidationAndGetRecoverableAncestor();
+                  } else {
+                     warning( "Resiliency: executions of task ", wd.getId(), " disagree and nothing can recover it. Keeping its first result." );
+                  }
+               }
+            } else if ( executions > 0 ) {
+               // Executions after a failure are part of the cost of recovering from it
+               ResiliencyCosts::Scope cost( ResiliencyCosts::REEXECUTION, &wd );
+               getWorkFct()( wd.getData() );
+            } else if ( sys._crc_enabled && sys.getCRCPolicy().isEnabled() ) {
+               const double start = OS::getMonotonicTimeUs();
+               getWorkFct()( wd.getData() );
+               sys.getCRCPolicy().taskRan( wd, OS::getMonotonicTimeUs() - start );
+            } else {
+               getWorkFct()( wd.getData() );
+            }
 
          } catch (nanos::error::OperationFailure& failure) {
             debug("Resiliency: error detected during task ", wd.getId(), " execution.");
             nanos::error::ExecutionFailure handle( failure );
          }
 
+         executions++;
          restart = wd.isExecutionRepeatable();
 
          if ( restart ) {
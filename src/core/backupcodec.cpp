@@ -0,0 +1,148 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "backupcodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace nanos;
+
+/* Encoded data is a sequence of runs. Each run starts with a 32-bit header
+ * that holds its kind in the lowest 2 bits and its length in bytes in the
+ * rest. Word runs are followed by the repeated word, and literal runs by
+ * their bytes.
+ *
+ * Host memory is only accessed with std::copy, std::fill and plain loads:
+ * a fault while reading or writing it must be able to raise an exception.
+ * Words are loaded with memcpy calls that the compiler turns into single
+ * loads, as helpers are not inlined in this file (see Makefile.am).
+ */
+enum RunKind { ZERO_RUN = 0, WORD_RUN = 1, LITERAL_RUN = 2 };
+
+//! Longest run that fits in a header
+#define BACKUP_CODEC_MAX_RUN ( ( std::size_t(1) << 30 ) - 8 )
+
+static inline bool putHeader ( char *dest, std::size_t &size, std::size_t limit, RunKind kind, std::size_t length )
+{
+   if ( size + sizeof(uint32_t) > limit ) return false;
+   uint32_t header = (uint32_t) ( ( length << 2 ) | kind );
+   memcpy( dest + size, &header, sizeof(header) );
+   size += sizeof(header);
+   return true;
+}
+
+static bool putLiteral ( char const *src, std::size_t length, char *dest, std::size_t &size, std::size_t limit )
+{
+   while ( length > 0 ) {
+      std::size_t piece = std::min( length, BACKUP_CODEC_MAX_RUN );
+      if ( !putHeader( dest, size, limit, LITERAL_RUN, piece ) || size + piece > limit ) return false;
+      std::copy( src, src + piece, dest + size );
+      size += piece;
+      src += piece;
+      length -= piece;
+   }
+   return true;
+}
+
+std::size_t BackupCodec::encode ( char const *src, std::size_t length, char *dest )
+{
+   const std::size_t limit = getMaxEncodedSize( length );
+   const std::size_t words = length / sizeof(uint64_t);
+   std::size_t size = 0;
+   std::size_t literal = 0;   // First byte not encoded yet
+   std::size_t i = 0;
+
+   while ( i < words ) {
+      uint64_t word, next;
+      memcpy( &word, src + i * sizeof(uint64_t), sizeof(word) );
+      std::size_t j = i + 1;
+      for ( ; j < words && j - i < BACKUP_CODEC_MAX_RUN / sizeof(uint64_t); j++ ) {
+         memcpy( &next, src + j * sizeof(uint64_t), sizeof(next) );
+         if ( next != word ) break;
+      }
+
+      // Short runs cost more than their bytes
+      const std::size_t run = j - i;
+      if ( run >= ( word == 0 ? 2 : 3 ) ) {
+         if ( !putLiteral( src + literal, i * sizeof(uint64_t) - literal, dest, size, limit ) ) return 0;
+         if ( word == 0 ) {
+            if ( !putHeader( dest, size, limit, ZERO_RUN, run * sizeof(uint64_t) ) ) return 0;
+         } else {
+            if ( !putHeader( dest, size, limit, WORD_RUN, run * sizeof(uint64_t) ) || size + sizeof(word) > limit ) return 0;
+            memcpy( dest + size, &word, sizeof(word) );
+            size += sizeof(word);
+         }
+         literal = j * sizeof(uint64_t);
+      }
+      i = j;
+   }
+   if ( !putLiteral( src + literal, length - literal, dest, size, limit ) ) return 0;
+   return size;
+}
+
+void BackupCodec::decode ( char const *src, std::size_t size, std::size_t offset, char *dest, std::size_t length )
+{
+   char const *end = src + size;
+   const std::size_t last = offset + length;
+   std::size_t position = 0;   // Original position of the current run
+
+   while ( src < end && position < last ) {
+      uint32_t header;
+      memcpy( &header, src, sizeof(header) );
+      src += sizeof(header);
+      const RunKind kind = (RunKind) ( header & 3 );
+      const std::size_t runLength = header >> 2;
+      const std::size_t runEnd = position + runLength;
+
+      if ( runEnd > offset ) {
+         // Part of the run that falls in the requested range
+         const std::size_t from = std::max( position, offset );
+         const std::size_t to = std::min( runEnd, last );
+         char *out = dest + ( from - offset );
+         switch ( kind ) {
+            case ZERO_RUN:
+               std::fill( out, out + ( to - from ), 0 );
+               break;
+            case WORD_RUN: {
+               std::size_t k = from;
+               for ( ; k < to && ( k - position ) % sizeof(uint64_t) != 0; k++ )
+                  *out++ = src[( k - position ) % sizeof(uint64_t)];
+               for ( ; k + sizeof(uint64_t) <= to; k += sizeof(uint64_t), out += sizeof(uint64_t) )
+                  std::copy( src, src + sizeof(uint64_t), out );
+               for ( ; k < to; k++ )
+                  *out++ = src[( k - position ) % sizeof(uint64_t)];
+               break;
+            }
+            default:
+               std::copy( src + ( from - position ), src + ( to - position ), out );
+               break;
+         }
+      }
+
+      if ( kind == WORD_RUN ) src += sizeof(uint64_t);
+      else if ( kind == LITERAL_RUN ) src += runLength;
+      position = runEnd;
+   }
+
+   if ( position < last ) {
+      char *out = dest + ( std::max( position, offset ) - offset );
+      std::fill( out, dest + length, 0 );
+   }
+}
@@ -0,0 +1,58 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef BACKUPCODEC_HPP_
+#define BACKUPCODEC_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace nanos {
+
+   /*!
+    * \brief Lightweight compression of task backups.
+    *
+    * Data is seen as a sequence of 64-bit words, and encoded as runs of zero
+    * words, runs of a repeated word and literal bytes. It is meant for the
+    * sparse matrices and mostly zero halos that tasks usually read: dense
+    * data is better stored as it is, which the encoder reports.
+    *
+    * Encoded data can be decoded partially: any range of the original bytes
+    * can be written to its destination without decoding what precedes it.
+    */
+   class BackupCodec {
+      public:
+         //! \brief Returns the largest encoded size of \a length bytes that is worth storing.
+         static std::size_t getMaxEncodedSize ( std::size_t length ) { return length - length / 8; }
+
+         /*! \brief Encodes \a length bytes of \a src into \a dest, that must have room for
+          *  getMaxEncodedSize( length ) bytes.
+          *  \returns the encoded size, or 0 if the data does not compress enough.
+          */
+         static std::size_t encode ( char const *src, std::size_t length, char *dest );
+
+         /*! \brief Decodes the bytes [offset, offset+length) of the data encoded in \a src into \a dest.
+          *  Bytes past the end of the encoded data are zero.
+          */
+         static void decode ( char const *src, std::size_t size, std::size_t offset, char *dest, std::size_t length );
+   };
+
+} // namespace nanos
+
+#endif /* BACKUPCODEC_HPP_ */
@@ -0,0 +1,303 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "backuplazycopy_decl.hpp"
+#include "backupmanager.hpp"
+#include "copydata.hpp"
+#include "globalregt.hpp"
+#include "system.hpp"
+#include "lock.hpp"
+#include "atomic.hpp"
+#include "exception/operationfailure.hpp"
+#include "memory/memorypage.hpp"
+#include "crc/crc32c.hpp"
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+
+using namespace nanos;
+
+#define LAZY_PAGE_SIZE ( memory::MemoryPage::size() )
+
+//! Marks the pages that were written before they could be copied
+static char * const LOST_PAGE = reinterpret_cast<char*>( 1 );
+
+//! Backups whose pages are write-protected
+static std::vector<BackupLazyCopy*> registry;
+static Lock registryLock;
+
+BackupLazyCopy::SharedMap BackupLazyCopy::s_shared;
+static Lock sharedLock;
+
+static Atomic<unsigned> lazyInputs( 0 );
+static Atomic<unsigned> sharedInputs( 0 );
+static Atomic<std::size_t> protectedBytes( 0 );
+static Atomic<unsigned> copiedPages( 0 );
+static Atomic<unsigned> lostPages( 0 );
+
+//! \brief Copies a page without faulting if it is not readable.
+static bool readPage ( uintptr_t page, char *dest )
+{
+   struct iovec local = { dest, LAZY_PAGE_SIZE };
+   struct iovec remote = { reinterpret_cast<void*>( page ), LAZY_PAGE_SIZE };
+   if ( process_vm_readv( getpid(), &local, 1, &remote, 1, 0 ) == (ssize_t) LAZY_PAGE_SIZE )
+      return true;
+   if ( errno == EFAULT )
+      return false;
+   // Not allowed to read our own memory that way: write-protected pages are still readable
+   std::copy( reinterpret_cast<char*>( page ), reinterpret_cast<char*>( page ) + LAZY_PAGE_SIZE, dest );
+   return true;
+}
+
+BackupLazyCopy::BackupLazyCopy( const CopyData& copy, Key const &key ) :
+   _device( reinterpret_cast<BackupManager&>(sys.getBackupMemory().getCache().getDevice()) ),
+   _key( key ),
+   _references( 1 ),
+   _begin( copy.getFitAddress().value() ),
+   _end( copy.getFitAddress().value() + copy.getSize() ),
+   _firstPage( _begin & ~( LAZY_PAGE_SIZE - 1 ) ),
+   _pages(),
+   _protectedBegin( 0 ),
+   _protectedEnd( 0 ),
+   _registered( false )
+{
+}
+
+BackupLazyCopy::~BackupLazyCopy()
+{
+   unprotect();
+}
+
+BackupLazyCopy * BackupLazyCopy::acquire( const CopyData& copy, global_reg_t const &reg, unsigned int version )
+{
+   const Key key( reg, version );
+   LockBlock lock( sharedLock );
+   SharedMap::iterator it = s_shared.find( key );
+   if ( it != s_shared.end() ) {
+      it->second->_references++;
+      sharedInputs++;
+      return it->second;
+   }
+
+   BackupLazyCopy *backup = NEW BackupLazyCopy( copy, key );
+   if ( !backup->checkpoint() ) {
+      delete backup;
+      return NULL;
+   }
+   s_shared[key] = backup;
+   return backup;
+}
+
+void BackupLazyCopy::release( BackupLazyCopy *backup )
+{
+   LockBlock lock( sharedLock );
+   if ( --backup->_references == 0 ) {
+      s_shared.erase( backup->_key );
+      delete backup;
+   }
+}
+
+bool BackupLazyCopy::checkpoint()
+{
+   const std::size_t numPages = ( _end - _firstPage + LAZY_PAGE_SIZE - 1 ) / LAZY_PAGE_SIZE;
+   _protectedBegin = _begin == _firstPage ? 0 : 1;
+   _protectedEnd = _end % LAZY_PAGE_SIZE == 0 ? numPages : numPages - 1;
+   if ( _protectedEnd <= _protectedBegin )
+      return false;
+
+   // Partial pages are shared with other data that may be written at any time
+   _pages.assign( numPages, (char*) NULL );
+   for ( std::size_t index = 0; index < numPages; index++ ) {
+      if ( index == _protectedBegin )
+         index = _protectedEnd;
+      if ( index == numPages )
+         break;
+
+      char *page = reinterpret_cast<char*>( _firstPage + index * LAZY_PAGE_SIZE );
+      _pages[index] = static_cast<char*>( _device.allocateBlock( LAZY_PAGE_SIZE ) );
+      try {
+         if ( _pages[index] != NULL )
+            _device.rawCopy( page, page + LAZY_PAGE_SIZE, _pages[index] );
+      } catch ( error::OperationFailure &e ) {
+         _device.freeBlock( _pages[index] );
+         _pages[index] = NULL;
+      }
+      if ( _pages[index] == NULL ) {
+         unprotect();
+         return false;
+      }
+   }
+
+   LockBlock lock( registryLock );
+   registry.push_back( this );
+   _registered = true;
+   mprotect( reinterpret_cast<void*>( _firstPage + _protectedBegin * LAZY_PAGE_SIZE ),
+             ( _protectedEnd - _protectedBegin ) * LAZY_PAGE_SIZE, PROT_READ );
+
+   lazyInputs++;
+   protectedBytes += ( _protectedEnd - _protectedBegin ) * LAZY_PAGE_SIZE;
+   return true;
+}
+
+void BackupLazyCopy::unprotect()
+{
+   if ( _registered ) {
+      LockBlock lock( registryLock );
+      registry.erase( std::find( registry.begin(), registry.end(), this ) );
+      _registered = false;
+
+      // Other backups of overlapping inputs may still need some of the pages protected
+      std::vector<BackupLazyCopy*> others;
+      const uintptr_t begin = _firstPage + _protectedBegin * LAZY_PAGE_SIZE;
+      const uintptr_t end = _firstPage + _protectedEnd * LAZY_PAGE_SIZE;
+      for ( std::vector<BackupLazyCopy*>::iterator it = registry.begin(); it != registry.end(); it++ ) {
+         BackupLazyCopy &other = **it;
+         if ( other._firstPage + other._protectedEnd * LAZY_PAGE_SIZE > begin
+              && other._firstPage + other._protectedBegin * LAZY_PAGE_SIZE < end )
+            others.push_back( &other );
+      }
+
+      if ( others.empty() ) {
+         mprotect( reinterpret_cast<void*>( begin ), end - begin, PROT_READ | PROT_WRITE );
+      } else {
+         for ( std::size_t index = _protectedBegin; index < _protectedEnd; index++ ) {
+            const uintptr_t page = _firstPage + index * LAZY_PAGE_SIZE;
+            bool needed = false;
+            for ( std::vector<BackupLazyCopy*>::iterator it = others.begin(); it != others.end() && !needed; it++ ) {
+               BackupLazyCopy &other = **it;
+               const std::size_t position = ( page - other._firstPage ) / LAZY_PAGE_SIZE;
+               needed = page >= other._firstPage + other._protectedBegin * LAZY_PAGE_SIZE
+                        && position < other._protectedEnd && other._pages[position] == NULL;
+            }
+            if ( !needed )
+               mprotect( reinterpret_cast<void*>( page ), LAZY_PAGE_SIZE, PROT_READ | PROT_WRITE );
+         }
+      }
+   }
+
+   for ( std::vector<char*>::iterator it = _pages.begin(); it != _pages.end(); it++ ) {
+      if ( *it != NULL && *it != LOST_PAGE )
+         _device.freeBlock( *it );
+   }
+   _pages.clear();
+}
+
+bool BackupLazyCopy::restore( uint64_t address, std::size_t length, WorkDescriptor const* wd, char *target )
+{
+   if ( address < _begin || address + length > _end )
+      return false;
+
+   const uint64_t start = target != NULL ? reinterpret_cast<uint64_t>( target ) : address;
+   const std::size_t total = length;
+   const bool checksum = wd != NULL && _device.hasChecksums();
+   crc::Crc32c crc;
+
+   try {
+      while ( length > 0 ) {
+         const std::size_t index = ( address - _firstPage ) / LAZY_PAGE_SIZE;
+         const std::size_t offset = ( address - _firstPage ) % LAZY_PAGE_SIZE;
+         const std::size_t piece = std::min( length, LAZY_PAGE_SIZE - offset );
+
+         // Pages that were never written still hold the input
+         char *page = _pages[index];
+         if ( page == LOST_PAGE )
+            return false;
+         if ( target != NULL ) {
+            char *source = page != NULL ? page + offset : reinterpret_cast<char*>( address );
+            if ( checksum )
+               _device.rawCopy( source, source + piece, target, crc );
+            else
+               _device.rawCopy( source, source + piece, target );
+            target += piece;
+         } else if ( page != NULL && checksum )
+            _device.rawCopy( page + offset, page + offset + piece, reinterpret_cast<char*>( address ), crc );
+         else if ( page != NULL )
+            _device.rawCopy( page + offset, page + offset + piece, reinterpret_cast<char*>( address ) );
+         else if ( checksum )
+            crc.update( reinterpret_cast<void const*>( address ), piece );
+
+         address += piece;
+         length -= piece;
+      }
+   } catch ( error::OperationFailure &e ) {
+      return false;
+   }
+
+   if ( checksum )
+      _device.recordChecksum( start, total, crc.finalize(), wd );
+   return true;
+}
+
+bool BackupLazyCopy::handleFault( siginfo_t *signalInfo )
+{
+   if ( signalInfo->si_code != SEGV_ACCERR )
+      return false;
+
+   const uintptr_t page = reinterpret_cast<uintptr_t>( signalInfo->si_addr ) & ~( LAZY_PAGE_SIZE - 1 );
+   bool found = false;
+   bool readable = true;
+
+   LockBlock lock( registryLock );
+   for ( std::vector<BackupLazyCopy*>::iterator it = registry.begin(); it != registry.end(); it++ ) {
+      BackupLazyCopy &backup = **it;
+      const std::size_t index = ( page - backup._firstPage ) / LAZY_PAGE_SIZE;
+      if ( page < backup._firstPage || index < backup._protectedBegin || index >= backup._protectedEnd
+           || backup._pages[index] != NULL )
+         continue;
+
+      found = true;
+      char *copy = static_cast<char*>( backup._device.allocateBlock( LAZY_PAGE_SIZE ) );
+      if ( copy != NULL && readPage( page, copy ) ) {
+         backup._pages[index] = copy;
+         copiedPages++;
+      } else {
+         // Without room for the copy, the write goes on: only restores of the page will fail
+         if ( copy != NULL ) {
+            backup._device.freeBlock( copy );
+            readable = false;
+         }
+         backup._pages[index] = LOST_PAGE;
+         lostPages++;
+      }
+   }
+
+   // Faults on unreadable pages are real errors
+   if ( !found || !readable )
+      return false;
+
+   mprotect( reinterpret_cast<void*>( page ), LAZY_PAGE_SIZE, PROT_READ | PROT_WRITE );
+   return true;
+}
+
+void BackupLazyCopy::enable()
+{
+   error::SignalTranslator<error::OperationFailure>::setFilter( &BackupLazyCopy::handleFault );
+}
+
+void BackupLazyCopy::getStats( Stats &stats )
+{
+   stats.inputs = lazyInputs.value();
+   stats.shared = sharedInputs.value();
+   stats.protectedBytes = protectedBytes.value();
+   stats.copiedPages = copiedPages.value();
+   stats.lostPages = lostPages.value();
+}
@@ -0,0 +1,117 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef BACKUP_LAZY_COPY_DECL
+#define BACKUP_LAZY_COPY_DECL
+
+#include "backupmanager_fwd.hpp"
+#include "copydata_fwd.hpp"
+#include "globalregt_decl.hpp"
+#include "workdescriptor_fwd.hpp"
+
+#include <signal.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace nanos {
+
+/*! \brief Copy-on-write backup of a read-only task input.
+ *  \details Instead of copying the input into the backup pool, the pages it fully covers
+ *  are write-protected, and each of them is only copied when something is about to write
+ *  it while the backup is alive. The pages it only covers partially may hold other data,
+ *  so they are copied right away.
+ *  A page that can not be read any more when it is written (e.g. because of a memory
+ *  error) is lost, as is any restore that needs it.
+ *  All the tasks that read the same version of a region share its backup, which is
+ *  freed once the last of them releases it.
+ */
+class BackupLazyCopy {
+   public:
+      struct Stats {
+         unsigned    inputs;          //!< Inputs backed up lazily
+         unsigned    shared;          //!< Inputs that used the backup of another reader
+         std::size_t protectedBytes;  //!< Bytes that were write-protected instead of copied
+         unsigned    copiedPages;     //!< Pages copied because they were written
+         unsigned    lostPages;       //!< Pages that could not be copied
+      };
+
+   private:
+      typedef std::pair<global_reg_t, unsigned int> Key;   //!< Region and version
+      typedef std::map<Key, BackupLazyCopy*> SharedMap;
+
+      static SharedMap     s_shared;
+
+      BackupManager       &_device;
+      Key                  _key;
+      unsigned             _references;
+      uintptr_t            _begin;
+      uintptr_t            _end;
+      uintptr_t            _firstPage;
+      std::vector<char*>   _pages;           //!< Copy of each page of the input, NULL while it is write-protected
+      std::size_t          _protectedBegin;  //!< First write-protected page
+      std::size_t          _protectedEnd;    //!< Past the last write-protected page
+      bool                 _registered;
+
+      //! \brief Copies the pages that are about to be written. Called on segmentation faults.
+      static bool handleFault( siginfo_t *signalInfo );
+
+      //! \brief Removes the write protection of the pages that no other backup needs.
+      void unprotect();
+
+      BackupLazyCopy( const CopyData& copy, Key const &key );
+
+      ~BackupLazyCopy();
+
+      /*! \brief Write-protects the input.
+       *  \returns false if the input is too small to be protected, or its partial pages could not be
+       *  copied: then it must be backed up as usual.
+       */
+      bool checkpoint();
+
+   public:
+      BackupLazyCopy( const BackupLazyCopy& ) = delete;
+
+      /*! \brief Returns the backup of the given version of the region of \a copy, write-protecting it
+       *  if no other task has done so yet.
+       *  \returns NULL if the input can not be backed up lazily.
+       */
+      static BackupLazyCopy * acquire( const CopyData& copy, global_reg_t const &reg, unsigned int version );
+
+      //! \brief Drops a reference to \a backup, that is destroyed by the last one.
+      static void release( BackupLazyCopy *backup );
+
+      /*! \brief Restores the host range [address, address+length) of the input. Returns false if some page was lost.
+       *  If the backup device computes checksums, the CRC of the whole range, including the pages that were
+       *  never written and are left in place, is recorded for \a wd.
+       *  If \a target is given, the range is written there instead, and its CRC is recorded for that address.
+       */
+      bool restore( uint64_t address, std::size_t length, WorkDescriptor const* wd = NULL, char *target = NULL );
+
+      bool restore() { return restore( _begin, _end - _begin ); }
+
+      //! \brief Makes write faults on protected pages trigger the copy of those pages.
+      static void enable();
+
+      static void getStats( Stats &stats );
+};
+
+} // namespace nanos
+
+#endif // BACKUP_LAZY_COPY_DECL
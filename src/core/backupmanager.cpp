@@ -18,28 +18,108 @@
 /*************************************************************************************/
 
 #include "backupmanager.hpp"
+#include "backupcodec.hpp"
 #include "deviceops.hpp"
 #include "exception/checkpointfailure.hpp"
 #include "exception/restorefailure.hpp"
+#include "lock.hpp"
+#include "system.hpp"
+#include "basethread.hpp"
+#include "atomic.hpp"
 
 #include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 
 using namespace nanos;
 
-BackupManager::BackupManager ( ) :
-      Device("BackupMgr"), _memsize(0), _pool_addr(), _managed_pool() {}
+//! Size of the huge pages used for the backup pool
+#define BACKUP_HUGE_PAGE_SIZE ( 2 * 1024 * 1024 )
+//! Unit in which compressed backups are stored and can be partially restored
+#define BACKUP_FRAME_SIZE ( 64 * 1024 )
+//! Size of the address space of compressed backups, relative to the pool
+#define BACKUP_ADDRESS_SPACE_RATIO 16
 
-BackupManager::BackupManager ( const char *n, size_t size ) :
-      Device(n), _memsize(size),
-      _pool_addr(mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0)),
-      _managed_pool(boost::interprocess::create_only, _pool_addr, size)
+//! \brief Maps a piece of the backup pool with the requested kind of pages.
+static void * mapPartition ( std::size_t size, BackupManager::PageSize pages )
 {
+#ifdef MAP_HUGETLB
+   if ( pages == BackupManager::EXPLICIT_HUGE_PAGES ) {
+      void *address = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+      if ( address != MAP_FAILED )
+         return address;
+      warning( "Could not reserve ", size, " bytes of huge pages for task backups, using transparent huge pages" );
+   }
+#endif
+   void *address = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+   if ( address == MAP_FAILED )
+      fatal( "Could not map ", size, " bytes for task backups" );
+#ifdef MADV_HUGEPAGE
+   if ( pages != BackupManager::SMALL_PAGES )
+      madvise(address, size, MADV_HUGEPAGE);
+#endif
+   return address;
+}
+
+BackupManager::BackupManager ( ) :
+      Device("BackupMgr"), _memsize(0), _partitions(), _nodePartitions(), _spills(0),
+      _checksums(false), _checksumMap(), _checksumLock(),
+      _compression(false), _addressSpace(NULL), _addressSpaceSize(0), _freeRanges(), _usedRanges(),
+      _frames(), _frameBytes(0), _storedBytes(0), _frameLock(),
+      _async(false), _copyQueue(), _copyMutex(), _copyCondition(), _copyEngine(), _stopEngine(false),
+      _asyncCopies(0), _helpedCopies(0) {}
+
+BackupManager::BackupManager ( const char *n, size_t size, bool checksums, unsigned threads,
+                               std::vector<unsigned> const &nodes, PageSize pages, bool compression ) :
+      Device(n), _memsize(size), _partitions(), _nodePartitions(), _spills(0),
+      _checksums(checksums), _checksumMap(), _checksumLock(),
+      _compression(compression), _addressSpace(NULL), _addressSpaceSize(0), _freeRanges(), _usedRanges(),
+      _frames(), _frameBytes(0), _storedBytes(0), _frameLock(),
+      _async(false), _copyQueue(), _copyMutex(), _copyCondition(), _copyEngine(), _stopEngine(false),
+      _asyncCopies(0), _helpedCopies(0)
+{
+   if ( _compression ) {
+      // Only reserved: backups are never written there
+      _addressSpaceSize = ( size + BACKUP_FRAME_SIZE - 1 ) / BACKUP_FRAME_SIZE * BACKUP_FRAME_SIZE * BACKUP_ADDRESS_SPACE_RATIO;
+      void *address = mmap(NULL, _addressSpaceSize, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+      if ( address == MAP_FAILED )
+         fatal( "Could not reserve ", _addressSpaceSize, " bytes of address space for compressed task backups" );
+      _addressSpace = static_cast<char*>( address );
+      _freeRanges[(uint64_t) _addressSpace] = _addressSpaceSize;
+   }
+
+   const std::size_t numPartitions = std::max<std::size_t>( nodes.size(), 1 );
+   const std::size_t pageSize = pages == SMALL_PAGES ? sysconf(_SC_PAGESIZE) : BACKUP_HUGE_PAGE_SIZE;
+   const std::size_t partitionSize = ( ( size + numPartitions - 1 ) / numPartitions + pageSize - 1 ) / pageSize * pageSize;
+
+   for ( std::size_t i = 0; i < numPartitions; i++ ) {
+      Partition partition;
+      partition.node = nodes.empty() ? 0 : nodes[i];
+      partition.size = partitionSize;
+      partition.address = mapPartition( partitionSize, pages );
+      // Bind before the pool touches any page
+      if ( nodes.size() > 1 && !sys._hwloc.bindMemoryToNumaNode( partition.address, partitionSize, partition.node ) )
+         verbose( "Backup pool partition of NUMA node ", partition.node, " could not be bound to it" );
+      partition.pool = NEW BackupPool( partition.address, partitionSize, threads );
+
+      if ( partition.node >= _nodePartitions.size() )
+         _nodePartitions.resize( partition.node + 1, -1 );
+      _nodePartitions[partition.node] = i;
+      _partitions.push_back( partition );
+   }
 }
 
 BackupManager::~BackupManager ( )
 {
-   munmap(_pool_addr, _memsize);
+   stopCopyEngine();
+   for ( std::vector<Partition>::iterator it = _partitions.begin(); it != _partitions.end(); it++ ) {
+      delete it->pool;
+      munmap(it->address, it->size);
+   }
+   if ( _addressSpace != NULL )
+      munmap(_addressSpace, _addressSpaceSize);
 }
 
 BackupManager & BackupManager::operator= ( BackupManager & arch )
@@ -47,22 +127,141 @@ BackupManager & BackupManager::operator= ( BackupManager & arch )
    if (this != &arch) {
       Device::operator=(arch);
       _memsize = arch._memsize;
-      _managed_pool.swap(arch._managed_pool);
+      _partitions.swap(arch._partitions);
+      _nodePartitions.swap(arch._nodePartitions);
+      _checksums = arch._checksums;
+      std::swap(_compression, arch._compression);
+      std::swap(_addressSpace, arch._addressSpace);
+      std::swap(_addressSpaceSize, arch._addressSpaceSize);
+      _freeRanges.swap(arch._freeRanges);
+      _usedRanges.swap(arch._usedRanges);
+      _frames.swap(arch._frames);
+      std::swap(_frameBytes, arch._frameBytes);
+      std::swap(_storedBytes, arch._storedBytes);
    }
    return *this;
 }
 
+unsigned BackupManager::getLocalPartition () const
+{
+   if ( _partitions.size() < 2 || myThread == NULL || myThread->runningOn() == NULL )
+      return 0;
+   unsigned node = myThread->runningOn()->getNumaNode();
+   return node < _nodePartitions.size() && _nodePartitions[node] >= 0 ? _nodePartitions[node] : 0;
+}
+
+void BackupManager::recordChecksum ( uint64_t address, std::size_t length, uint32_t crc, WorkDescriptor const* wd )
+{
+   LockBlock lock( _checksumLock );
+   RegionChecksum &entry = _checksumMap[address];
+   entry.length = length;
+   entry.crc = crc;
+   entry.wd = wd != NULL ? wd->getId() : -1;
+}
+
+bool BackupManager::takeChecksum ( uint64_t address, std::size_t length, WorkDescriptor const& wd, uint32_t &crc )
+{
+   LockBlock lock( _checksumLock );
+   ChecksumMap::iterator it = _checksumMap.find( address );
+   if ( it == _checksumMap.end() )
+      return false;
+
+   bool found = it->second.length == length && it->second.wd == wd.getId();
+   if ( found )
+      crc = it->second.crc;
+   _checksumMap.erase( it );
+   return found;
+}
+
+void * BackupManager::allocateBlock ( std::size_t size )
+{
+   // Try the partition of the NUMA node of this thread first
+   const unsigned local = getLocalPartition();
+   for ( unsigned i = 0; i < _partitions.size(); i++ ) {
+      void *address = _partitions[( local + i ) % _partitions.size()].pool->allocate(size);
+      if ( address != NULL ) {
+         if ( i > 0 )
+            _spills++;
+         return address;
+      }
+   }
+   return NULL;
+}
+
+void BackupManager::freeBlock ( void *address )
+{
+   for ( std::vector<Partition>::iterator it = _partitions.begin(); it != _partitions.end(); it++ ) {
+      char *begin = static_cast<char*>( it->address );
+      if ( static_cast<char*>( address ) >= begin && static_cast<char*>( address ) < begin + it->size ) {
+         it->pool->deallocate(address);
+         return;
+      }
+   }
+}
+
 memory::Address BackupManager::memAllocate ( size_t size,
                                     SeparateMemoryAddressSpace &mem,
                                     WorkDescriptor const* wd,
                                     uint copyIdx )
 {
-   return _managed_pool.allocate(size);
+   if ( !_compression )
+      return allocateBlock(size);
+
+   // Ranges are made of whole frames, that are never shared
+   const std::size_t length = ( size + BACKUP_FRAME_SIZE - 1 ) / BACKUP_FRAME_SIZE * BACKUP_FRAME_SIZE;
+   LockBlock lock( _frameLock );
+   for ( RangeMap::iterator it = _freeRanges.begin(); it != _freeRanges.end(); it++ ) {
+      if ( it->second >= length ) {
+         uint64_t address = it->first;
+         std::size_t remaining = it->second - length;
+         _freeRanges.erase( it );
+         if ( remaining > 0 )
+            _freeRanges[address + length] = remaining;
+         _usedRanges[address] = length;
+         return memory::Address( address );
+      }
+   }
+   return nullptr;
 }
 
 void BackupManager::memFree ( memory::Address addr, SeparateMemoryAddressSpace &mem )
 {
-   _managed_pool.deallocate(addr);
+   if ( !_compression ) {
+      freeBlock(addr);
+      return;
+   }
+
+   LockBlock lock( _frameLock );
+   RangeMap::iterator range = _usedRanges.find( addr.value() );
+   if ( range == _usedRanges.end() )
+      return;
+   uint64_t address = range->first;
+   std::size_t length = range->second;
+   _usedRanges.erase( range );
+
+   // Drop the contents of its frames
+   const uint64_t first = ( address - (uint64_t) _addressSpace ) / BACKUP_FRAME_SIZE;
+   FrameMap::iterator frame = _frames.lower_bound( first );
+   while ( frame != _frames.end() && frame->first < first + length / BACKUP_FRAME_SIZE ) {
+      freeBlock( frame->second.data );
+      _frames.erase( frame++ );
+   }
+
+   // Merge the range with its free neighbours
+   RangeMap::iterator next = _freeRanges.lower_bound( address );
+   if ( next != _freeRanges.end() && next->first == address + length ) {
+      length += next->second;
+      _freeRanges.erase( next++ );
+   }
+   if ( next != _freeRanges.begin() ) {
+      RangeMap::iterator previous = next;
+      previous--;
+      if ( previous->first + previous->second == address ) {
+         previous->second += length;
+         return;
+      }
+   }
+   _freeRanges[address] = length;
 }
 
 void BackupManager::_canAllocate ( SeparateMemoryAddressSpace& mem,
@@ -74,7 +273,153 @@ void BackupManager::_canAllocate ( SeparateMemoryAddressSpace& mem,
 std::size_t BackupManager::getMemCapacity (
       SeparateMemoryAddressSpace& mem )
 {
-   return _managed_pool.get_size();
+   if ( _compression )
+      return _addressSpaceSize;
+   std::size_t capacity = 0;
+   for ( std::vector<Partition>::const_iterator it = _partitions.begin(); it != _partitions.end(); it++ )
+      capacity += it->pool->getSize();
+   return capacity;
+}
+
+void BackupManager::getCompressionStats ( std::size_t &encoded, std::size_t &stored )
+{
+   LockBlock lock( _frameLock );
+   encoded = _frameBytes;
+   stored = _storedBytes;
+}
+
+bool BackupManager::encodeFrame ( char *src, std::size_t length, char *scratch, Frame &frame )
+{
+   frame.length = length;
+   frame.size = BackupCodec::encode( src, length, scratch );
+   frame.raw = frame.size == 0;
+   if ( frame.raw )
+      frame.size = length;
+
+   frame.data = static_cast<char*>( allocateBlock( frame.size ) );
+   if ( frame.data == NULL )
+      return false;
+   if ( frame.raw )
+      rawCopy( src, src + length, frame.data );
+   else
+      memcpy( frame.data, scratch, frame.size );
+   return true;
+}
+
+void BackupManager::replaceFrame ( uint64_t index, Frame const &frame )
+{
+   std::pair<FrameMap::iterator, bool> inserted = _frames.insert( std::make_pair( index, frame ) );
+   if ( !inserted.second ) {
+      freeBlock( inserted.first->second.data );
+      inserted.first->second = frame;
+   }
+   _frameBytes += frame.length;
+   _storedBytes += frame.size;
+}
+
+bool BackupManager::store ( char *dest, char *src, std::size_t len, crc::Crc32c *crc )
+{
+   if ( !_compression ) {
+      if ( crc != NULL )
+         rawCopy(src, src + len, dest, *crc);
+      else
+         rawCopy(src, src + len, dest);
+      return true;
+   }
+
+   std::vector<char> scratch( BackupCodec::getMaxEncodedSize( BACKUP_FRAME_SIZE ) );
+   std::vector<char> contents;
+   while ( len > 0 ) {
+      const uint64_t index = ( dest - _addressSpace ) / BACKUP_FRAME_SIZE;
+      const std::size_t offset = ( dest - _addressSpace ) % BACKUP_FRAME_SIZE;
+      const std::size_t piece = std::min( len, BACKUP_FRAME_SIZE - offset );
+      if ( crc != NULL )
+         crc->update( src, piece );
+
+      Frame frame;
+      LockBlock lock( _frameLock );
+      FrameMap::iterator old = _frames.find( index );
+      if ( offset == 0 && ( old == _frames.end() || old->second.length <= piece ) ) {
+         // The piece replaces the whole contents of the frame
+         lock.release();
+         if ( !encodeFrame( src, piece, &scratch[0], frame ) )
+            return false;
+         lock.acquire();
+      } else {
+         // Merge the piece with the current contents of the frame
+         const std::size_t length = std::max( offset + piece, old != _frames.end() ? old->second.length : 0 );
+         contents.resize( length );
+         if ( old != _frames.end() && old->second.raw )
+            memcpy( &contents[0], old->second.data, old->second.length );
+         else if ( old != _frames.end() )
+            BackupCodec::decode( old->second.data, old->second.size, 0, &contents[0], old->second.length );
+         std::fill( contents.begin() + ( old != _frames.end() ? old->second.length : 0 ), contents.end(), 0 );
+         rawCopy( src, src + piece, &contents[offset] );
+         if ( !encodeFrame( &contents[0], length, &scratch[0], frame ) )
+            return false;
+      }
+      replaceFrame( index, frame );
+
+      dest += piece;
+      src += piece;
+      len -= piece;
+   }
+   return true;
+}
+
+void BackupManager::load ( char *dest, char *src, std::size_t len, crc::Crc32c *crc )
+{
+   if ( !_compression ) {
+      if ( crc != NULL )
+         rawCopy(src, src + len, dest, *crc);
+      else
+         rawCopy(src, src + len, dest);
+      return;
+   }
+
+   // Frames are decoded straight into host memory, and hashed while still in the cache
+   LockBlock lock( _frameLock );
+   while ( len > 0 ) {
+      const uint64_t index = ( src - _addressSpace ) / BACKUP_FRAME_SIZE;
+      const std::size_t offset = ( src - _addressSpace ) % BACKUP_FRAME_SIZE;
+      const std::size_t piece = std::min( len, BACKUP_FRAME_SIZE - offset );
+
+      FrameMap::iterator frame = _frames.find( index );
+      if ( frame == _frames.end() ) {
+         std::fill( dest, dest + piece, 0 );
+      } else if ( frame->second.raw ) {
+         const std::size_t available = offset < frame->second.length ? std::min( piece, frame->second.length - offset ) : 0;
+         rawCopy( frame->second.data + offset, frame->second.data + offset + available, dest );
+         std::fill( dest + available, dest + piece, 0 );
+      } else {
+         BackupCodec::decode( frame->second.data, frame->second.size, offset, dest, piece );
+      }
+      if ( crc != NULL )
+         crc->update( dest, piece );
+
+      dest += piece;
+      src += piece;
+      len -= piece;
+   }
+}
+
+void BackupManager::getPoolStats ( BackupPool::Stats &stats )
+{
+   BackupPool::Stats partition;
+   memset( &stats, 0, sizeof(stats) );
+   for ( std::vector<Partition>::iterator it = _partitions.begin(); it != _partitions.end(); it++ ) {
+      it->pool->getStats( partition );
+      stats.add( partition );
+   }
+}
+
+void BackupManager::discardCheckpoint ( WorkDescriptor const* wd )
+{
+   // Compressed backups ran out of space in the middle of the copy
+   error::FailureStats<error::CheckpointFailure>::increase();
+   if ( wd != NULL )
+      const_cast<WorkDescriptor*>( wd )->setRecoverable( false );
+   debug( "Resiliency: not enough space to store a compressed checkpoint" );
 }
 
 bool BackupManager::checkpointCopy ( memory::Address devAddr, memory::Address hostAddr,
@@ -88,18 +433,7 @@ bool BackupManager::checkpointCopy ( memory::Address devAddr, memory::Address ho
     */
    bool success;
    try {
-      char* begin = static_cast<char*>(hostAddr);
-      char* end = static_cast<char*>(hostAddr)+len;
-      char* dest = static_cast<char*>(devAddr);
-      /* We use another function call to perform the copy in order to
-       * be able to compile std::copy call in a separate file.
-       * This is needed to avoid the GCC bug related to 
-       * non-call-exceptions plus inline and ipa-pure-const
-       * optimizations.
-       */
-      rawCopy(begin, end, dest);
-
-      success = true;
+      success = storeCheckpoint( devAddr, hostAddr, len, wd );
    } catch ( error::OperationFailure &e ) {
       error::CheckpointFailure error(e);
 
@@ -108,6 +442,30 @@ bool BackupManager::checkpointCopy ( memory::Address devAddr, memory::Address ho
    return success;
 }
 
+bool BackupManager::storeCheckpoint ( memory::Address devAddr, memory::Address hostAddr,
+                                      std::size_t len, WorkDescriptor const* wd )
+{
+   char* begin = static_cast<char*>(hostAddr);
+   char* end = static_cast<char*>(hostAddr)+len;
+   char* dest = static_cast<char*>(devAddr);
+   /* We use another function call to perform the copy in order to
+    * be able to compile std::copy call in a separate file.
+    * This is needed to avoid the GCC bug related to
+    * non-call-exceptions plus inline and ipa-pure-const
+    * optimizations.
+    * When checksums are enabled, the input CRC is computed in the
+    * same pass so that the SDC check does not read the data again.
+    */
+   ResiliencyCosts::Scope cost( ResiliencyCosts::CHECKPOINT, wd, len );
+   crc::Crc32c crc;
+   bool success = store(dest, begin, end - begin, _checksums ? &crc : NULL);
+   if ( success && _checksums )
+      recordChecksum( hostAddr.value(), len, crc.finalize(), wd );
+   else if ( !success )
+      discardCheckpoint( wd );
+   return success;
+}
+
 bool BackupManager::restoreCopy ( memory::Address hostAddr, memory::Address devAddr,
                                std::size_t len, SeparateMemoryAddressSpace &mem,
                                WorkDescriptor const* wd ) noexcept
@@ -118,6 +476,7 @@ bool BackupManager::restoreCopy ( memory::Address hostAddr, memory::Address devA
     * to create and manage private checkpoints, so passing through the dictionary and
     * region cache is necessary.
     */
+   ResiliencyCosts::Scope cost( ResiliencyCosts::RESTORE, wd, len );
    bool success = false;
    do {
       try {
@@ -130,7 +489,10 @@ bool BackupManager::restoreCopy ( memory::Address hostAddr, memory::Address devA
           * non-call-exceptions plus inline and ipa-pure-const
           * optimizations.
           */
-         rawCopy(begin, end, dest);
+         crc::Crc32c crc;
+         load(dest, begin, end - begin, _checksums ? &crc : NULL);
+         if ( _checksums )
+            recordChecksum( hostAddr.value(), len, crc.finalize(), wd );
 
          success = true;
       } catch ( error::OperationFailure &e ) {
@@ -146,6 +508,11 @@ void BackupManager::_copyIn ( memory::Address devAddr, memory::Address hostAddr,
                               DeviceOps *ops, WorkDescriptor const* wd, void *hostObject,
                               reg_t hostRegionId )
 {
+   if ( _async ) {
+      queueCheckpoint( devAddr, hostAddr, len, ops, wd );
+      return;
+   }
+
    ops->addOp();
 
    bool completed = checkpointCopy( devAddr, hostAddr, len, mem, wd );
@@ -155,6 +522,97 @@ void BackupManager::_copyIn ( memory::Address devAddr, memory::Address hostAddr,
       ops->abortOp();
 }
 
+void BackupManager::startCopyEngine ( )
+{
+   if ( _async )
+      return;
+   _async = true;
+   _stopEngine = false;
+   _copyEngine = std::thread( &BackupManager::copyEngineLoop, this );
+}
+
+void BackupManager::stopCopyEngine ( )
+{
+   if ( !_async )
+      return;
+   {
+      std::lock_guard<std::mutex> lock( _copyMutex );
+      _stopEngine = true;
+      _copyCondition.notify_all();
+   }
+   _copyEngine.join();
+   _async = false;
+}
+
+void BackupManager::queueCheckpoint ( memory::Address devAddr, memory::Address hostAddr, std::size_t len,
+                                      DeviceOps *ops, WorkDescriptor const* wd, bool *aborted )
+{
+   // The operation stays pending until the copy is made
+   ops->addOp();
+
+   CopyJob job = { devAddr, hostAddr, len, ops, wd, aborted };
+   std::lock_guard<std::mutex> lock( _copyMutex );
+   _copyQueue.push_back( job );
+   _copyCondition.notify_one();
+}
+
+void BackupManager::copyEngineLoop ( )
+{
+   std::unique_lock<std::mutex> lock( _copyMutex );
+   while ( true ) {
+      _copyCondition.wait( lock, [this]() { return _stopEngine || !_copyQueue.empty(); } );
+      if ( _copyQueue.empty() )
+         return;
+
+      CopyJob job = _copyQueue.front();
+      _copyQueue.pop_front();
+      lock.unlock();
+      runCopy( job );
+      lock.lock();
+   }
+}
+
+bool BackupManager::runQueuedCopy ( )
+{
+   std::unique_lock<std::mutex> lock( _copyMutex );
+   if ( _copyQueue.empty() )
+      return false;
+   CopyJob job = _copyQueue.front();
+   _copyQueue.pop_front();
+   lock.unlock();
+
+   _helpedCopies++;
+   runCopy( job );
+   return true;
+}
+
+void BackupManager::runCopy ( CopyJob const &job )
+{
+   _asyncCopies++;
+   bool success;
+   try {
+      success = storeCheckpoint( job.devAddr, job.hostAddr, job.len, job.wd );
+   } catch ( error::OperationFailure &e ) {
+      // The thread that makes the copy may not be running the task it was made for
+      error::CheckpointFailure error( e, *const_cast<WorkDescriptor*>( job.wd ) );
+      success = false;
+   }
+
+   if ( success ) {
+      job.ops->completeOp();
+   } else {
+      if ( job.aborted != NULL )
+         *job.aborted = true;
+      job.ops->abortOp();
+   }
+}
+
+void BackupManager::getAsyncStats ( unsigned &copies, unsigned &helped ) const
+{
+   copies = _asyncCopies.value();
+   helped = _helpedCopies.value();
+}
+
 void BackupManager::_copyOut ( memory::Address hostAddr, memory::Address devAddr,
                                std::size_t len, SeparateMemoryAddressSpace &mem,
                                DeviceOps *ops, WorkDescriptor const* wd, void *hostObject,
@@ -190,14 +648,24 @@ void BackupManager::_copyInStrided1D ( memory::Address devAddr, memory::Address
                                        void *hostObject, reg_t hostRegionId )
 {
    ops->addOp();
+   ResiliencyCosts::Scope cost( ResiliencyCosts::CHECKPOINT, wd, len * numChunks );
    try {
       char* hostAddresses = (char*) hostAddr;
       char* deviceAddresses = (char*) devAddr;
 
-      for (unsigned int i = 0; i < numChunks; i += 1) {
+      crc::Crc32c crc;
+      bool success = true;
+      for (unsigned int i = 0; i < numChunks && success; i += 1) {
          //memcpy(&deviceAddresses[i * ld], &hostAddresses[i * ld], len);
-         rawCopy((char*) &hostAddresses[i * ld], (char*) &hostAddresses[i * ld]+len, (char*) &deviceAddresses[i * ld]);
+         success = store(&deviceAddresses[i * ld], &hostAddresses[i * ld], len, _checksums ? &crc : NULL);
+      }
+      if ( !success ) {
+         discardCheckpoint( wd );
+         ops->abortOp();
+         return;
       }
+      if ( _checksums )
+         recordChecksum( hostAddr.value(), len * numChunks, crc.finalize(), wd );
       ops->completeOp();
 
    } catch ( error::OperationFailure &error ) {
@@ -215,14 +683,18 @@ void BackupManager::_copyOutStrided1D ( memory::Address hostAddr, memory::Addres
                                         void *hostObject, reg_t hostRegionId )
 {
    ops->addOp();
+   ResiliencyCosts::Scope cost( ResiliencyCosts::RESTORE, wd, len * numChunks );
    try {
       char* hostAddresses = (char*) hostAddr;
       char* deviceAddresses = (char*) devAddr;
 
+      crc::Crc32c crc;
       for (unsigned int i = 0; i < numChunks; i += 1) {
          //memcpy(&hostAddresses[i * ld], &deviceAddresses[i * ld], len);
-         rawCopy((char*) &deviceAddresses[i * ld], (char*) &deviceAddresses[i * ld]+len, (char*) &hostAddresses[i * ld]);
+         load(&hostAddresses[i * ld], &deviceAddresses[i * ld], len, _checksums ? &crc : NULL);
       }
+      if ( _checksums )
+         recordChecksum( hostAddr.value(), len * numChunks, crc.finalize(), wd );
       ops->completeOp();
    } catch ( error::OperationFailure &error ) {
       error::CheckpointFailure handler(error);
@@ -23,39 +23,140 @@
 #include "backupmanager_fwd.hpp"
 
 #include "workdescriptor_decl.hpp"
+#include "crc/crc32c.hpp"
+#include "lock_decl.hpp"
 
-#include <boost/interprocess/managed_external_buffer.hpp>
-#include <boost/interprocess/indexes/null_index.hpp>
+#include "backuppool.hpp"
+#include "atomic_decl.hpp"
 
+#include <condition_variable>
 #include <cstddef>
-
-namespace boost {
-   namespace interprocess {
-
-      typedef boost::interprocess::basic_managed_external_buffer
-            <char
-            ,rbtree_best_fit<mutex_family,offset_ptr<void> >
-            ,null_index
-            > managed_buffer;
-   }
-}
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace nanos {
 
    class BackupManager : public Device {
+      public:
+         //! Pages that back the backup pool.
+         enum PageSize { SMALL_PAGES, TRANSPARENT_HUGE_PAGES, EXPLICIT_HUGE_PAGES };
+
+         //! Piece of the backup pool that lives in a NUMA node.
+         struct Partition {
+            unsigned     node;      //!< OS index of the NUMA node
+            void        *address;
+            std::size_t  size;
+            BackupPool  *pool;
+         };
+
       private:
+         //! CRC-32C of a host memory range, computed while it was being copied.
+         struct RegionChecksum {
+            std::size_t length;
+            uint32_t    crc;
+            int         wd;     //!< Id of the WD the copy was made for
+         };
+         typedef std::map<uint64_t, RegionChecksum> ChecksumMap;
+
+         /*! \brief Compressed contents of a frame of the backup address space.
+          *  Bytes past the written length of a frame are zero.
+          */
+         struct Frame {
+            char       *data;     //!< Stored bytes, in the pool
+            std::size_t size;     //!< Number of stored bytes
+            std::size_t length;   //!< Bytes written since the beginning of the frame
+            bool        raw;      //!< Stored without encoding (did not compress)
+         };
+         typedef std::map<uint64_t, Frame> FrameMap;          //!< Frames indexed by their position
+         typedef std::map<uint64_t, std::size_t> RangeMap;    //!< Address space ranges indexed by address
+
+         //! Checkpoint copy queued for the copy engine.
+         struct CopyJob {
+            memory::Address       devAddr;
+            memory::Address       hostAddr;
+            std::size_t           len;
+            DeviceOps            *ops;
+            WorkDescriptor const *wd;
+            bool                 *aborted;   //!< Set if the copy could not be made, if not NULL
+         };
+
          size_t                              _memsize;
-         void                               *_pool_addr;
-         boost::interprocess::managed_buffer _managed_pool;
+         std::vector<Partition>              _partitions;
+         std::vector<int>                    _nodePartitions;  //!< Partition of each NUMA node, by OS index
+         Atomic<unsigned>                    _spills;          //!< Allocations that did not fit in the partition of their thread
+         bool                                _checksums;    //!< Compute CRCs while copying
+         ChecksumMap                         _checksumMap;  //!< Checksums indexed by host address
+         Lock                                _checksumLock;
+
+         /* With compression, device addresses point to a reserved address space that is never
+          * touched: the pool stores the compressed contents of each of its frames instead.
+          */
+         bool                                _compression;
+         char                               *_addressSpace;
+         std::size_t                         _addressSpaceSize;
+         RangeMap                            _freeRanges;
+         RangeMap                            _usedRanges;
+         FrameMap                            _frames;
+         std::size_t                         _frameBytes;     //!< Bytes encoded into frames so far
+         std::size_t                         _storedBytes;    //!< Size of their encoding
+         Lock                                _frameLock;
+
+         /* With asynchronous copies, checkpoints are queued and made by the copy engine
+          * thread. Their operations complete when the copy is done, like device transfers.
+          */
+         bool                                _async;
+         std::deque<CopyJob>                 _copyQueue;
+         std::mutex                          _copyMutex;
+         std::condition_variable             _copyCondition;
+         std::thread                         _copyEngine;
+         bool                                _stopEngine;
+         Atomic<unsigned>                    _asyncCopies;    //!< Checkpoints made asynchronously
+         Atomic<unsigned>                    _helpedCopies;   //!< Asynchronous checkpoints made by waiting workers
+
+         //! \brief Returns the partition of the NUMA node of the current thread.
+         unsigned getLocalPartition () const;
+
+         //! \brief Copies host data into backup memory (compressing it if enabled), and adds it to \a crc if not NULL.
+         bool store ( char *dest, char *src, std::size_t len, crc::Crc32c *crc );
+
+         //! \brief Copies backup memory into host memory (decompressing it if enabled), and adds it to \a crc if not NULL.
+         void load ( char *dest, char *src, std::size_t len, crc::Crc32c *crc );
+
+         //! \brief Encodes \a length bytes into a new pool block, that is described in \a frame.
+         bool encodeFrame ( char *src, std::size_t length, char *scratch, Frame &frame );
+
+         //! \brief Replaces a frame by a new version and frees the old one. Must be called with the frame lock held.
+         void replaceFrame ( uint64_t index, Frame const &frame );
+
+         //! \brief Marks the backups of \a wd as invalid when they could not be stored.
+         void discardCheckpoint ( WorkDescriptor const* wd );
+
+         //! \brief Copies host data into backup memory on behalf of \a wd. Memory errors are thrown as exceptions.
+         bool storeCheckpoint ( memory::Address devAddr, memory::Address hostAddr, std::size_t len, WorkDescriptor const* wd );
+
+         //! \brief Takes queued checkpoint copies until the engine is stopped.
+         void copyEngineLoop ();
+
+         //! \brief Makes a queued checkpoint copy and completes its operation.
+         void runCopy ( CopyJob const &job );
 
       public:
          BackupManager ( );
 
-         BackupManager ( const char *n, size_t memsize );
+         /*! \brief Creates a backup device whose pool caches free blocks for the first \a threads threads.
+          *  The pool is split evenly among the given NUMA nodes, and each piece is bound to its node.
+          *  Threads take their backups from the piece of their node while it has room.
+          */
+         BackupManager ( const char *n, size_t memsize, bool checksums = false, unsigned threads = 0,
+                         std::vector<unsigned> const &nodes = std::vector<unsigned>(), PageSize pages = SMALL_PAGES,
+                         bool compression = false );
 
          virtual ~BackupManager();
 
-         // Warning: cannot reuse the source object because its _managed_pool object is invalidated
+         // Warning: cannot reuse the source object because its _partitions are invalidated
          BackupManager & operator= ( BackupManager& arch );
 
          virtual memory::Address memAllocate( std::size_t size, SeparateMemoryAddressSpace &mem, WorkDescriptor const* wd, unsigned int copyIdx);
@@ -66,9 +167,68 @@ namespace nanos {
 
          virtual std::size_t getMemCapacity( SeparateMemoryAddressSpace& mem );
 
+         //! \brief Allocates pool memory, in the partition of the current thread if it has room.
+         void * allocateBlock ( std::size_t size );
+
+         void freeBlock ( void *address );
+
+         //! \brief Returns the usage and fragmentation counters of the whole backup pool.
+         void getPoolStats ( BackupPool::Stats &stats );
+
+         unsigned getNumPartitions () const { return _partitions.size(); }
+
+         Partition const & getPartition ( unsigned index ) const { return _partitions[index]; }
+
+         //! \brief Returns how many allocations were served by the partition of another NUMA node.
+         unsigned getSpills () const { return _spills.value(); }
+
+         bool isCompressed () const { return _compression; }
+
+         //! \brief Tells if checkpoint and restore copies compute the CRC of the data they copy.
+         bool hasChecksums () const { return _checksums; }
+
+         //! \brief Returns how many bytes of backups have been compressed, and the size of their encoding.
+         void getCompressionStats ( std::size_t &encoded, std::size_t &stored );
+
+         /*! \brief Starts the copy engine: from now on, checkpoint copies are queued and made by it,
+          *  so that they overlap with the work of the thread that issued them.
+          */
+         void startCopyEngine ();
+
+         //! \brief Stops the copy engine after the queued copies have been made.
+         void stopCopyEngine ();
+
+         bool isAsync () const { return _async; }
+
+         /*! \brief Queues a checkpoint copy for the copy engine, and adds an operation to \a ops that
+          *  completes once the copy is made. \a aborted is set if the copy could not be made.
+          */
+         void queueCheckpoint ( memory::Address devAddr, memory::Address hostAddr, std::size_t len,
+                                DeviceOps *ops, WorkDescriptor const* wd, bool *aborted = NULL );
+
+         //! \brief Makes the oldest queued checkpoint copy in the calling thread. Returns false if there was none.
+         bool runQueuedCopy ();
+
+         //! \brief Returns how many checkpoints were made asynchronously, and how many of them were made by waiting workers.
+         void getAsyncStats ( unsigned &copies, unsigned &helped ) const;
+
          //! \brief Intermediate function used to bypass a bug with GCC ipa-pure-const and inline optimizations.
          void rawCopy ( char *begin, char *end, char *dest );
 
+         //! \brief Same as rawCopy, but also feeds the copied data to a CRC-32C computation.
+         //! Data is processed in cache sized pieces, so it is only read once from memory.
+         void rawCopy ( char *begin, char *end, char *dest, crc::Crc32c &crc );
+
+         /*! \brief Retrieves (and forgets) the checksum computed for the host range [address, address+length)
+          *  during its last checkpoint or restore copy.
+          *  \returns false if no checksum is available for exactly that range, or if the copy was made for
+          *  another WD (checksums that were not taken may be older than the data).
+          */
+         bool takeChecksum ( uint64_t address, std::size_t length, WorkDescriptor const& wd, uint32_t &crc );
+
+         //! \brief Stores the checksum of the host range [address, address+length), copied for \a wd.
+         void recordChecksum ( uint64_t address, std::size_t length, uint32_t crc, WorkDescriptor const* wd );
+
          //! \brief Makes a copy of the given chunk into device memory. This should be called on checkpoint operations only.
          virtual bool checkpointCopy ( memory::Address devAddr, memory::Address hostAddr, std::size_t len, SeparateMemoryAddressSpace &mem, WorkDescriptor const* wd ) noexcept;
 
@@ -28,3 +28,17 @@ void BackupManager::rawCopy( char *begin, char *end, char *dest )
    // We cannot use memcpy (C). It has an empty exception specifier (noexcept).
    std::copy(begin, end, dest);
 }
+
+void BackupManager::rawCopy( char *begin, char *end, char *dest, crc::Crc32c &crc )
+{
+   // Checksum each piece right after copying it, while it is still cached.
+   const std::ptrdiff_t piece = 8192;
+   while ( end - begin > piece ) {
+      std::copy(begin, begin+piece, dest);
+      crc.update(dest, piece);
+      begin += piece;
+      dest += piece;
+   }
+   std::copy(begin, end, dest);
+   crc.update(dest, end - begin);
+}
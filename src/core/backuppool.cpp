@@ -0,0 +1,337 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "backuppool.hpp"
+#include "basethread.hpp"
+#include "atomic.hpp"
+#include "lock.hpp"
+
+#include <algorithm>
+#include <new>
+
+using namespace nanos;
+
+//! Bits of a shared list head that hold the position of its top block
+#define BACKUP_POOL_POSITION_BITS 36
+#define BACKUP_POOL_POSITION_MASK ( ( uint64_t(1) << BACKUP_POOL_POSITION_BITS ) - 1 )
+//! Granularity of the block positions (the alignment of the managed buffer)
+#define BACKUP_POOL_UNIT 16
+
+BackupPool::Counters::Counters() : allocated( 0 ), released( 0 ), requested( 0 ),
+   threadHits( 0 ), sharedHits( 0 ), refills( 0 ), large( 0 ), failures( 0 )
+{
+}
+
+void BackupPool::Counters::add ( Counters const &counters )
+{
+   allocated += counters.allocated;
+   released += counters.released;
+   requested += counters.requested;
+   threadHits += counters.threadHits;
+   sharedHits += counters.sharedHits;
+   refills += counters.refills;
+   large += counters.large;
+   failures += counters.failures;
+}
+
+void BackupPool::Stats::add ( Stats const &stats )
+{
+   capacity += stats.capacity;
+   used += stats.used;
+   allocated += stats.allocated;
+   requested += stats.requested;
+   cached += stats.cached;
+   free += stats.free;
+   highWater += stats.highWater;
+   threadHits += stats.threadHits;
+   sharedHits += stats.sharedHits;
+   refills += stats.refills;
+   large += stats.large;
+   failures += stats.failures;
+}
+
+BackupPool::Magazine::Magazine() : counters()
+{
+   std::fill( count, count + NUM_CLASSES, 0U );
+}
+
+BackupPool::BackupPool () : _size( 0 ), _base( NULL ), _buffer(), _numMagazines( 0 ), _magazines( NULL ),
+   _sharedCounters(), _sharedCountersLock(), _highWater( 0 )
+{
+}
+
+BackupPool::BackupPool ( void *address, std::size_t size, unsigned threads ) :
+   _size( size ), _base( static_cast<char*>( address ) ),
+   _buffer( boost::interprocess::create_only, address, size ),
+   _numMagazines( threads ), _magazines( threads > 0 ? NEW Magazine[threads] : NULL ),
+   _sharedCounters(), _sharedCountersLock(), _highWater( 0 )
+{
+}
+
+BackupPool::~BackupPool ()
+{
+   delete[] _magazines;
+}
+
+void BackupPool::swap ( BackupPool &pool )
+{
+   std::swap( _size, pool._size );
+   std::swap( _base, pool._base );
+   _buffer.swap( pool._buffer );
+   std::swap( _numMagazines, pool._numMagazines );
+   std::swap( _magazines, pool._magazines );
+   for ( unsigned c = 0; c < NUM_CLASSES; c++ ) {
+      uint64_t head = _shared[c].head.value();
+      unsigned count = _shared[c].count.value();
+      _shared[c].head = pool._shared[c].head.value();
+      _shared[c].count = pool._shared[c].count.value();
+      pool._shared[c].head = head;
+      pool._shared[c].count = count;
+   }
+   std::swap( _sharedCounters, pool._sharedCounters );
+   std::size_t highWater = _highWater.value();
+   _highWater = pool._highWater.value();
+   pool._highWater = highWater;
+}
+
+unsigned BackupPool::getClass ( std::size_t size )
+{
+   if ( size > getClassSize( NUM_CLASSES - 1 ) )
+      return NUM_CLASSES;
+   unsigned sizeClass = 0;
+   while ( getClassSize( sizeClass ) < size )
+      sizeClass++;
+   return sizeClass;
+}
+
+unsigned BackupPool::getBlockClass ( std::size_t usable )
+{
+   if ( usable >= getClassSize( NUM_CLASSES - 1 ) + LARGE_ALIGNMENT / 2 )
+      return NUM_CLASSES;
+   // The managed buffer may hand out a few more bytes than requested
+   unsigned sizeClass = NUM_CLASSES - 1;
+   while ( sizeClass > 0 && getClassSize( sizeClass ) > usable )
+      sizeClass--;
+   return sizeClass;
+}
+
+BackupPool::Magazine * BackupPool::getMagazine ()
+{
+   if ( myThread == NULL || myThread->getId() < 0 || (unsigned) myThread->getId() >= _numMagazines )
+      return NULL;
+   return &_magazines[myThread->getId()];
+}
+
+void BackupPool::push ( unsigned sizeClass, void *block )
+{
+   SharedList &list = _shared[sizeClass];
+   uint64_t position = ( static_cast<char*>( block ) - _base ) / BACKUP_POOL_UNIT + 1;
+   volatile uint64_t *next = static_cast<volatile uint64_t*>( block );
+   uint64_t head;
+   // Counted before it is pushed, so that the count never goes below the actual size
+   list.count++;
+   do {
+      head = list.head.value();
+      *next = head & BACKUP_POOL_POSITION_MASK;
+   } while ( !compareAndSwap( &list.head.override(), head,
+                              ( ( ( head >> BACKUP_POOL_POSITION_BITS ) + 1 ) << BACKUP_POOL_POSITION_BITS ) | position ) );
+}
+
+void * BackupPool::pop ( unsigned sizeClass )
+{
+   SharedList &list = _shared[sizeClass];
+   uint64_t head;
+   char *block;
+   do {
+      head = list.head.value();
+      uint64_t position = head & BACKUP_POOL_POSITION_MASK;
+      if ( position == 0 )
+         return NULL;
+      block = _base + ( position - 1 ) * BACKUP_POOL_UNIT;
+      // The block may be taken by another thread meanwhile: the tag makes the swap fail then
+      uint64_t next = *reinterpret_cast<volatile uint64_t*>( block ) & BACKUP_POOL_POSITION_MASK;
+      if ( compareAndSwap( &list.head.override(), head,
+                           ( ( ( head >> BACKUP_POOL_POSITION_BITS ) + 1 ) << BACKUP_POOL_POSITION_BITS ) | next ) )
+         break;
+   } while ( true );
+   list.count--;
+   return block;
+}
+
+void BackupPool::updateHighWater ()
+{
+   std::size_t taken = _buffer.get_size() - _buffer.get_free_memory();
+   std::size_t highWater = _highWater.value();
+   while ( taken > highWater && !compareAndSwap( &_highWater.override(), highWater, taken ) )
+      highWater = _highWater.value();
+}
+
+void BackupPool::releaseShared ()
+{
+   for ( unsigned c = 0; c < NUM_CLASSES; c++ ) {
+      void *block;
+      while ( ( block = pop( c ) ) != NULL )
+         _buffer.deallocate( block );
+   }
+}
+
+void * BackupPool::allocateFromBuffer ( std::size_t size )
+{
+   void *block = _buffer.allocate( size, std::nothrow );
+   if ( block == NULL ) {
+      // Blocks cached by other threads are not reachable, but the shared ones are
+      releaseShared();
+      block = _buffer.allocate( size, std::nothrow );
+   }
+   if ( block != NULL )
+      updateHighWater();
+   return block;
+}
+
+void * BackupPool::allocate ( std::size_t size )
+{
+   unsigned sizeClass = getClass( size );
+   Magazine *magazine = getMagazine();
+   Counters counters;
+   void *block = NULL;
+   std::size_t blockSize = 0;
+
+   if ( sizeClass == NUM_CLASSES ) {
+      std::size_t rounded = ( size + LARGE_ALIGNMENT - 1 ) / LARGE_ALIGNMENT * LARGE_ALIGNMENT;
+      block = allocateFromBuffer( rounded );
+      if ( block != NULL ) {
+         blockSize = _buffer.get_segment_manager()->size( block );
+         counters.large++;
+      }
+   } else if ( magazine != NULL ) {
+      blockSize = getClassSize( sizeClass );
+      void **blocks = magazine->blocks[sizeClass];
+      unsigned &count = magazine->count[sizeClass];
+      if ( count > 0 ) {
+         counters.threadHits++;
+      } else {
+         // Take half a magazine from the shared list, or from the managed buffer
+         void *shared;
+         while ( count < MAGAZINE_SIZE / 2 && ( shared = pop( sizeClass ) ) != NULL )
+            blocks[count++] = shared;
+         if ( count > 0 ) {
+            counters.sharedHits++;
+         } else {
+            unsigned refill = std::max( std::min( REFILL_SIZE / blockSize, (std::size_t) MAGAZINE_SIZE / 2 ), (std::size_t) 1 );
+            void *fresh;
+            while ( count < refill && ( fresh = allocateFromBuffer( blockSize ) ) != NULL )
+               blocks[count++] = fresh;
+            if ( count > 0 )
+               counters.refills++;
+         }
+      }
+      if ( count > 0 )
+         block = blocks[--count];
+   } else {
+      blockSize = getClassSize( sizeClass );
+      block = pop( sizeClass );
+      if ( block != NULL ) {
+         counters.sharedHits++;
+      } else {
+         block = allocateFromBuffer( blockSize );
+         if ( block != NULL )
+            counters.refills++;
+      }
+   }
+
+   if ( block != NULL ) {
+      counters.allocated = blockSize;
+      counters.requested = size;
+   } else {
+      counters.failures++;
+   }
+
+   account( magazine, counters );
+   return block;
+}
+
+void BackupPool::account ( Magazine *magazine, Counters const &counters )
+{
+   if ( magazine != NULL ) {
+      magazine->counters.add( counters );
+   } else {
+      LockBlock lock( _sharedCountersLock );
+      _sharedCounters.add( counters );
+   }
+}
+
+void BackupPool::deallocate ( void *address )
+{
+   if ( address == NULL )
+      return;
+
+   Magazine *magazine = getMagazine();
+   Counters counters;
+   std::size_t usable = _buffer.get_segment_manager()->size( address );
+   unsigned sizeClass = getBlockClass( usable );
+
+   if ( sizeClass == NUM_CLASSES ) {
+      _buffer.deallocate( address );
+      counters.released = usable;
+   } else if ( magazine != NULL ) {
+      void **blocks = magazine->blocks[sizeClass];
+      unsigned &count = magazine->count[sizeClass];
+      if ( count == MAGAZINE_SIZE ) {
+         // Give half of the magazine to the other threads
+         while ( count > MAGAZINE_SIZE / 2 )
+            push( sizeClass, blocks[--count] );
+      }
+      blocks[count++] = address;
+      counters.released = getClassSize( sizeClass );
+   } else {
+      push( sizeClass, address );
+      counters.released = getClassSize( sizeClass );
+   }
+   account( magazine, counters );
+}
+
+void BackupPool::getStats ( Stats &stats )
+{
+   Counters total;
+   std::size_t cached = 0;
+   for ( unsigned m = 0; m < _numMagazines; m++ ) {
+      total.add( _magazines[m].counters );
+      for ( unsigned c = 0; c < NUM_CLASSES; c++ )
+         cached += _magazines[m].count[c] * getClassSize( c );
+   }
+   {
+      LockBlock lock( _sharedCountersLock );
+      total.add( _sharedCounters );
+   }
+   for ( unsigned c = 0; c < NUM_CLASSES; c++ )
+      cached += _shared[c].count.value() * getClassSize( c );
+
+   stats.capacity = _size;
+   stats.used = total.allocated - total.released;
+   stats.allocated = total.allocated;
+   stats.requested = total.requested;
+   stats.cached = cached;
+   stats.free = _base != NULL ? _buffer.get_free_memory() : 0;
+   stats.highWater = _highWater.value();
+   stats.threadHits = total.threadHits;
+   stats.sharedHits = total.sharedHits;
+   stats.refills = total.refills;
+   stats.large = total.large;
+   stats.failures = total.failures;
+}
@@ -0,0 +1,197 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef BACKUPPOOL_HPP_
+#define BACKUPPOOL_HPP_
+
+#include "atomic_decl.hpp"
+#include "lock_decl.hpp"
+#include "allocator_decl.hpp"
+
+#include <boost/interprocess/managed_external_buffer.hpp>
+#include <boost/interprocess/indexes/null_index.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace boost {
+   namespace interprocess {
+
+      typedef boost::interprocess::basic_managed_external_buffer
+            <char
+            ,rbtree_best_fit<mutex_family,offset_ptr<void> >
+            ,null_index
+            > managed_buffer;
+   }
+}
+
+namespace nanos {
+
+   /*!
+    * \brief Memory pool that stores the task backups.
+    *
+    * Backups are carved from a managed buffer, whose allocations are serialized
+    * by a mutex and walk a tree of free blocks. Small blocks are rounded up to
+    * a power of two and recycled instead: every thread keeps a magazine of free
+    * blocks of each size class, that only it accesses, and exchanges half of it
+    * with lock-free lists shared by all threads when it gets empty or full. The
+    * managed buffer is only used to refill the size classes, a few blocks at a
+    * time, and for large blocks.
+    *
+    * Threads that do not have a magazine (those created after the pool) use
+    * the shared lists directly.
+    */
+   class BackupPool {
+      public:
+         //! Number of size classes: 64 bytes to 64 Kbytes
+         static const unsigned    NUM_CLASSES = 11;
+         //! Smallest block size, as a power of two
+         static const unsigned    MIN_CLASS_SHIFT = 6;
+         //! Free blocks of each size class kept by a thread
+         static const unsigned    MAGAZINE_SIZE = 32;
+         //! Bytes taken from the managed buffer at once to refill a size class
+         static const std::size_t REFILL_SIZE = 64*1024;
+         //! Large blocks are rounded up to this size, so that they are never mistaken
+         //! for blocks of the largest class (which may be a few bytes larger than the class)
+         static const std::size_t LARGE_ALIGNMENT = 4096;
+
+         //! Usage and fragmentation counters of the pool.
+         struct Stats {
+            std::size_t capacity;      //!< Size of the managed buffer
+            std::size_t used;          //!< Bytes of the blocks currently handed out
+            std::size_t allocated;     //!< Bytes of all the blocks handed out so far
+            std::size_t requested;     //!< Bytes requested for those blocks (the rest is padding)
+            std::size_t cached;        //!< Bytes of free blocks kept in the size classes
+            std::size_t free;          //!< Bytes left in the managed buffer
+            std::size_t highWater;     //!< Largest amount of bytes taken from the managed buffer
+            uint64_t    threadHits;    //!< Allocations served by the magazine of the thread
+            uint64_t    sharedHits;    //!< Allocations served by the shared lists
+            uint64_t    refills;       //!< Allocations that had to refill a size class from the buffer
+            uint64_t    large;         //!< Allocations too large for the size classes
+            uint64_t    failures;      //!< Allocations that did not fit in the pool
+
+            //! \brief Accumulates the counters of another pool (high-water marks are added up).
+            void add ( Stats const &stats );
+         };
+
+      private:
+         //! Allocation counters of a thread.
+         struct Counters {
+            std::size_t allocated;
+            std::size_t released;
+            std::size_t requested;
+            uint64_t    threadHits;
+            uint64_t    sharedHits;
+            uint64_t    refills;
+            uint64_t    large;
+            uint64_t    failures;
+
+            Counters();
+
+            void add ( Counters const &counters );
+         };
+
+         //! Free blocks and counters of a thread. Only accessed by its thread.
+         struct Magazine {
+            void       *blocks[NUM_CLASSES][MAGAZINE_SIZE];
+            unsigned    count[NUM_CLASSES];
+            Counters    counters;
+            char        pad[NANOS_CACHELINE];
+
+            Magazine();
+         };
+
+         /*! \brief Lock-free stack of free blocks of a size class.
+          *  The head packs the position of the top block, in 16 byte units
+          *  from the beginning of the buffer, with a tag that changes on every
+          *  update so that a stale head is never mistaken for the current one.
+          *  Each free block stores the packed position of the next one.
+          */
+         struct SharedList {
+            Atomic<uint64_t> head;
+            Atomic<unsigned> count;
+            char             pad[NANOS_CACHELINE];
+
+            SharedList() : head( 0 ), count( 0 ) {}
+         };
+
+         std::size_t                          _size;
+         char                                *_base;
+         boost::interprocess::managed_buffer  _buffer;
+         unsigned                             _numMagazines;
+         Magazine                            *_magazines;
+         SharedList                           _shared[NUM_CLASSES];
+         Counters                             _sharedCounters;   //!< Counters of threads without a magazine
+         Lock                                 _sharedCountersLock;
+         Atomic<std::size_t>                  _highWater;
+
+         BackupPool( BackupPool const& );
+         BackupPool & operator= ( BackupPool const& );
+
+         //! \brief Returns the size class of a request, or NUM_CLASSES if it is too large.
+         static unsigned getClass ( std::size_t size );
+
+         //! \brief Returns the size class of a block of the given usable size, or NUM_CLASSES if it is a large block.
+         static unsigned getBlockClass ( std::size_t usable );
+
+         //! \brief Returns the size of the blocks of a class.
+         static std::size_t getClassSize ( unsigned sizeClass ) { return std::size_t(1) << ( sizeClass + MIN_CLASS_SHIFT ); }
+
+         //! \brief Returns the magazine of the current thread, or NULL if it has none.
+         Magazine * getMagazine ();
+
+         void push ( unsigned sizeClass, void *block );
+         void * pop ( unsigned sizeClass );
+
+         //! \brief Allocates from the managed buffer. Frees the shared lists and retries if it is full.
+         void * allocateFromBuffer ( std::size_t size );
+
+         //! \brief Gives the blocks of the shared lists back to the managed buffer.
+         void releaseShared ();
+
+         void updateHighWater ();
+
+         //! \brief Adds the counters of an operation to those of the current thread.
+         void account ( Magazine *magazine, Counters const &counters );
+
+      public:
+         BackupPool ();
+
+         //! \brief Creates a pool in the given memory range, with a magazine for the first \a threads threads.
+         BackupPool ( void *address, std::size_t size, unsigned threads );
+
+         ~BackupPool ();
+
+         //! \brief Exchanges the contents of two pools, that must not be in use.
+         void swap ( BackupPool &pool );
+
+         //! \brief Returns a block of at least \a size bytes, or NULL if the pool is full.
+         void * allocate ( std::size_t size );
+
+         void deallocate ( void *address );
+
+         std::size_t getSize () const { return _size; }
+
+         //! \brief Returns a snapshot of the pool counters. Counters of other threads may be slightly outdated.
+         void getStats ( Stats &stats );
+   };
+
+} // namespace nanos
+
+#endif /* BACKUPPOOL_HPP_ */
@@ -55,14 +55,20 @@ BackupPrivateCopy::~BackupPrivateCopy()
    }
 }
 
-void BackupPrivateCopy::checkpoint( const WorkDescriptor* wd )
+void BackupPrivateCopy::checkpoint( const WorkDescriptor* wd, DeviceOps* ops )
 {
    NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-checkpoint") );
    NANOS_INSTRUMENT ( nanos_event_value_t val = (nanos_event_value_t) NANOS_FT_CP_INOUT );
    NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseOpenBurstEvent ( key, val ) );
 
-   _aborted = !_device.checkpointCopy( getDeviceAddress(), getHostAddress(), getSize(),
-                                     sys.getBackupMemory(), wd );
+   if( ops != NULL && _device.isAsync() ) {
+      // This object must not move until ops completes: the engine sets _aborted
+      _aborted = false;
+      _device.queueCheckpoint( getDeviceAddress(), getHostAddress(), getSize(), ops, wd, &_aborted );
+   } else {
+      _aborted = !_device.checkpointCopy( getDeviceAddress(), getHostAddress(), getSize(),
+                                        sys.getBackupMemory(), wd );
+   }
 
    NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseCloseBurstEvent ( key, val ) );
 }
@@ -21,6 +21,7 @@
 #define BACKUP_PRIVATE_COPY_DECL
 
 #include "backupmanager_fwd.hpp"
+#include "deviceops_fwd.hpp"
 
 #include "memcachecopy_decl.hpp"
 #include "regioncache_decl.hpp"
@@ -41,7 +42,9 @@ class BackupPrivateCopy : public RemoteChunk {
 
       virtual ~BackupPrivateCopy();
 
-      void checkpoint( const WorkDescriptor* wd );
+      /* Makes the backup. With asynchronous copies, it is queued for the copy engine
+       * if \a ops is given, and it is only complete when \a ops is */
+      void checkpoint( const WorkDescriptor* wd, DeviceOps* ops = NULL );
 
       void restore( const WorkDescriptor* wd );
 
@@ -0,0 +1,762 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crcdirectory_decl.hpp"
+#include "resiliencycosts_decl.hpp"
+#include "crc/crc32c.hpp"
+#include "copydata.hpp"
+#include "regiondict.hpp"
+#include "lock.hpp"
+#include "atomic.hpp"
+#include "debug.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace nanos;
+
+static uint32_t computeCRC( CRCDirectory::Run const &run )
+{
+   crc::Crc32c crc;
+   crc.update( reinterpret_cast<void const*>( run.address ), run.length );
+   return crc.finalize();
+}
+
+//! Epoch of blocks hashed without soft-dirty tracking, which never match the current one
+#define CRC_DIRECTORY_NO_EPOCH ( ~0U )
+
+//! Number of slots of the first object table
+#define CRC_DIRECTORY_INITIAL_SLOTS 64
+
+static std::size_t hashKey( uint64_t key )
+{
+   // Objects are at least word aligned: drop the alignment bits and spread the rest
+   return ( key >> 3 ) * 0x9E3779B97F4A7C15ULL >> 16;
+}
+
+//! \brief Removes from a map of pieces (stored checksums or blocks) every piece that overlaps a run.
+template < class Map >
+static void eraseOverlapping( Map &pieces, CRCDirectory::Run const &run )
+{
+   typename Map::iterator it = pieces.lower_bound( run.address );
+   if ( it != pieces.begin() ) {
+      typename Map::iterator prev = it;
+      --prev;
+      if ( prev->first + prev->second.length > run.address )
+         it = prev;
+   }
+   while ( it != pieces.end() && it->first < run.address + run.length ) {
+      pieces.erase( it++ );
+   }
+}
+
+uint32_t CRCDirectory::Segment::getCRC( bool &repaired )
+{
+   repaired = !( crc[0] == crc[1] && crc[1] == crc[2] );
+   if ( repaired ) {
+      setCRC( ( crc[0] == crc[1] || crc[0] == crc[2] ) ? crc[0] : crc[1] );
+   }
+   return crc[0];
+}
+
+CRCDirectory::Table::Table( std::size_t s ) : size( s ), used( 0 ), slots( NEW Object * volatile[s] ), next( NULL )
+{
+   for ( std::size_t i = 0; i < size; i++ )
+      slots[i] = NULL;
+}
+
+CRCDirectory::Table::~Table()
+{
+   for ( std::size_t i = 0; i < size; i++ )
+      delete slots[i];
+   delete[] slots;
+}
+
+CRCDirectory::CRCDirectory() : _tables( NULL ), _insertLock(), _hits( 0 ), _misses( 0 ),
+   _collisions( 0 ), _repairs( 0 ), _mismatches( 0 ), _reused( 0 ), _sampled( 0 ), _sampledBytes( 0 ),
+   _sampledTotal( 0 ), _tracker(), _trackerLock(), _blockSize( 0 ), _blockMin( 0 ), _samplePeriod( 1 )
+{
+}
+
+CRCDirectory::~CRCDirectory()
+{
+   for ( int slot = 0; slot < CRC_DIRECTORY_JOB_SLOTS; slot++ ) {
+      if ( _jobSlots[slot].job != NULL && _jobSlots[slot].job->_output )
+         delete _jobSlots[slot].job;
+   }
+   while ( _tables != NULL ) {
+      Table *next = _tables->next;
+      delete _tables;
+      _tables = next;
+   }
+}
+
+CRCDirectory::Object * CRCDirectory::find( Table *table, uint64_t key )
+{
+   const std::size_t mask = table->size - 1;
+   std::size_t slot = hashKey( key ) & mask;
+   for ( std::size_t probe = 0; probe < table->size; probe++ ) {
+      Object *object = table->slots[slot];
+      // Objects are never removed, so an empty slot ends the search
+      if ( object == NULL ) return NULL;
+      if ( object->key == key ) return object;
+      _collisions++;
+      slot = ( slot + 1 ) & mask;
+   }
+   return NULL;
+}
+
+CRCDirectory::Object & CRCDirectory::getObject( uint64_t key )
+{
+   for ( Table *table = _tables; table != NULL; table = table->next ) {
+      Object *object = find( table, key );
+      if ( object != NULL ) return *object;
+   }
+
+   LockBlock lock( _insertLock );
+
+   // Another thread may have created the object meanwhile
+   Table *last = NULL;
+   for ( Table *table = _tables; table != NULL; table = table->next ) {
+      Object *object = find( table, key );
+      if ( object != NULL ) return *object;
+      last = table;
+   }
+
+   if ( last == NULL || ( last->used + 1 ) * 2 > last->size ) {
+      Table *table = NEW Table( last == NULL ? CRC_DIRECTORY_INITIAL_SLOTS : last->size * 2 );
+      memoryFence();
+      if ( last == NULL ) _tables = table;
+      else last->next = table;
+      last = table;
+   }
+
+   Object *object = NEW Object( key );
+   const std::size_t mask = last->size - 1;
+   std::size_t slot = hashKey( key ) & mask;
+   while ( last->slots[slot] != NULL )
+      slot = ( slot + 1 ) & mask;
+
+   // Publish the object once it is completely built
+   memoryFence();
+   last->slots[slot] = object;
+   last->used++;
+   return *object;
+}
+
+uint32_t CRCDirectory::getCRC( Segment &segment )
+{
+   bool repaired;
+   uint32_t crc = segment.getCRC( repaired );
+   if ( repaired ) {
+      _repairs++;
+      debug( "Resiliency: corrupted copy of a stored CRC repaired by majority vote" );
+   }
+   return crc;
+}
+
+uint64_t CRCDirectory::getKey( global_reg_t const &reg )
+{
+   return reg.key != NULL ? reg.key->getKeyBaseAddress().value() : 0;
+}
+
+void CRCDirectory::getRuns( CopyData const &cd, RunList &runs )
+{
+   nanos_region_dimension_internal_t const *dims = cd.getDimensions();
+   const int numDims = cd.getNumDimensions();
+
+   // The first dimension is expressed in bytes, the rest in elements of the previous one
+   std::vector<std::size_t> stride( numDims, 1 );
+   uint64_t first = cd.getBaseAddress().value() + dims[0].lower_bound;
+   std::size_t numRows = 1;
+   for ( int i = 1; i < numDims; i++ ) {
+      stride[i] = stride[i-1] * dims[i-1].size;
+      first += dims[i].lower_bound * stride[i];
+      numRows *= dims[i].accessed_length;
+   }
+
+   if ( dims[0].accessed_length == 0 )
+      return;
+
+   std::vector<std::size_t> index( numDims, 0 );
+   for ( std::size_t row = 0; row < numRows; row++ ) {
+      uint64_t address = first;
+      for ( int i = 1; i < numDims; i++ )
+         address += index[i] * stride[i];
+
+      if ( !runs.empty() && runs.back().address + runs.back().length == address ) {
+         runs.back().length += dims[0].accessed_length;
+      } else {
+         runs.push_back( Run( address, dims[0].accessed_length ) );
+      }
+
+      // Advance to the next row
+      for ( int i = 1; i < numDims; i++ ) {
+         if ( ++index[i] < dims[i].accessed_length ) break;
+         index[i] = 0;
+      }
+   }
+}
+
+void CRCDirectory::insert( Object &object, reg_t region, Run const &run, uint32_t crc )
+{
+   // What is left of a partially overwritten piece can not be checked anymore
+   eraseOverlapping( object.segments, run );
+   // Nor can the blocks of the data it replaces
+   eraseOverlapping( object.blocks, run );
+
+   Segment &segment = object.segments[run.address];
+   segment.length = run.length;
+   segment.region = region;
+   segment.setCRC( crc );
+}
+
+void CRCDirectory::insertIfFree( segment_map_t &segments, reg_t region, Run const &run, uint32_t crc )
+{
+   segment_map_t::iterator it = segments.lower_bound( run.address );
+   if ( it != segments.end() && it->first < run.address + run.length )
+      return;
+   if ( it != segments.begin() ) {
+      --it;
+      if ( it->first + it->second.length > run.address )
+         return;
+   }
+
+   Segment &segment = segments[run.address];
+   segment.length = run.length;
+   segment.region = region;
+   segment.setCRC( crc );
+}
+
+void CRCDirectory::update( global_reg_t const &reg, Run const &run )
+{
+   if ( run.length == 0 ) return;
+
+   uint32_t crc = computeCRC( run );
+
+   Object &object = getObject( getKey( reg ) );
+   LockBlock lock( object.lock );
+   insert( object, reg.id, run, crc );
+}
+
+bool CRCDirectory::check( global_reg_t const &reg, Run const &run, uint32_t crc, bool &mismatch )
+{
+   const uint64_t end = run.address + run.length;
+
+   Object &object = getObject( getKey( reg ) );
+   LockBlock lock( object.lock );
+   segment_map_t &segments = object.segments;
+
+   // Nothing stored yet: keep the checksum for later readers
+   segment_map_t::iterator it = segments.lower_bound( run.address );
+   if ( ( it == segments.end() || it->first >= end )
+        && ( it == segments.begin() || std::prev( it )->first + std::prev( it )->second.length <= run.address ) ) {
+      _misses++;
+      mismatch = false;
+      insert( object, reg.id, run, crc );
+      return true;
+   }
+
+   // Otherwise the run must be exactly tiled by stored pieces
+   if ( it == segments.end() || it->first != run.address ) return false;
+   uint64_t position = run.address;
+   uint32_t expected = 0;
+   while ( position < end ) {
+      if ( it == segments.end() || it->first != position || position + it->second.length > end )
+         return false;
+      expected = ( position == run.address ) ? getCRC( it->second )
+               : crc::Crc32cEngine::combine( expected, getCRC( it->second ), it->second.length );
+      position += it->second.length;
+      ++it;
+   }
+
+   _hits++;
+   mismatch = ( expected != crc );
+   if ( mismatch ) {
+      // Keep the stored checksum: it tells what the data has to be restored to
+      _mismatches++;
+      debug( "Resiliency: CRC mismatch in region ", reg.id, " [", (void *) run.address, ", +", run.length, ")" );
+   }
+   return true;
+}
+
+bool CRCDirectory::verify( global_reg_t const &reg, Run const &run )
+{
+   //! Part of the run, with the checksum stored for it (if any)
+   struct Piece {
+      Run      run;
+      bool     stored;
+      uint32_t crc;
+      Piece( uint64_t address, std::size_t length, bool s, uint32_t c ) : run( address, length ), stored( s ), crc( c ) {}
+   };
+   std::vector<Piece> pieces;
+
+   const uint64_t end = run.address + run.length;
+   Object &object = getObject( getKey( reg ) );
+
+   {
+      LockBlock lock( object.lock );
+      segment_map_t &segments = object.segments;
+
+      uint64_t position = run.address;
+      segment_map_t::iterator it = segments.lower_bound( run.address );
+      if ( it != segments.begin() ) {
+         segment_map_t::const_iterator prev = it;
+         --prev;
+         // A piece that starts before the run can not be checked
+         position = std::max( position, std::min<uint64_t>( prev->first + prev->second.length, end ) );
+      }
+      for ( ; it != segments.end() && it->first < end; ++it ) {
+         if ( it->first > position )
+            pieces.push_back( Piece( position, it->first - position, false, 0 ) );
+
+         const uint64_t segmentEnd = it->first + it->second.length;
+         // A piece that ends after the run can not be checked either
+         if ( segmentEnd <= end )
+            pieces.push_back( Piece( it->first, it->second.length, true, getCRC( it->second ) ) );
+         position = std::min( segmentEnd, end );
+      }
+      if ( position < end )
+         pieces.push_back( Piece( position, end - position, false, 0 ) );
+   }
+
+   // Hash outside the critical section
+   bool corrupted = false;
+   for ( std::vector<Piece>::iterator it = pieces.begin(); it != pieces.end(); ++it ) {
+      uint32_t crc = computeCRC( it->run );
+      if ( !it->stored ) {
+         _misses++;
+      } else if ( crc != it->crc ) {
+         _hits++;
+         _mismatches++;
+         debug( "Resiliency: CRC mismatch in region ", reg.id, " [", (void *) it->run.address, ", +", it->run.length, ")" );
+         corrupted = true;
+      } else {
+         _hits++;
+      }
+      it->crc = crc;
+   }
+
+   // Only pieces that had no checksum are stored: the others keep the one they must match
+   LockBlock lock( object.lock );
+   segment_map_t &segments = object.segments;
+   for ( std::vector<Piece>::const_iterator it = pieces.begin(); it != pieces.end(); ++it ) {
+      if ( !it->stored )
+         insertIfFree( segments, reg.id, it->run, it->crc );
+   }
+   return corrupted;
+}
+
+void CRCDirectory::locate( global_reg_t const &reg, Run const &run, DamageList &damage )
+{
+   DamageList pieces;
+   const uint64_t end = run.address + run.length;
+   Object &object = getObject( getKey( reg ) );
+
+   {
+      LockBlock lock( object.lock );
+      blocks_map_t::const_iterator blocks = object.blocks.find( run.address );
+      if ( blocks != object.blocks.end() && blocks->second.length == run.length ) {
+         // Narrow the damage down to the blocks of the run
+         for ( std::size_t block = 0; block < blocks->second.crc.size(); block++ ) {
+            const uint64_t address = run.address + block * _blockSize;
+            pieces.push_back( Damage( address, std::min<uint64_t>( _blockSize, end - address ), blocks->second.crc[block] ) );
+         }
+      } else {
+         for ( segment_map_t::iterator it = object.segments.lower_bound( run.address );
+               it != object.segments.end() && it->first + it->second.length <= end; ++it ) {
+            pieces.push_back( Damage( it->first, it->second.length, getCRC( it->second ) ) );
+         }
+      }
+   }
+
+   for ( DamageList::const_iterator it = pieces.begin(); it != pieces.end(); ++it ) {
+      if ( computeCRC( it->run ) != it->crc )
+         damage.push_back( *it );
+   }
+}
+
+void CRCDirectory::getStats( Stats &stats ) const
+{
+   stats.hits = _hits.value();
+   stats.misses = _misses.value();
+   stats.collisions = _collisions.value();
+   stats.repairs = _repairs.value();
+   stats.mismatches = _mismatches.value();
+   stats.reused = _reused.value();
+   stats.sampled = _sampled.value();
+   stats.sampledBytes = _sampledBytes.value();
+   stats.sampledTotal = _sampledTotal.value();
+}
+
+bool CRCDirectory::work( CRCJob &job )
+{
+   bool last = false;
+   if ( !job.work( last ) ) return false;
+   if ( last && job._output ) commit( job );
+   return true;
+}
+
+void CRCDirectory::commit( CRCJob &job )
+{
+   for ( unsigned run = 0; run < job.getNumRuns(); run++ ) {
+      Object &object = getObject( job._keys[run] );
+      {
+         LockBlock lock( object.lock );
+         // Jobs may finish out of order: never overwrite the checksum of newer data
+         if ( stamp( object, job._runs[run], job._tickets[run] ) ) {
+            insert( object, job._regions[run].id, job._runs[run], job.getCRC( run ) );
+            if ( job._tracked[run] ) storeBlocks( object, job, run );
+         }
+         // Jobs submitted from now on are newer than anything stored
+         if ( --object.pending == 0 ) object.stamps.clear();
+      }
+   }
+   memoryFence();
+   job._committed = true;
+}
+
+bool CRCDirectory::stamp( Object &object, Run const &run, unsigned ticket )
+{
+   const uint64_t end = run.address + run.length;
+
+   stamp_map_t::iterator first = object.stamps.lower_bound( run.address );
+   if ( first != object.stamps.begin() ) {
+      stamp_map_t::iterator prev = first;
+      --prev;
+      if ( prev->first + prev->second.length > run.address )
+         first = prev;
+   }
+   stamp_map_t::iterator last = first;
+   for ( ; last != object.stamps.end() && last->first < end; ++last ) {
+      if ( last->second.ticket > ticket ) return false;
+   }
+
+   // Older stamps keep the parts the run does not cover, against even older jobs
+   if ( first != last ) {
+      stamp_map_t::iterator back = last;
+      --back;
+      const uint64_t backEnd = back->first + back->second.length;
+      const unsigned backTicket = back->second.ticket;
+      if ( first->first < run.address ) {
+         first->second.length = run.address - first->first;
+         ++first;
+      }
+      object.stamps.erase( first, last );
+      if ( backEnd > end ) {
+         Stamp &tail = object.stamps[end];
+         tail.length = backEnd - end;
+         tail.ticket = backTicket;
+      }
+   }
+
+   Stamp &stamp = object.stamps[run.address];
+   stamp.length = run.length;
+   stamp.ticket = ticket;
+   return true;
+}
+
+void CRCDirectory::storeBlocks( Object &object, CRCJob const &job, unsigned run )
+{
+   Run const &stored = job._runs[run];
+   eraseOverlapping( object.blocks, stored );
+
+   Blocks &blocks = object.blocks[stored.address];
+   blocks.length = stored.length;
+   blocks.epoch = job._epochs[run];
+   for ( std::vector<CRCJob::Chunk>::const_iterator chunk = job._chunks.begin() + job._firstChunk[run];
+         chunk != job._chunks.end() && chunk->run == run; ++chunk ) {
+      blocks.crc.push_back( chunk->crc );
+   }
+}
+
+void CRCDirectory::setBlocks( std::size_t blockSize, std::size_t minLength )
+{
+   _blockSize = std::max<std::size_t>( blockSize, memory::MemoryPage::size() );
+   _blockMin = std::max( minLength, _blockSize );
+}
+
+bool CRCDirectory::enableIncremental()
+{
+   return _tracker.init();
+}
+
+void CRCDirectory::enableSampling( unsigned period )
+{
+   _samplePeriod = std::max( period, 1U );
+}
+
+bool CRCDirectory::sample( global_reg_t const &reg, Run const &run, bool &mismatch )
+{
+   //! Block picked for checking, with its stored checksum
+   struct Sample {
+      Run      run;
+      uint32_t crc;
+      Sample( uint64_t address, std::size_t length, uint32_t c ) : run( address, length ), crc( c ) {}
+   };
+   std::vector<Sample> samples;
+
+   Object &object = getObject( getKey( reg ) );
+   {
+      LockBlock lock( object.lock );
+      blocks_map_t::const_iterator it = object.blocks.find( run.address );
+      if ( it == object.blocks.end() || it->second.length != run.length ) return false;
+
+      // Strided blocks from a pseudo-random start, so that every check picks different ones
+      std::vector<uint32_t> const &crc = it->second.crc;
+      uint32_t start = ( (uint32_t) reg.id ^ object.samples++ ) * 2654435761U;
+      start = ( start ^ ( start >> 16 ) ) % std::min<std::size_t>( _samplePeriod, crc.size() );
+      for ( std::size_t block = start; block < crc.size(); block += _samplePeriod ) {
+         const uint64_t address = run.address + block * _blockSize;
+         samples.push_back( Sample( address, std::min<uint64_t>( _blockSize, run.address + run.length - address ), crc[block] ) );
+      }
+   }
+
+   mismatch = false;
+   std::size_t bytes = 0;
+   for ( std::vector<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it ) {
+      bytes += it->run.length;
+      if ( computeCRC( it->run ) != it->crc ) {
+         debug( "Resiliency: CRC mismatch in region ", reg.id, " [", (void *) it->run.address, ", +", it->run.length, ")" );
+         mismatch = true;
+      }
+   }
+
+   _hits++;
+   _sampled++;
+   _sampledBytes += bytes;
+   _sampledTotal += run.length;
+   if ( mismatch ) _mismatches++;
+   return true;
+}
+
+void CRCDirectory::addOutput( CRCJob &job, global_reg_t const &reg, Run const &run, std::size_t chunkSize )
+{
+   if ( ( !_tracker.isEnabled() && _samplePeriod == 1 ) || run.length < _blockMin ) {
+      job.addRun( reg, run, chunkSize );
+      return;
+   }
+
+   job.addRun( reg, run, _blockSize );
+   const unsigned index = job.getNumRuns() - 1;
+   const unsigned first = job._firstChunk[index];
+   const std::size_t numBlocks = job._chunks.size() - first;
+   // Blocks are kept for sampled checks even if nothing tells which ones have been written
+   job._tracked[index] = true;
+   job._epochs[index] = CRC_DIRECTORY_NO_EPOCH;
+   if ( !_tracker.isEnabled() ) return;
+
+   std::vector<bool> pages;
+   unsigned epoch;
+   {
+      LockBlock lock( _trackerLock );
+      epoch = _tracker.getEpoch();
+      if ( !_tracker.getDirtyPages( memory::MemoryChunk( memory::Address( run.address ), run.length ), pages ) )
+         return;
+   }
+   job._epochs[index] = epoch;
+
+   // A block is written if any page it overlaps is dirty
+   const uint64_t firstPage = run.address / memory::MemoryPage::size();
+   std::vector<bool> written( numBlocks, false );
+   std::size_t numWritten = 0;
+   for ( std::size_t block = 0; block < numBlocks; block++ ) {
+      const uint64_t begin = run.address + block * _blockSize;
+      const uint64_t end = std::min<uint64_t>( begin + _blockSize, run.address + run.length );
+      for ( uint64_t page = begin / memory::MemoryPage::size(); page <= ( end - 1 ) / memory::MemoryPage::size(); page++ ) {
+         if ( pages[page - firstPage] ) {
+            written[block] = true;
+            numWritten++;
+            break;
+         }
+      }
+   }
+
+   Object &object = getObject( getKey( reg ) );
+   {
+      LockBlock lock( object.lock );
+      blocks_map_t::const_iterator it = object.blocks.find( run.address );
+      // Stored blocks are only meaningful if the soft-dirty bits have not been cleared since
+      if ( it != object.blocks.end() && it->second.length == run.length && it->second.epoch == epoch ) {
+         for ( std::size_t block = 0; block < numBlocks; block++ ) {
+            if ( written[block] ) continue;
+            job._chunks[first + block].cached = true;
+            job._chunks[first + block].crc = it->second.crc[block];
+            _reused++;
+         }
+      }
+   }
+
+   // Pages stay dirty until the bits are cleared: start a new epoch once most of them are
+   if ( numWritten * 2 > numBlocks ) {
+      LockBlock lock( _trackerLock );
+      if ( _tracker.getEpoch() == epoch ) _tracker.clear();
+   }
+}
+
+void CRCDirectory::submit( CRCJob *job, bool defer )
+{
+   job->_output = true;
+   for ( unsigned run = 0; run < job->getNumRuns(); run++ ) {
+      Object &object = getObject( job->_keys[run] );
+      // Counted as pending before it gets its ticket: stamps are only dropped when no older job is left
+      object.pending++;
+      job->_tickets.push_back( ++object.submitted );
+   }
+
+   if ( defer && share( *job ) ) return;
+
+   while ( work( *job ) );
+   delete job;
+}
+
+void CRCDirectory::discard( global_reg_t const &reg, Run const &run )
+{
+   Object &object = getObject( getKey( reg ) );
+   const unsigned ticket = ++object.submitted;
+
+   LockBlock lock( object.lock );
+   // Output jobs submitted before are older data: they must not store their checksums either
+   if ( object.pending.value() == 0 || stamp( object, run, ticket ) ) {
+      eraseOverlapping( object.segments, run );
+      eraseOverlapping( object.blocks, run );
+   }
+}
+
+void CRCDirectory::wait( global_reg_t const &reg )
+{
+   Object &object = getObject( getKey( reg ) );
+   while ( object.pending.value() > 0 ) {
+      help();
+   }
+}
+
+bool CRCDirectory::share( CRCJob &job )
+{
+   for ( int slot = 0; slot < CRC_DIRECTORY_JOB_SLOTS; slot++ ) {
+      JobSlot &jobSlot = _jobSlots[slot];
+
+      // Output jobs stay in their slot once stored, until the slot is needed again
+      jobSlot.helpers++;
+      memoryFence();
+      CRCJob *stored = jobSlot.job;
+      const bool recycle = stored != NULL && stored->_committed
+                           && compareAndSwap( &jobSlot.job, stored, (CRCJob *) NULL );
+      jobSlot.helpers--;
+      if ( recycle ) {
+         memoryFence();
+         while ( jobSlot.helpers.value() > 0 );
+         delete stored;
+      }
+
+      // Once published, an output job may be finished and recycled at any time
+      job._slot = slot;
+      if ( jobSlot.job == NULL && compareAndSwap( &jobSlot.job, (CRCJob *) NULL, &job ) ) {
+         return true;
+      }
+   }
+   job._slot = -1;
+   return false;
+}
+
+void CRCDirectory::join( CRCJob &job )
+{
+   while ( work( job ) );
+
+   if ( job._slot >= 0 ) {
+      JobSlot &slot = _jobSlots[job._slot];
+      slot.job = NULL;
+      memoryFence();
+      // Helpers that saw the job may still be hashing their last chunk
+      while ( slot.helpers.value() > 0 );
+      job._slot = -1;
+   }
+
+   while ( !job.finished() );
+}
+
+bool CRCDirectory::help()
+{
+   bool worked = false;
+   for ( int i = 0; i < CRC_DIRECTORY_JOB_SLOTS; i++ ) {
+      JobSlot &slot = _jobSlots[i];
+      if ( slot.job == NULL ) continue;
+
+      // Register before looking at the job, so that its owner waits for us
+      slot.helpers++;
+      memoryFence();
+      CRCJob *job = slot.job;
+      if ( job != NULL ) {
+         while ( work( *job ) ) worked = true;
+      }
+      slot.helpers--;
+   }
+   return worked;
+}
+
+void CRCJob::addRun( global_reg_t const &reg, CRCDirectory::Run const &run, std::size_t chunkSize )
+{
+   const unsigned index = _runs.size();
+   _regions.push_back( reg );
+   _keys.push_back( CRCDirectory::getKey( reg ) );
+   _runs.push_back( run );
+   _firstChunk.push_back( _chunks.size() );
+   _tracked.push_back( false );
+   _epochs.push_back( 0 );
+   _bytes += run.length;
+
+   std::size_t offset = 0;
+   do {
+      Chunk chunk;
+      chunk.run = index;
+      chunk.offset = offset;
+      chunk.length = std::min( chunkSize, run.length - offset );
+      chunk.crc = 0;
+      chunk.cached = false;
+      _chunks.push_back( chunk );
+      offset += chunk.length;
+   } while ( offset < run.length );
+}
+
+bool CRCJob::work( bool &last )
+{
+   if ( _next.value() >= _chunks.size() ) return false;
+
+   const unsigned index = _next++;
+   if ( index >= _chunks.size() ) return false;
+
+   Chunk &chunk = _chunks[index];
+   if ( !chunk.cached ) {
+      // Helpers account the chunks they hash as well
+      ResiliencyCosts::Scope cost( _output ? ResiliencyCosts::CRC_COMPUTE : ResiliencyCosts::CRC_VERIFY, _type, chunk.length );
+      chunk.crc = computeCRC( CRCDirectory::Run( _runs[chunk.run].address + chunk.offset, chunk.length ) );
+   }
+   last = ( ++_done == _chunks.size() );
+   return true;
+}
+
+uint32_t CRCJob::getCRC( unsigned run ) const
+{
+   // The chunks of a run are stored one after the other
+   std::vector<Chunk>::const_iterator it = _chunks.begin() + _firstChunk[run];
+   uint32_t crc = it->crc;
+   for ( ++it; it != _chunks.end() && it->run == run; ++it )
+      crc = crc::Crc32cEngine::combine( crc, it->crc, it->length );
+   return crc;
+}
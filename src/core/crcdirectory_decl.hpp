@@ -0,0 +1,379 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef CRCDIRECTORY_DECL_HPP
+#define CRCDIRECTORY_DECL_HPP
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "lock_decl.hpp"
+#include "atomic_decl.hpp"
+#include "allocator_decl.hpp"
+#include "copydata_decl.hpp"
+#include "globalregt_decl.hpp"
+#include "newregiondirectory_decl.hpp"
+#include "memory/softdirtytracker.hpp"
+
+namespace nanos {
+
+class CRCJob;
+
+//! Number of jobs that can be shared with idle threads at the same time
+#define CRC_DIRECTORY_JOB_SLOTS 16
+
+/*!
+ * \brief Keeps the CRC-32C of the data produced by tasks, so that consumers
+ * can detect silent data corruption in their inputs.
+ *
+ * Checksums are grouped by data object (the region dictionary of the
+ * region being accessed) and stored per contiguous piece of host memory.
+ * Producers only hash the pieces they write, and consumers with a
+ * different shape check every stored piece that lies inside their own
+ * region. Pieces are combined with CRC-combine, so a consumer whose input
+ * was already hashed while copying it does not need to read it again.
+ */
+class CRCDirectory {
+   public:
+      //! Contiguous range of host memory.
+      struct Run {
+         uint64_t    address;
+         std::size_t length;
+         Run( uint64_t a, std::size_t l ) : address( a ), length( l ) {}
+      };
+      typedef std::vector<Run> RunList;
+
+      //! Part of a run whose data does not match its stored checksum.
+      struct Damage {
+         Run      run;
+         uint32_t crc;  //!< Checksum the data must have
+         Damage( uint64_t a, std::size_t l, uint32_t c ) : run( a, l ), crc( c ) {}
+      };
+      typedef std::vector<Damage> DamageList;
+
+      //! Counters of the directory activity.
+      struct Stats {
+         unsigned hits;          //!< Pieces checked against a stored checksum
+         unsigned misses;        //!< Pieces read before any checksum was stored for them
+         unsigned collisions;    //!< Extra probes needed to find a data object
+         unsigned repairs;       //!< Stored checksums fixed by majority vote
+         unsigned mismatches;    //!< Pieces whose data did not match their checksum
+         unsigned reused;        //!< Blocks of large outputs that did not need to be hashed again
+         unsigned sampled;       //!< Large inputs checked by hashing only some of their blocks
+         uint64_t sampledBytes;  //!< Bytes hashed by sampled checks
+         uint64_t sampledTotal;  //!< Bytes of the inputs checked by sampling
+      };
+
+   private:
+      /*! \brief Checksum of a contiguous piece.
+       *  Three copies are kept next to each other to outvote a corrupted one.
+       */
+      struct Segment {
+         std::size_t length;
+         reg_t       region;  //!< Region that produced this piece
+         uint32_t    crc[3];
+
+         void setCRC( uint32_t value ) { crc[0] = crc[1] = crc[2] = value; }
+         //! \brief Returns the majority value, fixing the copy that disagrees (if any).
+         uint32_t getCRC( bool &repaired );
+      };
+      typedef std::map< uint64_t, Segment > segment_map_t;
+
+      /*! \brief Checksums of the blocks of a large output.
+       *  They are the leaves of the checksum of the whole output, so that only written blocks
+       *  are hashed again and readers can check some blocks instead of the whole output.
+       */
+      struct Blocks {
+         std::size_t           length;
+         unsigned              epoch;  //!< Soft-dirty epoch in which the blocks were hashed, if tracked
+         std::vector<uint32_t> crc;
+      };
+      typedef std::map< uint64_t, Blocks > blocks_map_t;
+
+      //! Range written by the newest output job stored (or discard) that covers it.
+      struct Stamp {
+         std::size_t length;
+         unsigned    ticket;
+      };
+      typedef std::map< uint64_t, Stamp > stamp_map_t;
+
+      /*! \brief Checksums of one data object.
+       *  Each object has its own lock, padded to a cache line, so that tasks
+       *  working on different objects never contend.
+       */
+      struct Object {
+         uint64_t         key;
+         Lock             lock;
+         segment_map_t    segments;
+         blocks_map_t     blocks;
+         stamp_map_t      stamps;     //!< Tickets stored per range while output jobs are pending, protected by the lock
+         Atomic<unsigned> submitted;  //!< Ticket of the last output job submitted for this object
+         Atomic<unsigned> pending;    //!< Runs of this object whose output job has not been stored yet
+         Atomic<unsigned> samples;    //!< Sampled checks of this object, to move the blocks they pick
+         char             pad[NANOS_CACHELINE];
+
+         Object( uint64_t k ) : key( k ), lock(), segments(), blocks(), stamps(),
+            submitted( 0 ), pending( 0 ), samples( 0 ) {}
+      };
+
+      /*! \brief Open addressing table of objects.
+       *  Objects are never removed nor moved, so lookups do not take any lock.
+       *  When a table gets half full a table twice as big is chained after it,
+       *  and new objects go to the last table of the chain.
+       */
+      struct Table {
+         std::size_t       size;  //!< Number of slots, a power of two
+         std::size_t       used;
+         Object * volatile *slots;
+         Table * volatile  next;
+
+         Table( std::size_t s );
+         ~Table();
+      };
+
+      //! Job published for idle threads, with the number of threads looking at it.
+      struct JobSlot {
+         CRCJob * volatile job;
+         Atomic<unsigned>  helpers;
+         char              pad[NANOS_CACHELINE];
+
+         JobSlot() : job( NULL ), helpers( 0 ) {}
+      };
+
+      Table           *_tables;
+      Lock             _insertLock;  //!< Serializes the creation of objects
+      Atomic<unsigned> _hits;
+      Atomic<unsigned> _misses;
+      Atomic<unsigned> _collisions;
+      Atomic<unsigned> _repairs;
+      Atomic<unsigned> _mismatches;
+      Atomic<unsigned> _reused;
+      Atomic<unsigned> _sampled;
+      Atomic<uint64_t> _sampledBytes;
+      Atomic<uint64_t> _sampledTotal;
+      memory::SoftDirtyTracker _tracker;
+      Lock             _trackerLock;     //!< Keeps pages from being cleared while they are read
+      std::size_t      _blockSize;       //!< Size of the blocks of large outputs
+      std::size_t      _blockMin;        //!< Runs smaller than this are not split in blocks
+      unsigned         _samplePeriod;    //!< Sampled checks hash one block out of this many, 1 if disabled
+      JobSlot          _jobSlots[CRC_DIRECTORY_JOB_SLOTS];
+
+      //! \brief Looks for an object in the given table. Does not take any lock.
+      Object * find( Table *table, uint64_t key );
+
+      //! \brief Returns the object of a key, creating it the first time it is used.
+      Object & getObject( uint64_t key );
+
+      //! \brief Stores a piece, discarding any stored piece or blocks it overlaps. Must be called with the object lock held.
+      void insert( Object &object, reg_t region, Run const &run, uint32_t crc );
+
+      //! \brief Stores a piece unless it overlaps a stored one. Must be called with the object lock held.
+      void insertIfFree( segment_map_t &segments, reg_t region, Run const &run, uint32_t crc );
+
+      //! \brief Reads the checksum of a stored piece, accounting for repairs.
+      uint32_t getCRC( Segment &segment );
+
+      /*! \brief Hashes the next chunk of a job, storing the result if it was the last chunk of an output job.
+       *  \returns false if all chunks have already been taken.
+       */
+      bool work( CRCJob &job );
+
+      //! \brief Stores the checksums of a finished output job, except for the runs a later job has already stored.
+      void commit( CRCJob &job );
+
+      /*! \brief Tells if no job newer than \a ticket has been stored over any part of \a run,
+       *  and if so records \a ticket for it. Must be called with the object lock held.
+       */
+      static bool stamp( Object &object, Run const &run, unsigned ticket );
+
+      //! \brief Keeps the checksums of the blocks of a tracked run. Must be called with the object lock held.
+      void storeBlocks( Object &object, CRCJob const &job, unsigned run );
+
+      CRCDirectory( CRCDirectory const & );
+      CRCDirectory & operator=( CRCDirectory const & );
+
+   public:
+      CRCDirectory();
+      ~CRCDirectory();
+
+      /*! \brief Splits the host memory accessed by a copy into contiguous runs.
+       *  Consecutive rows are merged when there is no gap between them.
+       */
+      static void getRuns( CopyData const &cd, RunList &runs );
+
+      /*! \brief Returns the key of the data object of a region: its base address.
+       *  Region dictionaries are not used as keys, since they may be freed and their memory reused for other objects.
+       */
+      static uint64_t getKey( global_reg_t const &reg );
+
+      /*! \brief Hashes a run that has just been written by region \a reg and stores its checksum.
+       *  Stored pieces that overlap the run are discarded.
+       */
+      void update( global_reg_t const &reg, Run const &run );
+
+      /*! \brief Checks an already computed checksum against the stored ones, without reading memory.
+       *  If no stored piece overlaps the run, the checksum is stored for later readers.
+       *  Stored checksums are kept on a mismatch, so that the data can be restored and checked again.
+       *  \returns false if the stored pieces cover the run only in part. Otherwise sets
+       *  \a mismatch to tell if the data has been corrupted.
+       */
+      bool check( global_reg_t const &reg, Run const &run, uint32_t crc, bool &mismatch );
+
+      /*! \brief Hashes a run that is about to be read and checks it against the stored pieces.
+       *  Parts of the run that have no checksum yet are stored, so that later readers can be checked.
+       *  \returns true if silent data corruption has been detected.
+       */
+      bool verify( global_reg_t const &reg, Run const &run );
+
+      /*! \brief Hashes a run again to find the stored pieces whose data does not match, with the checksum they must have.
+       *  Runs stored in blocks are narrowed down to their corrupted blocks.
+       */
+      void locate( global_reg_t const &reg, Run const &run, DamageList &damage );
+
+      //! \brief Returns a snapshot of the directory counters.
+      void getStats( Stats &stats ) const;
+
+      //! \brief Sets the size of the blocks in which outputs of at least \a minLength bytes are hashed.
+      void setBlocks( std::size_t blockSize, std::size_t minLength );
+
+      /*! \brief Enables hashing again only the blocks of large outputs that have been written.
+       *  \returns false if the kernel can not tell which pages have been written.
+       */
+      bool enableIncremental();
+
+      /*! \brief Makes large inputs be checked by hashing one block out of \a period.
+       *  Each check starts at a different block, so that repeated reads cover the whole input.
+       */
+      void enableSampling( unsigned period );
+
+      //! \brief Tells if a run is large enough to be checked by sampling.
+      bool isSampled( Run const &run ) const { return _samplePeriod > 1 && run.length >= _blockMin; }
+
+      /*! \brief Checks some blocks of a run against the block checksums stored by its producer.
+       *  \returns false if the producer did not store blocks for exactly this run. Otherwise
+       *  sets \a mismatch to tell if corruption has been found in the sampled blocks.
+       */
+      bool sample( global_reg_t const &reg, Run const &run, bool &mismatch );
+
+      /*! \brief Adds a run just written by region \a reg to an output job.
+       *  Large runs are hashed in blocks, whose checksums are stored too. With incremental
+       *  hashing enabled, the blocks of a large run that have not been written since it was
+       *  last hashed take their stored checksum instead of being hashed.
+       */
+      void addOutput( CRCJob &job, global_reg_t const &reg, Run const &run, std::size_t chunkSize );
+
+      /*! \brief Stores the checksums of the runs of an output job, taking ownership of it.
+       *  If \a defer is set the job is hashed by idle threads, or by the first reader
+       *  of its data, and stored when its last chunk is done.
+       */
+      void submit( CRCJob *job, bool defer );
+
+      /*! \brief Forgets the checksums of a run that has just been written by region \a reg without hashing it.
+       *  Later readers store the checksum of what they find.
+       */
+      void discard( global_reg_t const &reg, Run const &run );
+
+      /*! \brief Waits until the output jobs submitted for the data object of \a reg have been stored.
+       *  Shared jobs are hashed meanwhile.
+       */
+      void wait( global_reg_t const &reg );
+
+      /*! \brief Lets idle threads hash the chunks of a job.
+       *  \returns false if there is no free slot, in which case the job is not shared.
+       */
+      bool share( CRCJob &job );
+
+      /*! \brief Hashes the chunks of a job that are still pending and waits for the helpers.
+       *  The job is withdrawn, so it can be destroyed when this returns.
+       */
+      void join( CRCJob &job );
+
+      /*! \brief Hashes chunks of the shared jobs. Called by threads that have nothing else to do.
+       *  \returns true if some chunk has been hashed.
+       */
+      bool help();
+};
+
+/*!
+ * \brief Checksums of a set of runs, computed in chunks.
+ *
+ * Runs are split in chunks of the same size, so that several threads can
+ * hash a large run at the same time. The checksum of each run is then
+ * built from its chunks with CRC-combine.
+ */
+class CRCJob {
+   private:
+      //! Part of a run that is hashed at once
+      struct Chunk {
+         unsigned    run;
+         std::size_t offset;
+         std::size_t length;
+         uint32_t    crc;
+         bool        cached;  //!< The checksum is already known, the chunk does not need to be read
+      };
+
+      std::vector<global_reg_t> _regions;
+      std::vector<uint64_t>     _keys;  //!< Object of each run, which outlives the region dictionary
+      CRCDirectory::RunList     _runs;
+      std::vector<Chunk>        _chunks;
+      std::vector<unsigned>     _firstChunk;  //!< Index of the first chunk of each run
+      std::size_t               _bytes;
+      Atomic<unsigned>          _next;  //!< Next chunk to be hashed
+      Atomic<unsigned>          _done;  //!< Number of chunks already hashed
+      int                       _slot;  //!< Slot of the directory where the job is shared, if any
+      bool                      _output;     //!< Owned by the directory, which stores the result
+      std::vector<unsigned>     _tickets;    //!< Order of each run among the output jobs of its object
+      volatile bool             _committed;  //!< The result of an output job has been stored
+      std::vector<bool>         _tracked;    //!< The checksums of the chunks of each run are stored as blocks
+      std::vector<unsigned>     _epochs;     //!< Soft-dirty epoch in which each tracked run was hashed
+      void                     *_type;       //!< Task type whose data is hashed, to account the cost
+
+      friend class CRCDirectory;
+
+      CRCJob( CRCJob const & );
+      CRCJob & operator=( CRCJob const & );
+
+   public:
+      explicit CRCJob( void *type = NULL ) : _regions(), _keys(), _runs(), _chunks(), _firstChunk(), _bytes( 0 ), _next( 0 ), _done( 0 ),
+         _slot( -1 ), _output( false ), _tickets(), _committed( false ), _tracked(), _epochs(), _type( type ) {}
+
+      //! \brief Adds a run accessed through region \a reg, split in chunks of at most \a chunkSize bytes.
+      void addRun( global_reg_t const &reg, CRCDirectory::Run const &run, std::size_t chunkSize );
+
+      /*! \brief Hashes the next pending chunk.
+       *  \param last set if this was the last chunk to be finished.
+       *  \returns false if all chunks have already been taken.
+       */
+      bool work( bool &last );
+
+      bool finished() { return _done.value() == _chunks.size(); }
+
+      std::size_t getNumRuns() const { return _runs.size(); }
+      std::size_t getBytes() const { return _bytes; }
+      global_reg_t const & getRegion( unsigned run ) const { return _regions[run]; }
+      CRCDirectory::Run const & getRun( unsigned run ) const { return _runs[run]; }
+
+      //! \brief Returns the checksum of a run. The job must be finished.
+      uint32_t getCRC( unsigned run ) const;
+};
+
+} // namespace nanos
+
+#endif /* CRCDIRECTORY_DECL_HPP */
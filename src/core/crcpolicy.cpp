@@ -0,0 +1,218 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crcpolicy_decl.hpp"
+#include "workdescriptor.hpp"
+#include "copydata.hpp"
+#include "lock.hpp"
+#include "atomic.hpp"
+#include "exception/failurestats.hpp"
+
+#include <algorithm>
+
+using namespace nanos;
+
+//! Executions of a task type that are protected completely while its cost is measured
+#define CRC_POLICY_WARMUP 8
+//! Executions of a task type between two updates of its plan
+#define CRC_POLICY_REPLAN 16
+//! Executions of a task type protected completely after a corruption has been detected in it
+#define CRC_POLICY_ALERT 256
+//! Copies that would be sampled less often than this are not protected at all
+#define CRC_POLICY_MAX_PERIOD 64
+
+CRCPolicy::Type::Type( void *k ) : key( k ), lock(), executions( 0 ), alert( 0 ), runTime( 0.0 ), numCopies( 0 )
+{
+   for ( unsigned i = 0; i < CRC_POLICY_MAX_COPIES; i++ ) {
+      bytes[i] = 0.0;
+      period[i] = 1;
+   }
+}
+
+CRCPolicy::CRCPolicy() : _enabled( false ), _budget( 0.0f ), _rateLock(), _usPerByte( 0.0 ),
+   _numTypes( 0 ), _protected( 0 ), _skipped( 0 )
+{
+   for ( unsigned i = 0; i < CRC_POLICY_TYPES; i++ )
+      _types[i] = NULL;
+}
+
+CRCPolicy::~CRCPolicy()
+{
+   for ( unsigned i = 0; i < CRC_POLICY_TYPES; i++ )
+      delete _types[i];
+}
+
+void CRCPolicy::enable( float budget )
+{
+   _budget = budget / 100.0f;
+   _enabled = true;
+}
+
+CRCPolicy::Type * CRCPolicy::getType( WD const &wd, bool create )
+{
+   // Tasks whose device is not chosen yet can not be told apart
+   if ( !wd.hasActiveDevice() ) return NULL;
+   void *key = (void *) wd.getActiveDevice().getWorkFct();
+
+   unsigned slot = ( (uintptr_t) key >> 4 ) * 0x9E3779B97F4A7C15ULL >> 16;
+   for ( unsigned probe = 0; probe < CRC_POLICY_TYPES; probe++ ) {
+      slot &= CRC_POLICY_TYPES - 1;
+      Type *type = _types[slot];
+      if ( type == NULL ) {
+         if ( !create ) return NULL;
+         type = NEW Type( key );
+         if ( compareAndSwap( &_types[slot], (Type *) NULL, type ) ) {
+            _numTypes++;
+            return type;
+         }
+         delete type;
+         type = _types[slot];
+      }
+      if ( type->key == key ) return type;
+      slot++;
+   }
+   // Too many task types: the rest are always protected
+   return NULL;
+}
+
+bool CRCPolicy::isSampled( unsigned period, WD const &wd, unsigned index )
+{
+   if ( period <= 1 ) return period == 1;
+
+   // Scramble the task id, so that consecutive tasks do not pick the same copies
+   uint32_t h = (uint32_t) wd.getId() * 2654435761U ^ index * 40503U;
+   h ^= h >> 15;
+   return h % period == 0;
+}
+
+CRCPolicy::Mode CRCPolicy::getMode( WD const &wd, unsigned index )
+{
+   if ( !_enabled || index >= CRC_POLICY_MAX_COPIES ) return CHECKSUM;
+   Type *type = getType( wd, false );
+   if ( type == NULL ) return CHECKSUM;
+
+   const unsigned period = type->period[index];
+   return period == 1 ? CHECKSUM : ( period == 0 ? SKIP : SAMPLE );
+}
+
+bool CRCPolicy::protect( WD const &wd, unsigned index )
+{
+   if ( !_enabled || index >= CRC_POLICY_MAX_COPIES ) return true;
+   Type *type = getType( wd, false );
+   if ( type == NULL ) return true;
+
+   return isSampled( type->period[index], wd, index );
+}
+
+void CRCPolicy::plan( Type &type )
+{
+   const double usPerByte = _usPerByte;
+   if ( type.executions < CRC_POLICY_WARMUP || type.alert > 0 || usPerByte == 0.0 ) {
+      for ( unsigned i = 0; i < type.numCopies; i++ )
+         type.period[i] = 1;
+      return;
+   }
+
+   // Spend more on protection as corruptions show up
+   const unsigned errors = std::min( error::FailureStats<error::SilentDataCorruption>::get(), 7U );
+   double left = _budget * ( 1 + errors ) * type.runTime;
+
+   // Cheapest copies first, so that the budget they do not use goes to the next ones
+   unsigned order[CRC_POLICY_MAX_COPIES];
+   for ( unsigned i = 0; i < type.numCopies; i++ )
+      order[i] = i;
+   for ( unsigned i = 1; i < type.numCopies; i++ ) {
+      for ( unsigned j = i; j > 0 && type.bytes[order[j]] < type.bytes[order[j-1]]; j-- )
+         std::swap( order[j], order[j-1] );
+   }
+
+   for ( unsigned i = 0; i < type.numCopies; i++ ) {
+      const unsigned copy = order[i];
+      const double cost = type.bytes[copy] * usPerByte;
+      const double share = left / ( type.numCopies - i );
+      if ( cost <= share ) {
+         type.period[copy] = 1;
+         left -= cost;
+         continue;
+      }
+      const double period = share > 0.0 ? cost / share : CRC_POLICY_MAX_PERIOD + 1;
+      if ( period > CRC_POLICY_MAX_PERIOD ) {
+         type.period[copy] = 0;
+      } else {
+         type.period[copy] = (unsigned) period + 1;
+         left -= cost / type.period[copy];
+      }
+   }
+}
+
+void CRCPolicy::taskRan( WD const &wd, double runTime )
+{
+   Type *type = getType( wd, true );
+   if ( type == NULL ) return;
+
+   const unsigned numCopies = std::min<std::size_t>( wd.getNumCopies(), CRC_POLICY_MAX_COPIES );
+   for ( unsigned i = 0; i < numCopies; i++ ) {
+      if ( isSampled( type->period[i], wd, i ) ) _protected++;
+      else _skipped++;
+   }
+
+   // Measuring is not worth waiting for another thread
+   if ( !type->lock.tryAcquire() ) return;
+
+   type->runTime = type->executions == 0 ? runTime : 0.875 * type->runTime + 0.125 * runTime;
+   for ( unsigned i = 0; i < numCopies; i++ ) {
+      const double bytes = wd.getCopies()[i].getSize();
+      type->bytes[i] = type->executions == 0 ? bytes : 0.875 * type->bytes[i] + 0.125 * bytes;
+   }
+   type->numCopies = numCopies;
+   type->executions++;
+   if ( type->alert > 0 ) type->alert--;
+
+   if ( type->executions >= CRC_POLICY_WARMUP && ( type->executions - CRC_POLICY_WARMUP ) % CRC_POLICY_REPLAN == 0 )
+      plan( *type );
+   type->lock.release();
+}
+
+void CRCPolicy::hashed( std::size_t bytes, double time )
+{
+   // Timing small jobs mostly measures the clock
+   if ( bytes < 4096 || !_rateLock.tryAcquire() ) return;
+   const double usPerByte = time / bytes;
+   _usPerByte = _usPerByte == 0.0 ? usPerByte : 0.875 * _usPerByte + 0.125 * usPerByte;
+   _rateLock.release();
+}
+
+void CRCPolicy::corrupted( WD const &wd )
+{
+   if ( !_enabled ) return;
+   Type *type = getType( wd, true );
+   if ( type == NULL ) return;
+
+   LockBlock lock( type->lock );
+   type->alert = CRC_POLICY_ALERT;
+   for ( unsigned i = 0; i < CRC_POLICY_MAX_COPIES; i++ )
+      type->period[i] = 1;
+}
+
+void CRCPolicy::getStats( Stats &stats ) const
+{
+   stats.types = _numTypes.value();
+   stats.protectedCopies = _protected.value();
+   stats.skippedCopies = _skipped.value();
+}
@@ -0,0 +1,136 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef CRCPOLICY_DECL_HPP
+#define CRCPOLICY_DECL_HPP
+
+#include <stddef.h>
+
+#include "lock_decl.hpp"
+#include "atomic_decl.hpp"
+#include "allocator_decl.hpp"
+#include "workdescriptor_fwd.hpp"
+
+namespace nanos {
+
+//! Number of task types (outline functions) whose cost is measured
+#define CRC_POLICY_TYPES 256
+//! Copies of a task beyond this one are always protected
+#define CRC_POLICY_MAX_COPIES 32
+
+/*!
+ * \brief Decides which task copies are worth protecting with a CRC.
+ *
+ * The policy measures, for every task type, how long its executions take
+ * and how many bytes each of its copies has, and estimates from the
+ * measured hashing throughput what checking each copy costs. Copies are
+ * then protected in every execution (checksum), one execution out of a
+ * few (sample) or never (skip), so that the hashing of a task type stays
+ * within a fraction of its run time. Task types in which corruption has
+ * been detected, and the first executions of any type, are always
+ * protected completely.
+ *
+ * Whether a copy is protected in a given execution only depends on the
+ * task and the copy index, so the input check, its prefetch and the
+ * hashing of the output agree without storing anything in the task.
+ */
+class CRCPolicy {
+   public:
+      //! How a copy is protected.
+      enum Mode { CHECKSUM, SAMPLE, SKIP };
+
+      //! Counters of the policy decisions.
+      struct Stats {
+         unsigned types;            //!< Task types being measured
+         unsigned protectedCopies;  //!< Copies of finished executions that were protected
+         unsigned skippedCopies;    //!< Copies of finished executions that were not
+      };
+
+   private:
+      /*! \brief Measurements and plan of one task type.
+       *  Measurements are only updated with the lock held. Sampling periods
+       *  are read without it: a stale period only changes one decision.
+       */
+      struct Type {
+         void * volatile   key;  //!< Outline function of the tasks
+         Lock              lock;
+         unsigned          executions;
+         unsigned          alert;     //!< Executions left with full protection after a corruption
+         double            runTime;   //!< Average run time, in microseconds
+         unsigned          numCopies;
+         double            bytes[CRC_POLICY_MAX_COPIES];
+         //! 1 protects every execution, 0 none, and n one out of n
+         volatile unsigned period[CRC_POLICY_MAX_COPIES];
+         char              pad[NANOS_CACHELINE];
+
+         Type( void *k );
+      };
+
+      bool             _enabled;
+      float            _budget;       //!< Fraction of the run time of a task that can be spent hashing
+      Type * volatile  _types[CRC_POLICY_TYPES];
+      Lock             _rateLock;
+      double           _usPerByte;    //!< Measured hashing cost, 0 until measured
+      Atomic<unsigned> _numTypes;
+      Atomic<unsigned> _protected;
+      Atomic<unsigned> _skipped;
+
+      //! \brief Returns the type of a task, creating it if \a create is set. May return NULL.
+      Type * getType( WD const &wd, bool create );
+
+      //! \brief Computes the sampling period of every copy of a type. Must be called with the type lock held.
+      void plan( Type &type );
+
+      //! \brief Tells if a copy is protected in the given execution, according to its sampling period.
+      static bool isSampled( unsigned period, WD const &wd, unsigned index );
+
+      CRCPolicy( CRCPolicy const & );
+      CRCPolicy & operator=( CRCPolicy const & );
+
+   public:
+      CRCPolicy();
+      ~CRCPolicy();
+
+      //! \brief Enables the policy. \a budget is given as a percentage of the task run time.
+      void enable( float budget );
+
+      bool isEnabled() const { return _enabled; }
+
+      //! \brief Returns how copy \a index of the tasks like \a wd is currently protected.
+      Mode getMode( WD const &wd, unsigned index );
+
+      //! \brief Tells if copy \a index of \a wd has to be checked or hashed in this execution.
+      bool protect( WD const &wd, unsigned index );
+
+      //! \brief Accounts a finished execution of \a wd that took \a runTime microseconds.
+      void taskRan( WD const &wd, double runTime );
+
+      //! \brief Accounts \a bytes hashed in \a time microseconds.
+      void hashed( std::size_t bytes, double time );
+
+      //! \brief Protects completely the tasks like \a wd, whose inputs were found corrupted.
+      void corrupted( WD const &wd );
+
+      //! \brief Returns a snapshot of the policy counters.
+      void getStats( Stats &stats ) const;
+};
+
+} // namespace nanos
+
+#endif /* CRCPOLICY_DECL_HPP */
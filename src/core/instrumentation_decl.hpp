@@ -444,6 +444,7 @@ namespace nanos {
             registerEventValue("api","stick_to_producer","nanos_stick_to_producer()");
             registerEventValue("api","task_reduction_register","nanos_task_reduction_register()");
             registerEventValue("api","task_reduction_get_thread_storage","nanos_task_reduction_get_thread_storage()");
+            registerEventValue("api","resiliency_stats","nanos_resiliency_stats()");
 
             /* 02 */ registerEventKey("wd-id","Work Descriptor id:", true, EVENT_DEVELOPER, true);
 
@@ -687,6 +688,14 @@ namespace nanos {
             registerEventValue("ft-task-operation", "NANOS_FT_RESTART", "Current task is being executed again because its execution was erroneous." ); /* 3 */
             registerEventValue("ft-task-operation", "NANOS_FT_DISCARD", "Skipping task execution due to invalidation." );                              /* 4 */
 
+            /* 76 */ registerEventKey("ft-cost", "Fault tolerance operation whose cost is accounted." );
+            registerEventValue("ft-cost", "NANOS_FT_COST_CRC_COMPUTE", "Hashing task outputs." );                  /* 1 */
+            registerEventValue("ft-cost", "NANOS_FT_COST_CRC_VERIFY",  "Checking task inputs against their CRC." );/* 2 */
+            registerEventValue("ft-cost", "NANOS_FT_COST_CHECKPOINT",  "Backing up task inputs." );                /* 3 */
+            registerEventValue("ft-cost", "NANOS_FT_COST_RESTORE",     "Restoring task inputs from backups." );    /* 4 */
+            registerEventValue("ft-cost", "NANOS_FT_COST_REEXECUTION", "Running a task again after a failure." );  /* 5 */
+            /* 77 */ registerEventKey("ft-cost-bytes", "Bytes handled by the last fault tolerance operation." );
+
             /* ** */ registerEventKey("debug","Debug Key", true, EVENT_ADVANCED ); /* Keep this key as the last one */
          }
 
@@ -55,8 +55,12 @@ MemController::MemController( WD *wd, unsigned int numCopies ) :
    , _backupOpsIn()
    , _backupOpsOut()
    , _restoreOps()
+   , _backupCopyOps( NULL )
    , _backupCacheCopies()
    , _backupInOutCopies()
+   , _backupLazyCopies()
+   , _backupMemoryAllocated( false )
+   , _inputsCheckpointed( false )
 #endif
    , _affinityScore( 0 )
    , _maxAffinityScore( 0 )
@@ -75,6 +79,14 @@ MemController::~MemController() {
       delete _backupOpsIn;
    if( _backupOpsOut )
       delete _backupOpsOut;
+   if( _backupCopyOps ) {
+      // A task discarded after its checkpoint was prefetched may still have copies queued
+      while ( !_backupCopyOps->allCompleted() ) {
+         reinterpret_cast<BackupManager&>( sys.getBackupMemory().getCache().getDevice() ).runQueuedCopy();
+      }
+      delete _backupCopyOps;
+   }
+   releaseLazyBackups();
 #endif
 }
 
@@ -150,6 +162,7 @@ void MemController::preInit( ) {
       // the workdescriptor is created
       _backupCacheCopies.reserve( _memCacheCopies.size() );
       _backupInOutCopies.reserve( _memCacheCopies.size() );
+      _backupLazyCopies.assign( _memCacheCopies.size(), (BackupLazyCopy*) NULL );
 
       for ( index = 0; index < _memCacheCopies.size(); index ++ ) {
             _backupCacheCopies.emplace_back( _wd->getCopies()[index], _memCacheCopies[index], *_wd, index );
@@ -219,6 +232,7 @@ void MemController::initialize( ProcessingElement &pe ) {
       if( sys.isResiliencyEnabled() && _wd->isRecoverable() ) {
          _backupOpsIn = NEW SeparateAddressSpaceInOps(_pe, true, sys.getBackupMemory() );
          _backupOpsOut = NEW SeparateAddressSpaceInOps(_pe, true, sys.getBackupMemory() );
+         _backupCopyOps = NEW DeviceOps();
       }
 #endif
       _initialized = true;
@@ -316,10 +330,12 @@ bool MemController::allocateTaskMemory() {
    }
 
 #ifdef NANOS_RESILIENCY_ENABLED
-   if( !_backupCacheCopies.empty() ) {
+   // Backups may have been allocated already when their checkpoint was prefetched
+   if( !_backupCacheCopies.empty() && !_backupMemoryAllocated ) {
       // TODO/FIXME: take care with reinterpret_cast if we add new members to BackupCacheCopy, as it could lead to
       // invalid memory accesses (buffer overflows, etc.)
-      result &= sys.getBackupMemory().prepareRegions( reinterpret_cast<MemCacheCopy*>(_backupCacheCopies.data()), _backupCacheCopies.size(), *_wd );
+      _backupMemoryAllocated = sys.getBackupMemory().prepareRegions( reinterpret_cast<MemCacheCopy*>(_backupCacheCopies.data()), _backupCacheCopies.size(), *_wd );
+      result &= _backupMemoryAllocated;
    }
 #endif
    return result;
@@ -339,41 +355,7 @@ void MemController::copyDataIn() {
    _inOps->issue( _wd );
 
 #ifdef NANOS_RESILIENCY_ENABLED
-   if ( !_backupCacheCopies.empty() && !_wd->isInvalid() ) {
-      ensure( _backupOpsIn, "Backup ops array has not been initialized!" );
-
-      bool queuedOps = false;
-      for (unsigned int index = 0; index < _backupCacheCopies.size(); index++) {
-         if ( _wd->getCopies()[index].isInput() ) {
-            //_backupCacheCopies[index].setVersion( _memCacheCopies[ index ].getChildrenProducedVersion() );
-            _backupCacheCopies[index]._locations.clear();
-
-            if ( _wd->getCopies()[index].isOutput() ) {
-               // For inout parameters, make a temporary independent backup. We have to do this privately, without
-               // the cache being noticed, because this backup is for exclusive use of this workdescriptor only.
-               _backupInOutCopies.emplace_back( _wd->getCopies()[index], _wd, index );
-               _backupInOutCopies.back().checkpoint( _wd );
-
-            } else {
-               _backupCacheCopies[index]._locations.push_back( std::pair<reg_t, reg_t>( _backupCacheCopies[index]._reg.id, _backupCacheCopies[index]._reg.id ) );
-               _backupCacheCopies[index]._locationDataReady = true;
-
-               _backupCacheCopies[ index ].generateInOps( *_backupOpsIn, true, false, *_wd, index);
-               queuedOps = true;
-            }
-         }
-      }
-
-      if( queuedOps ) {
-         NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-checkpoint") );
-         NANOS_INSTRUMENT ( nanos_event_value_t val = (nanos_event_value_t) NANOS_FT_CP_IN );
-         NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseOpenBurstEvent ( key, val ) );
-
-         _backupOpsIn->issue(_wd);
-
-         NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseCloseBurstEvent ( key, val ) );
-      }
-   }
+   checkpointInputs();
 #endif
 
    verbose_cache( "### copyDataIn WD:", *_wd, " done" );
@@ -473,12 +455,23 @@ void MemController::copyDataOut( MemControllerPolicy policy ) {
 
             _backupOpsOut->issue( _wd );
 
+            // Successors may overwrite the outputs as soon as the task finishes:
+            // help the copy engine instead of letting it back them up later
+            if ( sys.isBackupAsync() ) {
+               BackupManager &backup = reinterpret_cast<BackupManager&>( sys.getBackupMemory().getCache().getDevice() );
+               while ( !_backupOpsOut->isDataReady( *_wd ) ) {
+                  backup.runQueuedCopy();
+               }
+            }
+
             NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseCloseBurstEvent ( key, val ) );
          }
       }
 
       // Inoutparameters' backup have to be cleaned: they are private
       _backupInOutCopies.clear();
+      // So are lazy backups: inputs can be written again once their last reader is done
+      releaseLazyBackups();
    }
 #endif
 
@@ -513,9 +506,17 @@ void MemController::restoreBackupData ( )
          for( index = 0; index < _wd->getNumCopies(); index++ ) {
             if ( _wd->getCopies()[index].isInput()
              && !_wd->getCopies()[index].isOutput() ) {
-               _backupCacheCopies[index].generateOutOps( &memory, *_restoreOps, false, true, *_wd, index);
+               if ( _backupLazyCopies[index] != NULL ) {
+                  ResiliencyCosts::Scope cost( ResiliencyCosts::RESTORE, _wd, _wd->getCopies()[index].getSize() );
+                  failed |= !_backupLazyCopies[index]->restore();
+               } else {
+                  _backupCacheCopies[index].generateOutOps( &memory, *_restoreOps, false, true, *_wd, index);
+               }
             }
-            index++;
+         }
+         if ( failed ) {
+            // Some written page of a lazy backup could not be copied in time
+            throw error::TaskRecoveryFailed();
          }
 
          NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-checkpoint") );
@@ -532,6 +533,127 @@ void MemController::restoreBackupData ( )
 }
 #endif
 
+#ifdef NANOS_RESILIENCY_ENABLED
+bool MemController::restoreBackupRange( unsigned int index, memory::Address address, std::size_t length, char *target )
+{
+   ensure( _preinitialized == true, "MemController::restoreBackupRange: MemController not initialized!");
+   ensure( _initialized == true, "MemController::restoreBackupRange: MemController not initialized!");
+   if ( index >= _backupCacheCopies.size() || !_wd->getCopies()[index].isInput() ) return false;
+
+   if ( _backupLazyCopies[index] != NULL ) {
+      ResiliencyCosts::Scope cost( ResiliencyCosts::RESTORE, _wd, length );
+      return _backupLazyCopies[index]->restore( address.value(), length, _wd, target );
+   }
+
+   RemoteChunk const *backup = NULL;
+   if ( _wd->getCopies()[index].isOutput() ) {
+      // Inout args have a private backup of their own
+      for ( std::vector<BackupPrivateCopy>::const_iterator it = _backupInOutCopies.begin(); it != _backupInOutCopies.end(); ++it ) {
+         if ( !it->isAborted() && it->getHostAddress().value() <= address.value()
+              && address.value() + length <= it->getHostAddress().value() + it->getSize() ) {
+            backup = &*it;
+         }
+      }
+   } else {
+      AllocatedChunk *chunk = _backupCacheCopies[index]._chunk;
+      if ( chunk ) {
+         CachedRegionStatus* entry = (CachedRegionStatus*)chunk->getNewRegions()->getRegionData( chunk->getAllocatedRegion().id );
+         if ( !entry || entry->isValid() ) backup = chunk;
+      }
+   }
+
+   if ( backup == NULL || address.value() < backup->getHostAddress().value()
+        || address.value() + length > backup->getHostAddress().value() + backup->getSize() ) {
+      return false;
+   }
+
+   NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-checkpoint") );
+   NANOS_INSTRUMENT ( nanos_event_value_t val = (nanos_event_value_t) NANOS_FT_RT_IN );
+   NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseOpenBurstEvent ( key, val ) );
+
+   BackupManager &device = reinterpret_cast<BackupManager&>( sys.getBackupMemory().getCache().getDevice() );
+   const bool restored = device.restoreCopy( target != NULL ? memory::Address( target ) : address,
+                                             backup->getDeviceAddress() + ( address - backup->getHostAddress() ), length,
+                                             sys.getBackupMemory(), _wd );
+
+   NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseCloseBurstEvent ( key, val ) );
+   return restored;
+}
+
+void MemController::checkpointInputs()
+{
+   if ( !_inputsCheckpointed && !_backupCacheCopies.empty() && !_wd->isInvalid() ) {
+      _inputsCheckpointed = true;
+      ensure( _backupOpsIn, "Backup ops array has not been initialized!" );
+
+      bool queuedOps = false;
+      for (unsigned int index = 0; index < _backupCacheCopies.size(); index++) {
+         if ( _wd->getCopies()[index].isInput() ) {
+            //_backupCacheCopies[index].setVersion( _memCacheCopies[ index ].getChildrenProducedVersion() );
+            _backupCacheCopies[index]._locations.clear();
+
+            if ( _wd->getCopies()[index].isOutput() ) {
+               // For inout parameters, make a temporary independent backup. We have to do this privately, without
+               // the cache being noticed, because this backup is for exclusive use of this workdescriptor only.
+               _backupInOutCopies.emplace_back( _wd->getCopies()[index], _wd, index );
+               _backupInOutCopies.back().checkpoint( _wd, _backupCopyOps );
+
+            } else if ( sys.isLazyCheckpointEnabled() && checkpointLazily( index ) ) {
+               // Read-only inputs are write-protected, and only copied if something writes them
+
+            } else {
+               _backupCacheCopies[index]._locations.push_back( std::pair<reg_t, reg_t>( _backupCacheCopies[index]._reg.id, _backupCacheCopies[index]._reg.id ) );
+               _backupCacheCopies[index]._locationDataReady = true;
+
+               _backupCacheCopies[ index ].generateInOps( *_backupOpsIn, true, false, *_wd, index);
+               queuedOps = true;
+            }
+         }
+      }
+
+      if( queuedOps ) {
+         NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-checkpoint") );
+         NANOS_INSTRUMENT ( nanos_event_value_t val = (nanos_event_value_t) NANOS_FT_CP_IN );
+         NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseOpenBurstEvent ( key, val ) );
+
+         _backupOpsIn->issue(_wd);
+
+         NANOS_INSTRUMENT ( sys.getInstrumentation()->raiseCloseBurstEvent ( key, val ) );
+      }
+   }
+}
+
+void MemController::prefetchCheckpoint( ProcessingElement &pe )
+{
+   // Only host tasks: their inputs can be read while the thread finishes its current work
+   if ( _backupCacheCopies.empty() || pe.getMemorySpaceId() != 0 /* HOST_MEMSPACE_ID */ || !_wd->isRecoverable() )
+      return;
+
+   initialize( pe );
+   if ( allocateTaskMemory() )
+      checkpointInputs();
+}
+
+bool MemController::checkpointLazily( unsigned int index )
+{
+   // Pages are only copied when written, by the fault handler, which does not account them
+   ResiliencyCosts::Scope cost( ResiliencyCosts::CHECKPOINT, _wd );
+   _backupLazyCopies[index] = BackupLazyCopy::acquire( _wd->getCopies()[index], _memCacheCopies[index]._reg,
+                                                       _memCacheCopies[index].getVersion() );
+   return _backupLazyCopies[index] != NULL;
+}
+
+void MemController::releaseLazyBackups()
+{
+   for ( std::vector<BackupLazyCopy*>::iterator it = _backupLazyCopies.begin(); it != _backupLazyCopies.end(); it++ ) {
+      if ( *it != NULL ) {
+         BackupLazyCopy::release( *it );
+         *it = NULL;
+      }
+   }
+}
+#endif
+
 memory::Address MemController::getAddress( unsigned int index ) const {
    ensure( _preinitialized == true, "MemController not preinitialized!");
    ensure( _initialized == true, "MemController not initialized!");
@@ -568,7 +690,12 @@ bool MemController::isDataReady ( WD const &wd )
 #ifdef NANOS_RESILIENCY_ENABLED
          if ( _wd->isRecoverable() && _backupOpsIn) {
             _inputDataReady &= _backupOpsIn->isDataReady(wd);
+            _inputDataReady &= _backupCopyOps->allCompleted();
             _backupOpsIn->releaseLockedSourceChunks(wd);
+            // Rather than waiting for the copy engine, make some of its queued copies
+            if ( !_inputDataReady && sys.isBackupAsync() ) {
+               reinterpret_cast<BackupManager&>( sys.getBackupMemory().getCache().getDevice() ).runQueuedCopy();
+            }
          }
 #endif
       }
@@ -25,6 +25,7 @@
 #include "addressspace_decl.hpp"
 #include "atomic_decl.hpp"
 #include "backupcachecopy_decl.hpp"
+#include "backuplazycopy_decl.hpp"
 #include "backupprivatecopy_decl.hpp"
 #include "lock_decl.hpp"
 #include "newregiondirectory_decl.hpp"
@@ -65,8 +66,12 @@ class MemController {
    SeparateAddressSpaceInOps     *_backupOpsIn;
    SeparateAddressSpaceInOps     *_backupOpsOut;
    SeparateAddressSpaceOutOps    *_restoreOps;
+   DeviceOps                     *_backupCopyOps;   /* Private backups queued for the copy engine */
    std::vector<BackupCacheCopy>   _backupCacheCopies;
    std::vector<BackupPrivateCopy> _backupInOutCopies;
+   std::vector<BackupLazyCopy*>   _backupLazyCopies; /* Shared lazy backup of each copy, or NULL */
+   bool                           _backupMemoryAllocated;
+   bool                           _inputsCheckpointed;
 #endif
    size_t    _affinityScore;
    size_t    _maxAffinityScore;
@@ -94,6 +99,17 @@ public:
 #ifdef NANOS_RESILIENCY_ENABLED
    void restoreBackupData(); /* Restores a previously backed up input data */
    bool isDataRestored( WD const &wd );
+   /* Restores part of the host memory of an input from its backup, or writes it to \a target if given.
+    * Returns false if the backup does not hold it */
+   bool restoreBackupRange( unsigned int index, memory::Address address, std::size_t length, char *target = NULL );
+   /* Write-protects a read-only input instead of copying it, or shares the backup of another reader
+    * of the same version. Returns false if it must be copied */
+   bool checkpointLazily( unsigned int index );
+   void releaseLazyBackups();
+   void checkpointInputs(); /* Issues the backup of the inputs, once */
+   /* Issues the backup of the inputs before the task is dequeued, so that
+    * asynchronous checkpoints overlap with the work of the thread that will run it */
+   void prefetchCheckpoint( ProcessingElement &pe );
 #endif
    bool isDataReady( WD const &wd );
    bool isOutputDataReady( WD const &wd );
@@ -336,6 +336,22 @@ typedef struct {
    void               *data;
 } nanos_init_desc_t;
 
+/* Resiliency cost accounting */
+typedef enum { NANOS_RESILIENCY_CRC_COMPUTE = 0, NANOS_RESILIENCY_CRC_VERIFY, NANOS_RESILIENCY_CHECKPOINT,
+               NANOS_RESILIENCY_RESTORE, NANOS_RESILIENCY_REEXECUTION, NANOS_RESILIENCY_OPERATIONS } nanos_resiliency_op_t;
+
+/*! \brief Time and bytes spent in each resiliency operation (indexed by nanos_resiliency_op_t) */
+typedef struct {
+   unsigned long long time_ns[NANOS_RESILIENCY_OPERATIONS];
+   unsigned long long bytes[NANOS_RESILIENCY_OPERATIONS];
+   unsigned long long count[NANOS_RESILIENCY_OPERATIONS];
+} nanos_resiliency_stats_t;
+
+/*! \brief Thread argument of nanos_resiliency_stats that selects the operations made by the threads
+ *  the runtime does not manage, and by those whose id is too large to be accounted on its own (256 or more)
+ */
+#define NANOS_RESILIENCY_OTHER_THREADS (-2)
+
 //! \}
 
 #endif
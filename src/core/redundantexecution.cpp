@@ -0,0 +1,295 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "redundantexecution_decl.hpp"
+#include "workdescriptor.hpp"
+#include "basethread.hpp"
+#include "system.hpp"
+#include "copydata.hpp"
+#include "atomic.hpp"
+#include "debug.hpp"
+#include "resiliencycosts_decl.hpp"
+#include "crc/crc32c.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace nanos;
+
+RedundantExecution::RedundantExecution() : _enabled( false ), _all( false ), _tasks(),
+   _replicated( 0 ), _remote( 0 ), _outvoted( 0 ), _unresolved( 0 ), _skipped( 0 )
+{
+   for ( unsigned i = 0; i < REDUNDANCY_SLOTS; i++ )
+      _slots[i] = NULL;
+}
+
+void RedundantExecution::enable( std::string const &tasks )
+{
+   _tasks.clear();
+   _all = false;
+
+   std::string::size_type start = 0;
+   while ( start <= tasks.size() ) {
+      std::string::size_type end = tasks.find( ',', start );
+      if ( end == std::string::npos ) end = tasks.size();
+
+      std::string name = tasks.substr( start, end - start );
+      if ( name == "all" ) _all = true;
+      else if ( !name.empty() ) _tasks.push_back( name );
+
+      start = end + 1;
+   }
+
+   _enabled = _all || !_tasks.empty();
+}
+
+bool RedundantExecution::isSelected( WD const &wd ) const
+{
+   if ( !_enabled ) return false;
+   if ( _all ) return true;
+
+   const char *description = wd.getDescription();
+   if ( description == NULL ) return false;
+   return std::find( _tasks.begin(), _tasks.end(), std::string( description ) ) != _tasks.end();
+}
+
+bool RedundantExecution::getOutputs( WD const &wd, std::vector<Output> &outputs )
+{
+   CopyData *copies = wd.getCopies();
+   std::vector<Output> inputs;
+
+   for ( size_t i = 0; i < wd.getNumCopies(); i++ ) {
+      Output span;
+      CRCDirectory::getRuns( copies[i], span.runs );
+      if ( span.runs.empty() ) continue;
+
+      span.low = copies[i].getBaseAddress().value();
+      span.high = span.low;
+      for ( CRCDirectory::RunList::const_iterator it = span.runs.begin(); it != span.runs.end(); it++ ) {
+         span.low = std::min( span.low, it->address );
+         span.high = std::max( span.high, it->address + it->length );
+      }
+
+      if ( copies[i].isOutput() ) outputs.push_back( span );
+      else inputs.push_back( span );
+   }
+
+   // The replica reads its inputs from their place while the task may be writing there
+   for ( size_t o = 0; o < outputs.size(); o++ ) {
+      for ( size_t i = 0; i < inputs.size(); i++ ) {
+         if ( inputs[i].low < outputs[o].high && outputs[o].low < inputs[i].high ) return false;
+      }
+      for ( size_t other = o + 1; other < outputs.size(); other++ ) {
+         if ( outputs[other].low < outputs[o].high && outputs[o].low < outputs[other].high ) return false;
+      }
+   }
+   return true;
+}
+
+bool RedundantExecution::redirect( WD const &wd, std::vector<Output> &outputs, std::vector<char> &args )
+{
+   const size_t size = wd.getDataSize();
+   const char *data = (const char *) wd.getData();
+   args.assign( data, data + size );
+
+   // Outlined arguments keep pointers aligned, anything else is copied as it is
+   for ( size_t offset = 0; offset + sizeof( uint64_t ) <= size; offset += sizeof( void * ) ) {
+      uint64_t word;
+      memcpy( &word, &args[offset], sizeof( word ) );
+      for ( size_t o = 0; o < outputs.size(); o++ ) {
+         if ( word >= outputs[o].low && word < outputs[o].high ) {
+            word = (uint64_t) &outputs[o].buffer[0] + ( word - outputs[o].low );
+            memcpy( &args[offset], &word, sizeof( word ) );
+            outputs[o].found = true;
+            break;
+         }
+      }
+   }
+
+   for ( size_t o = 0; o < outputs.size(); o++ ) {
+      if ( !outputs[o].found ) return false;
+   }
+   return true;
+}
+
+uint32_t RedundantExecution::checksum( std::vector<Output> const &outputs, bool buffer )
+{
+   crc::Crc32c crc;
+   for ( size_t o = 0; o < outputs.size(); o++ ) {
+      for ( CRCDirectory::RunList::const_iterator it = outputs[o].runs.begin(); it != outputs[o].runs.end(); it++ ) {
+         const void *address = buffer ? (const void *) &outputs[o].buffer[it->address - outputs[o].low] : (const void *) it->address;
+         crc.update( address, it->length );
+      }
+   }
+   return crc.finalize();
+}
+
+void RedundantExecution::run( Replica &replica )
+{
+   // Runtime calls made by the task see the replica as their WD, and the tasks it creates are its children
+   BaseThread *thread = myThread;
+   WD *current = thread->getCurrentWD();
+   // It runs on the stack of this thread: if it blocks, it must be resumed here
+   replica.wd->tieTo( *thread );
+   thread->setCurrentWD( *replica.wd );
+   try {
+      replica.work( replica.wd->getData() );
+   } catch ( ... ) {
+      // Whatever the error, the owner must not wait forever: the replica just does not count
+      replica.failed = true;
+   }
+   // Children write to the private buffers too
+   replica.wd->waitCompletion( /* avoidFlush */ true );
+   thread->setCurrentWD( *current );
+   memoryFence();
+   replica.done = true;
+}
+
+WD * RedundantExecution::createReplica( WD &wd, std::vector<char> &args )
+{
+   // No copies: the private buffers are not known to the directory
+   WD *replica = NEW WD( wd.getActiveDevice().clone(), args.size(), wd.getDataAlignment(), &args[0],
+                         0, NULL, NULL, wd.getDescription() );
+   replica->setDepth( wd.getDepth() );
+   replica->setFinal( wd.isFinal() );
+   replica->setInternalData( wd.getInternalData(), /* ownedByWD */ false );
+
+   // Like the WD of a thread, it is started in place and never submitted
+   replica->_mcontrol.preInit();
+   replica->_mcontrol.initialize( *myThread->runningOn() );
+   replica->init();
+   replica->start( WD::IsNotAUserLevelThread );
+   return replica;
+}
+
+bool RedundantExecution::execute( WD &wd, work_fct work )
+{
+   std::vector<Output> outputs;
+   std::vector<char> args;
+
+   const bool redirectable = getOutputs( wd, outputs );
+
+   // There is nothing to compare in tasks without outputs
+   if ( redirectable && outputs.empty() ) {
+      work( wd.getData() );
+      return true;
+   }
+
+   if ( redirectable ) {
+      for ( size_t o = 0; o < outputs.size(); o++ ) {
+         const char *low = (const char *) outputs[o].low;
+         outputs[o].snapshot.assign( low, low + ( outputs[o].high - outputs[o].low ) );
+         outputs[o].buffer = outputs[o].snapshot;
+      }
+   }
+
+   if ( !redirectable || !redirect( wd, outputs, args ) ) {
+      debug( "Resiliency: outputs of task ", wd.getId(), " can not be redirected, it runs only once." );
+      _skipped++;
+      work( wd.getData() );
+      return true;
+   }
+
+   // Offer the replica to an idle thread while this one runs the task in place
+   Replica replica( work, createReplica( wd, args ) );
+   int slot = -1;
+   for ( int i = 0; i < REDUNDANCY_SLOTS && slot < 0; i++ ) {
+      if ( _slots[i] == NULL && compareAndSwap( &_slots[i], (Replica *) NULL, &replica ) ) slot = i;
+   }
+   _replicated++;
+
+   try {
+      work( wd.getData() );
+   } catch ( ... ) {
+      // The replica must not outlive its buffers
+      if ( slot < 0 || compareAndSwap( &_slots[slot], &replica, (Replica *) NULL ) ) replica.done = true;
+      while ( !replica.done ) memoryFence();
+      delete replica.wd;
+      throw;
+   }
+
+   if ( slot < 0 || compareAndSwap( &_slots[slot], &replica, (Replica *) NULL ) ) {
+      ResiliencyCosts::Scope cost( ResiliencyCosts::REEXECUTION, &wd );
+      run( replica );
+   } else {
+      while ( !replica.done ) {
+         if ( !help() ) memoryFence();
+      }
+   }
+
+   const uint32_t first = checksum( outputs, false );
+   const uint32_t second = checksum( outputs, true );
+   if ( !replica.failed && first == second ) {
+      delete replica.wd;
+      return true;
+   }
+
+   // Executions disagree: a third one decides
+   debug( "Resiliency: redundant executions of task ", wd.getId(), " disagree, running it again." );
+   const bool secondValid = !replica.failed;
+   // The replica's arguments point into the buffers: refill them in place
+   for ( size_t o = 0; o < outputs.size(); o++ )
+      std::copy( outputs[o].snapshot.begin(), outputs[o].snapshot.end(), outputs[o].buffer.begin() );
+
+   Replica third( work, replica.wd );
+   {
+      ResiliencyCosts::Scope cost( ResiliencyCosts::REEXECUTION, &wd );
+      run( third );
+   }
+   const uint32_t decision = checksum( outputs, true );
+   delete replica.wd;
+
+   if ( !third.failed && decision == first ) {
+      _outvoted++;
+      return true;
+   }
+   if ( !third.failed && secondValid && decision == second ) {
+      for ( size_t o = 0; o < outputs.size(); o++ ) {
+         for ( CRCDirectory::RunList::const_iterator it = outputs[o].runs.begin(); it != outputs[o].runs.end(); it++ )
+            memcpy( (void *) it->address, &outputs[o].buffer[it->address - outputs[o].low], it->length );
+      }
+      _outvoted++;
+      return true;
+   }
+
+   _unresolved++;
+   return false;
+}
+
+bool RedundantExecution::help()
+{
+   for ( unsigned i = 0; i < REDUNDANCY_SLOTS; i++ ) {
+      Replica *replica = _slots[i];
+      if ( replica != NULL && compareAndSwap( &_slots[i], replica, (Replica *) NULL ) ) {
+         _remote++;
+         run( *replica );
+         return true;
+      }
+   }
+   return false;
+}
+
+void RedundantExecution::getStats( Stats &stats ) const
+{
+   stats.replicated = _replicated.value();
+   stats.remote = _remote.value();
+   stats.outvoted = _outvoted.value();
+   stats.unresolved = _unresolved.value();
+   stats.skipped = _skipped.value();
+}
@@ -0,0 +1,145 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef REDUNDANTEXECUTION_DECL_HPP
+#define REDUNDANTEXECUTION_DECL_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "atomic_decl.hpp"
+#include "crcdirectory_decl.hpp"
+#include "workdescriptor_fwd.hpp"
+
+namespace nanos {
+
+//! Number of replicas that can be offered to idle threads at the same time
+#define REDUNDANCY_SLOTS 16
+
+/*!
+ * \brief Runs selected tasks twice and compares the CRC of their outputs,
+ * to detect errors in the computation itself.
+ *
+ * The thread that runs the task executes it in place, while a replica
+ * whose output pointers are redirected to private buffers is offered to
+ * idle threads (or run afterwards by the same thread, if none took it).
+ * If both executions produce the same outputs, the task is done. If they
+ * do not, a third execution decides which one is kept.
+ *
+ * Output pointers are found by looking for their addresses in the task
+ * arguments, so tasks that reach their outputs in some other way, or
+ * whose inputs overlap their outputs, are run only once. Replicas run as
+ * WDs of their own over the redirected arguments: runtime calls made by
+ * the task apply to the replica, and the tasks it creates are its children
+ * and are waited for before comparing the outputs. Such children only write
+ * to the private buffers if their arguments come from the redirected
+ * pointers.
+ */
+class RedundantExecution {
+   public:
+      typedef void ( *work_fct )( void *args );
+
+      //! Counters of the redundant executions.
+      struct Stats {
+         unsigned replicated;  //!< Tasks run twice
+         unsigned remote;      //!< Replicas run by another thread
+         unsigned outvoted;    //!< Tasks whose executions disagreed and were decided by a third one
+         unsigned unresolved;  //!< Tasks whose three executions disagreed
+         unsigned skipped;     //!< Selected tasks whose outputs could not be redirected
+      };
+
+   private:
+      //! Execution of a task into private output buffers.
+      struct Replica {
+         work_fct          work;
+         WD               *wd;      //!< WD of the replica, over the redirected arguments
+         volatile bool     done;
+         volatile bool     failed;  //!< The execution raised an error
+
+         Replica( work_fct w, WD *r ) : work( w ), wd( r ), done( false ), failed( false ) {}
+      };
+
+      //! Host memory written by an output of the task, and its private copies.
+      struct Output {
+         uint64_t               low;
+         uint64_t               high;
+         CRCDirectory::RunList  runs;      //!< Pieces actually written
+         std::vector<char>      snapshot;  //!< Contents before the task ran
+         std::vector<char>      buffer;    //!< Outputs of the replica
+         bool                   found;     //!< A task argument points to it
+
+         Output() : low( 0 ), high( 0 ), runs(), snapshot(), buffer(), found( false ) {}
+      };
+
+      bool                       _enabled;
+      bool                       _all;
+      std::vector<std::string>   _tasks;   //!< Descriptions of the selected tasks
+      Replica * volatile         _slots[REDUNDANCY_SLOTS];
+      Atomic<unsigned>           _replicated;
+      Atomic<unsigned>           _remote;
+      Atomic<unsigned>           _outvoted;
+      Atomic<unsigned>           _unresolved;
+      Atomic<unsigned>           _skipped;
+
+      //! \brief Finds the outputs of \a wd. False if they can not be redirected.
+      static bool getOutputs( WD const &wd, std::vector<Output> &outputs );
+
+      //! \brief Copies the arguments of \a wd, pointing them to the private buffers.
+      static bool redirect( WD const &wd, std::vector<Output> &outputs, std::vector<char> &args );
+
+      //! \brief CRC of the outputs, read from their place (\a buffer unset) or from the private buffers.
+      static uint32_t checksum( std::vector<Output> const &outputs, bool buffer );
+
+      //! \brief Runs a replica as the current WD of the thread, catching the errors it raises.
+      static void run( Replica &replica );
+
+      //! \brief Creates the WD of a replica of \a wd, with \a args as its argument block.
+      static WD * createReplica( WD &wd, std::vector<char> &args );
+
+      RedundantExecution( RedundantExecution const & );
+      RedundantExecution & operator=( RedundantExecution const & );
+
+   public:
+      RedundantExecution();
+
+      //! \brief Selects the tasks to replicate: "all", or a comma separated list of task descriptions.
+      void enable( std::string const &tasks );
+
+      bool isEnabled() const { return _enabled; }
+
+      //! \brief Tells if \a wd has to be run redundantly.
+      bool isSelected( WD const &wd ) const;
+
+      /*! \brief Runs \a wd until two executions agree.
+       *  \returns false if the three executions produced different outputs.
+       */
+      bool execute( WD &wd, work_fct work );
+
+      //! \brief Runs a replica offered by another thread, if any. Called by idle threads.
+      bool help();
+
+      //! \brief Returns a snapshot of the counters.
+      void getStats( Stats &stats ) const;
+};
+
+} // namespace nanos
+
+#endif /* REDUNDANTEXECUTION_DECL_HPP */
@@ -0,0 +1,183 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "resiliencycosts_decl.hpp"
+#include "workdescriptor.hpp"
+#include "basethread.hpp"
+#include "instrumentation.hpp"
+#include "system.hpp"
+#include "atomic.hpp"
+#include "os.hpp"
+
+using namespace nanos;
+
+ResiliencyCosts::Account::Account()
+{
+   for ( unsigned i = 0; i < OPERATIONS; i++ ) {
+      time[i] = 0;
+      bytes[i] = 0;
+      count[i] = 0;
+   }
+}
+
+void ResiliencyCosts::Account::add( Operation operation, uint64_t t, std::size_t b )
+{
+   time[operation] += t;
+   bytes[operation] += (uint64_t) b;
+   count[operation]++;
+}
+
+void ResiliencyCosts::Account::get( nanos_resiliency_stats_t &stats ) const
+{
+   for ( unsigned i = 0; i < OPERATIONS; i++ ) {
+      stats.time_ns[i] = time[i].value();
+      stats.bytes[i] = bytes[i].value();
+      stats.count[i] = count[i].value();
+   }
+}
+
+ResiliencyCosts::Scope::Scope( Operation operation, WD const *wd, std::size_t bytes ) :
+   _operation( operation ), _type( getTaskType( wd ) ), _bytes( bytes ), _start( OS::getMonotonicTimeUs() )
+{
+   // The copy engine can not raise events: it is not a runtime thread
+   NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-cost") );
+   NANOS_INSTRUMENT ( if ( myThread != NULL ) sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) _operation + 1 ) );
+}
+
+ResiliencyCosts::Scope::Scope( Operation operation, void *type, std::size_t bytes ) :
+   _operation( operation ), _type( type ), _bytes( bytes ), _start( OS::getMonotonicTimeUs() )
+{
+   NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-cost") );
+   NANOS_INSTRUMENT ( if ( myThread != NULL ) sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) _operation + 1 ) );
+}
+
+ResiliencyCosts::Scope::~Scope()
+{
+#ifdef NANOS_RESILIENCY_ENABLED
+   sys.getResiliencyCosts().account( _operation, _type, OS::getMonotonicTimeUs() - _start, _bytes );
+#endif
+
+   NANOS_INSTRUMENT ( static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-cost") );
+   NANOS_INSTRUMENT ( static nanos_event_key_t bytes_key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-cost-bytes") );
+   NANOS_INSTRUMENT ( nanos_event_value_t bytes_val = (nanos_event_value_t) _bytes );
+   NANOS_INSTRUMENT ( if ( myThread != NULL ) sys.getInstrumentation()->raisePointEvents( 1, &bytes_key, &bytes_val ) );
+   NANOS_INSTRUMENT ( if ( myThread != NULL ) sys.getInstrumentation()->raiseCloseBurstEvent( key, (nanos_event_value_t) _operation + 1 ) );
+}
+
+ResiliencyCosts::ResiliencyCosts() : _total(), _numTypes( 0 )
+{
+   for ( unsigned i = 0; i < RESILIENCY_COST_TYPES; i++ )
+      _types[i] = NULL;
+}
+
+ResiliencyCosts::~ResiliencyCosts()
+{
+   for ( unsigned i = 0; i < RESILIENCY_COST_TYPES; i++ )
+      delete _types[i];
+}
+
+ResiliencyCosts::Type * ResiliencyCosts::getType( void *key, bool create )
+{
+   unsigned slot = ( (uintptr_t) key >> 4 ) * 0x9E3779B97F4A7C15ULL >> 16;
+   for ( unsigned probe = 0; probe < RESILIENCY_COST_TYPES; probe++ ) {
+      slot &= RESILIENCY_COST_TYPES - 1;
+      Type *type = _types[slot];
+      if ( type == NULL ) {
+         if ( !create ) return NULL;
+         type = NEW Type( key );
+         if ( compareAndSwap( &_types[slot], (Type *) NULL, type ) ) {
+            _numTypes++;
+            return type;
+         }
+         delete type;
+         type = _types[slot];
+      }
+      if ( type->key == key ) return type;
+      slot++;
+   }
+   // Too many task types: the rest are only accounted in the totals and their threads
+   return NULL;
+}
+
+void * ResiliencyCosts::getTaskType( WD const *wd )
+{
+   // Tasks whose device is not chosen yet can not be told apart
+   if ( wd == NULL || !wd->hasActiveDevice() ) return NULL;
+   return (void *) wd->getActiveDevice().getWorkFct();
+}
+
+void ResiliencyCosts::account( Operation operation, void *key, double time, std::size_t bytes )
+{
+   const uint64_t ns = time > 0.0 ? (uint64_t) ( time * 1000.0 ) : 0;
+   _total.add( operation, ns, bytes );
+
+   BaseThread *thread = getMyThreadSafe();
+   const unsigned id = thread != NULL ? (unsigned) thread->getId() : RESILIENCY_COST_THREADS;
+   _threads[ id < RESILIENCY_COST_THREADS ? id : RESILIENCY_COST_THREADS ].add( operation, ns, bytes );
+
+   if ( key != NULL ) {
+      Type *type = getType( key, true );
+      if ( type != NULL ) type->add( operation, ns, bytes );
+   }
+}
+
+void ResiliencyCosts::getTotal( nanos_resiliency_stats_t &stats ) const
+{
+   _total.get( stats );
+}
+
+bool ResiliencyCosts::getTaskType( void *key, nanos_resiliency_stats_t &stats )
+{
+   Type *type = getType( key, false );
+   if ( type == NULL ) return false;
+   type->get( stats );
+   return true;
+}
+
+bool ResiliencyCosts::getThread( unsigned id, nanos_resiliency_stats_t &stats ) const
+{
+   if ( id >= RESILIENCY_COST_THREADS ) return false;
+   _threads[id].get( stats );
+   return true;
+}
+
+void ResiliencyCosts::getOtherThreads( nanos_resiliency_stats_t &stats ) const
+{
+   _threads[RESILIENCY_COST_THREADS].get( stats );
+}
+
+unsigned ResiliencyCosts::getNumTaskTypes() const
+{
+   return _numTypes.value();
+}
+
+void * ResiliencyCosts::getTaskTypeKey( unsigned index ) const
+{
+   for ( unsigned i = 0; i < RESILIENCY_COST_TYPES; i++ ) {
+      Type *type = _types[i];
+      if ( type != NULL && index-- == 0 ) return type->key;
+   }
+   return NULL;
+}
+
+const char * ResiliencyCosts::getName( Operation operation )
+{
+   static const char * const names[OPERATIONS] = { "CRC compute", "CRC verify", "checkpoint", "restore", "re-execution" };
+   return names[operation];
+}
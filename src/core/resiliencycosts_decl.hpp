@@ -0,0 +1,148 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef RESILIENCYCOSTS_DECL_HPP
+#define RESILIENCYCOSTS_DECL_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nanos-int.h"
+#include "atomic_decl.hpp"
+#include "allocator_decl.hpp"
+#include "workdescriptor_fwd.hpp"
+
+namespace nanos {
+
+//! Number of task types (outline functions) whose costs are accounted separately
+#define RESILIENCY_COST_TYPES 256
+//! Threads with this id or a greater one share the account of the threads the runtime does not manage
+#define RESILIENCY_COST_THREADS 256
+
+/*!
+ * \brief Accounts the time and bytes spent in every resiliency operation.
+ *
+ * Every operation is accounted three times: in the totals, in the task
+ * type (outline function) it was made for and in the thread that made
+ * it. Threads that are not managed by the runtime, like the copy engine,
+ * share a single account. Accounts only grow, so they can be read at any
+ * time without stopping the threads that update them.
+ *
+ * Operations are timed by the thread that makes them, which also raises
+ * an "ft-cost" burst around them so that traces show where they happen.
+ */
+class ResiliencyCosts {
+   public:
+      //! Operations whose cost is accounted.
+      enum Operation {
+         CRC_COMPUTE = NANOS_RESILIENCY_CRC_COMPUTE,   //!< Hashing task outputs
+         CRC_VERIFY  = NANOS_RESILIENCY_CRC_VERIFY,    //!< Checking task inputs against their CRC
+         CHECKPOINT  = NANOS_RESILIENCY_CHECKPOINT,    //!< Backing up task inputs
+         RESTORE     = NANOS_RESILIENCY_RESTORE,       //!< Restoring task inputs from their backups
+         REEXECUTION = NANOS_RESILIENCY_REEXECUTION,   //!< Running tasks again after a failure
+         OPERATIONS  = NANOS_RESILIENCY_OPERATIONS
+      };
+
+      /*! \brief Times an operation and accounts it when it goes out of scope.
+       *  Bytes can be added while the operation goes on.
+       */
+      class Scope {
+         private:
+            Operation         _operation;
+            void             *_type;
+            std::size_t       _bytes;
+            double            _start;
+
+            Scope( Scope const & );
+            Scope & operator=( Scope const & );
+
+         public:
+            Scope( Operation operation, WD const *wd, std::size_t bytes = 0 );
+            //! \brief Times an operation made for the tasks of \a type (may be NULL).
+            Scope( Operation operation, void *type, std::size_t bytes );
+            ~Scope();
+
+            void addBytes( std::size_t bytes ) { _bytes += bytes; }
+      };
+
+   private:
+      struct Account {
+         Atomic<uint64_t>  time[OPERATIONS];   //!< Nanoseconds
+         Atomic<uint64_t>  bytes[OPERATIONS];
+         Atomic<uint64_t>  count[OPERATIONS];
+         char              pad[NANOS_CACHELINE];
+
+         Account();
+
+         void add( Operation operation, uint64_t time, std::size_t bytes );
+         void get( nanos_resiliency_stats_t &stats ) const;
+      };
+
+      struct Type : public Account {
+         void * volatile   key;   //!< Outline function of the tasks
+
+         Type( void *k ) : Account(), key( k ) {}
+      };
+
+      Account          _total;
+      Type * volatile  _types[RESILIENCY_COST_TYPES];
+      //! The last account is shared by the threads that are not managed by the runtime
+      Account          _threads[RESILIENCY_COST_THREADS + 1];
+      Atomic<unsigned> _numTypes;
+
+      //! \brief Returns the type of a task, creating it if \a create is set. May return NULL.
+      Type * getType( void *key, bool create );
+
+      ResiliencyCosts( ResiliencyCosts const & );
+      ResiliencyCosts & operator=( ResiliencyCosts const & );
+
+   public:
+      ResiliencyCosts();
+      ~ResiliencyCosts();
+
+      //! \brief Returns the task type of \a wd (its outline function), or NULL if it is not known yet.
+      static void * getTaskType( WD const *wd );
+
+      //! \brief Accounts an operation made for a task of \a type (may be NULL) that took \a time microseconds.
+      void account( Operation operation, void *type, double time, std::size_t bytes );
+
+      //! \brief Returns the costs of all the operations.
+      void getTotal( nanos_resiliency_stats_t &stats ) const;
+
+      //! \brief Returns the costs of the tasks whose outline function is \a key. False if none was accounted.
+      bool getTaskType( void *key, nanos_resiliency_stats_t &stats );
+
+      //! \brief Returns the costs of the operations made by thread \a id. False if there is no such account.
+      bool getThread( unsigned id, nanos_resiliency_stats_t &stats ) const;
+
+      //! \brief Returns the costs of the operations made by unmanaged threads, or threads with a too large id.
+      void getOtherThreads( nanos_resiliency_stats_t &stats ) const;
+
+      unsigned getNumTaskTypes() const;
+
+      //! \brief Returns the outline function of task type \a index, or NULL if there are less types.
+      void * getTaskTypeKey( unsigned index ) const;
+
+      //! \brief Name of an operation, as shown in the execution summary.
+      static const char * getName( Operation operation );
+};
+
+} // namespace nanos
+
+#endif /* RESILIENCYCOSTS_DECL_HPP */
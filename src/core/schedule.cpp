@@ -311,6 +311,19 @@ inline void Scheduler::idleLoop ()
          }
       } 
 
+#ifdef NANOS_RESILIENCY_ENABLED
+      //! \note With nothing else to do, help checking the inputs of running tasks
+      if ( !next && sys._crc_enabled && sys.getCRCDirectory().help() ) {
+         spins = init_spins;
+         continue;
+      }
+      //! \note or running the replicas of redundant tasks
+      if ( !next && sys.getRedundancy().isEnabled() && sys.getRedundancy().help() ) {
+         spins = init_spins;
+         continue;
+      }
+#endif
+
       if ( next ) {
 
          NANOS_INSTRUMENT (total_spins+= (init_spins - spins); )
@@ -503,6 +516,10 @@ WD * Scheduler::prefetch( BaseThread *thread, WD &wd )
       WD *prefetchedWD = thread->getTeam()->getSchedulePolicy().atPrefetch( thread, wd );
       if ( prefetchedWD ) {
          prefetchedWD->_mcontrol.preInit();
+#ifdef NANOS_RESILIENCY_ENABLED
+         if ( sys._crc_enabled ) sys.prefetchCRC( *prefetchedWD );
+         if ( sys.isResiliencyEnabled() && sys.isBackupAsync() ) prefetchedWD->_mcontrol.prefetchCheckpoint( *thread->runningOn() );
+#endif
       }
       return prefetchedWD;
    }
@@ -543,8 +560,7 @@ struct AsyncWorkerBehaviour
          // Since this is the async behavior, set schedule to false:
          // do not prefetch at this point, as the thread will be always prefetching
          if ( Scheduler::inlineWorkAsync ( next, /* schedule */ false ) ) {
-            next->~WorkDescriptor();
-            delete[] ( char * ) next;
+            sys.deleteWD( next );
          }
       }
    }
@@ -739,6 +755,10 @@ void Scheduler::finishWork( WD * wd, bool schedule )
          WD *prefetchedWD = thread_team->getSchedulePolicy().atBeforeExit( thread, *wd, schedule );
          if ( prefetchedWD ) {
             prefetchedWD->_mcontrol.preInit();
+#ifdef NANOS_RESILIENCY_ENABLED
+            if ( sys._crc_enabled ) sys.prefetchCRC( *prefetchedWD );
+            if ( sys.isResiliencyEnabled() && sys.isBackupAsync() ) prefetchedWD->_mcontrol.prefetchCheckpoint( *thread->runningOn() );
+#endif
             thread->addNextWD( prefetchedWD );
          }
       }
@@ -922,8 +942,7 @@ void Scheduler::switchTo ( WD *to )
    {
       // Discard task, clean it and look for more work to do...
       finishWork( to );
-      to->~WorkDescriptor();
-      delete[] (char *)to;
+      sys.deleteWD( to );
 
       GenericSyncCond *syncCond = myThread->getCurrentWD()->getSyncCond();
       if ( syncCond != NULL ) {
@@ -971,8 +990,7 @@ void Scheduler::switchTo ( WD *to )
 
    } else {
       if (inlineWork(to, /*schedule*/ true)) {
-         to->~WorkDescriptor();
-         delete[] (char *)to;
+         sys.deleteWD( to );
       }
    }
 /*   }*/
@@ -1010,8 +1028,7 @@ void Scheduler::exitHelper (WD *oldWD, WD *newWD, void *arg)
     myThread->exitHelperDependent(oldWD, newWD, arg);
     myThread->setPlanningWD( NULL );
     myThread->setCurrentWD( *newWD );
-    oldWD->~WorkDescriptor();
-    delete[] (char *)oldWD;
+    sys.deleteWD( oldWD );
 }
 
 struct ExitBehaviour
@@ -1028,8 +1045,7 @@ struct ExitBehaviour
       }
       else {
         if ( Scheduler::inlineWork ( next /*jb merge */, /*schedule*/ true ) ) {
-          next->~WorkDescriptor();
-          delete[] (char *)next;
+          sys.deleteWD( next );
         }
       }
    }
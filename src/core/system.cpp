@@ -22,9 +22,9 @@
 #include "backupmanager.hpp"
 #include "exception/signaltranslator.hpp"
 #include "exception/operationfailure.hpp"
-#include <cpuid.h>
-#include "hashmap.hpp"
-#include <nmmintrin.h>
+#include "exception/taskrecoveryfailed.hpp"
+#include "crc/crc32c.hpp"
+#include "error-injection/errorinjectioninterface.hpp"
 #endif
 
 #include "system.hpp"
@@ -146,14 +146,37 @@ System::System () :
       , _lockPoolSize(37), _lockPool( NULL ), _mainTeam (NULL), _simulator(false)
 #ifdef NANOS_RESILIENCY_ENABLED
       , _injectionPolicy( "none" )
+      , _injectOutputs( false )
       , _resiliency_disabled(false)
       , _task_max_trials(1)
       , _backup_pool_size(sysconf(_SC_PAGESIZE ) * sysconf(_SC_PHYS_PAGES) / 20)
-      , _crcParam()
-      , _hashmap()
+      , _backup_pool_pages( "transparent" )
+      , _backup_compression( false )
+      , _lazy_checkpoint( false )
+      , _backup_async( false )
+      , _crcEngine( "auto" )
+      , _crcDirectory()
+      , _crcChunkSize( 256 * 1024 )
+      , _crcParallelThreshold( 4 * 1024 * 1024 )
+      , _crcAsync( false )
+      , _crcIncremental( false )
+      , _crcIncrementalMin( 4 * 1024 * 1024 )
+      , _crcCoverage( 100.0f )
+      , _crcRestoredPieces( 0 )
+      , _crcRestoredBytes( 0 )
+      , _crcCorruptedBackups( 0 )
+      , _crcAncestorRepairs( 0 )
+      , _crcPolicy()
+      , _crcAdaptive( false )
+      , _crcBudget( 3.0f )
+      , _resiliencyCosts()
+      , _taskRedundancy()
+      , _redundancy()
 #endif
       , _affinityFailureCount( 0 )
       , _createLocalTasks( false )
+      , _wdRecycling( false )
+      , _wdRecycler()
       , _verboseDevOps( false )
       , _verboseCopies( false )
       , _splitOutputForThreads( false )
@@ -307,6 +330,7 @@ void System::loadModules ()
       fatal( "Could not load main error injection policy" );
 
    ensure( !_injectionPolicy.empty(),"No error injection policy defined" );
+   _injectOutputs = getInjectionPolicy() != "none";
 #endif
 
    verbose( "Starting Thread Manager" );
@@ -469,6 +493,30 @@ void System::config ()
    cfg.registerArgOption("backup_pool_size", "backup-pool-size");
    cfg.registerEnvOption("backup_pool_size", "NX_BACKUP_POOL_SIZE");
 
+   cfg.registerConfigOption("backup_pool_pages",
+         NEW Config::StringVar(_backup_pool_pages),
+         "Pages that back the memory pool of task backups: small, transparent or explicit huge pages (default: transparent). ");
+   cfg.registerArgOption("backup_pool_pages", "backup-pool-pages");
+   cfg.registerEnvOption("backup_pool_pages", "NX_BACKUP_POOL_PAGES");
+
+   cfg.registerConfigOption("backup_compression",
+         NEW Config::FlagOption(_backup_compression),
+         "Compresses task backups, so that larger inputs fit in the memory pool. ");
+   cfg.registerArgOption("backup_compression", "backup-compression");
+   cfg.registerEnvOption("backup_compression", "NX_BACKUP_COMPRESSION");
+
+   cfg.registerConfigOption("lazy_checkpoint",
+         NEW Config::FlagOption(_lazy_checkpoint),
+         "Write-protects read-only task inputs instead of backing them up, and only copies the pages that are written. ");
+   cfg.registerArgOption("lazy_checkpoint", "lazy-checkpoint");
+   cfg.registerEnvOption("lazy_checkpoint", "NX_LAZY_CHECKPOINT");
+
+   cfg.registerConfigOption("backup_async",
+         NEW Config::FlagOption(_backup_async),
+         "Makes checkpoint copies in a dedicated thread, and starts them when the task is prefetched. ");
+   cfg.registerArgOption("backup_async", "backup-async");
+   cfg.registerEnvOption("backup_async", "NX_BACKUP_ASYNC");
+
    registerPluginOption("error_injection", "error-injection", _injectionPolicy,
          "Selects error injection policy. Used for resiliency evaluation.", cfg);
    cfg.registerArgOption("error_injection", "error-injection");
@@ -477,6 +525,56 @@ void System::config ()
    cfg.registerConfigOption("enable_crc", NEW Config::FlagOption(_crc_enabled, true), "Enables CRC protection. ");
    cfg.registerArgOption("enable_crc", "enable-crc");
    cfg.registerEnvOption("enable_crc", "NX_ENABLE_CRC");
+
+   cfg.registerConfigOption("crc_engine", NEW Config::StringVar(_crcEngine),
+         "Selects the CRC-32C implementation: auto, vpclmul, pclmul, sse42, armv8, table16 or table8 (default: auto). ");
+   cfg.registerArgOption("crc_engine", "crc-engine");
+   cfg.registerEnvOption("crc_engine", "NX_CRC_ENGINE");
+
+   cfg.registerConfigOption("crc_chunk_size", NEW Config::SizeVar(_crcChunkSize),
+         "Size of the pieces in which large task inputs are split to check their CRC in parallel (default: 256K). ");
+   cfg.registerArgOption("crc_chunk_size", "crc-chunk-size");
+   cfg.registerEnvOption("crc_chunk_size", "NX_CRC_CHUNK_SIZE");
+
+   cfg.registerConfigOption("crc_parallel_threshold", NEW Config::SizeVar(_crcParallelThreshold),
+         "Task inputs of at least this size have their CRC checked in parallel by idle threads (default: 4M). ");
+   cfg.registerArgOption("crc_parallel_threshold", "crc-parallel-threshold");
+   cfg.registerEnvOption("crc_parallel_threshold", "NX_CRC_PARALLEL_THRESHOLD");
+
+   cfg.registerConfigOption("crc_async", NEW Config::FlagOption(_crcAsync, true),
+         "Starts checking the CRC of task inputs when the task is prefetched. ");
+   cfg.registerArgOption("crc_async", "crc-async");
+   cfg.registerEnvOption("crc_async", "NX_CRC_ASYNC");
+
+   cfg.registerConfigOption("crc_incremental", NEW Config::FlagOption(_crcIncremental, true),
+         "Only hashes again the blocks of large task outputs that have been written, using soft-dirty page bits. ");
+   cfg.registerArgOption("crc_incremental", "crc-incremental");
+   cfg.registerEnvOption("crc_incremental", "NX_CRC_INCREMENTAL");
+
+   cfg.registerConfigOption("crc_incremental_min", NEW Config::SizeVar(_crcIncrementalMin),
+         "Task outputs smaller than this are always hashed completely, and task inputs smaller than this always checked completely (default: 4M). ");
+   cfg.registerArgOption("crc_incremental_min", "crc-incremental-min");
+   cfg.registerEnvOption("crc_incremental_min", "NX_CRC_INCREMENTAL_MIN");
+
+   cfg.registerConfigOption("crc_coverage", NEW Config::FloatVar(_crcCoverage),
+         "Percentage of the blocks of large task inputs that are hashed to check them. Lower values detect corruption with less probability at a lower cost (default: 100). ");
+   cfg.registerArgOption("crc_coverage", "crc-coverage");
+   cfg.registerEnvOption("crc_coverage", "NX_CRC_COVERAGE");
+
+   cfg.registerConfigOption("crc_adaptive", NEW Config::FlagOption(_crcAdaptive, true),
+         "Protects task copies according to their measured hashing cost, sampling or skipping the most expensive ones. ");
+   cfg.registerArgOption("crc_adaptive", "crc-adaptive");
+   cfg.registerEnvOption("crc_adaptive", "NX_CRC_ADAPTIVE");
+
+   cfg.registerConfigOption("crc_budget", NEW Config::FloatVar(_crcBudget),
+         "Percentage of the run time of a task that adaptive CRC protection can spend hashing its data (default: 3). ");
+   cfg.registerArgOption("crc_budget", "crc-budget");
+   cfg.registerEnvOption("crc_budget", "NX_CRC_BUDGET");
+
+   cfg.registerConfigOption("task_redundancy", NEW Config::StringVar(_taskRedundancy),
+         "Runs tasks twice and compares the CRC of their outputs, with a third execution if they disagree: 'all' or a comma separated list of task descriptions. ");
+   cfg.registerArgOption("task_redundancy", "task-redundancy");
+   cfg.registerEnvOption("task_redundancy", "NX_TASK_REDUNDANCY");
 #endif
 
    cfg.registerConfigOption ( "verbose-devops", NEW Config::FlagOption ( _verboseDevOps, true ), "Verbose cache ops" );
@@ -495,6 +593,11 @@ void System::config ()
    cfg.registerArgOption ( "regioncache-slab-size", "cache-slab-size" );
    cfg.registerEnvOption ( "regioncache-slab-size", "NX_CACHE_SLAB_SIZE" );
 
+   cfg.registerConfigOption( "wd-recycling", NEW Config::FlagOption( _wdRecycling ),
+                             "Reuses the chunks of finished tasks for new tasks of the same kind" );
+   cfg.registerArgOption( "wd-recycling", "wd-recycling" );
+   cfg.registerEnvOption( "wd-recycling", "NX_WD_RECYCLING" );
+
    cfg.registerConfigOption( "disable-immediate-succ", NEW Config::FlagOption( _immediateSuccessorDisabled ), "Disables the usage of getImmediateSuccessor" );
    cfg.registerArgOption( "disable-immediate-succ", "disable-immediate-successor" );
 
@@ -668,10 +771,30 @@ void System::start ()
 #ifdef NANOS_RESILIENCY_ENABLED   // compile time disable
    if(sys.isResiliencyEnabled()){// runtime disable
       // Insert a new separate memory address space to store input backups
-      BackupManager* mgr = new BackupManager("BackupMgr", _backup_pool_size);
+      BackupManager::PageSize pages = BackupManager::TRANSPARENT_HUGE_PAGES;
+      if ( _backup_pool_pages == "small" ) {
+         pages = BackupManager::SMALL_PAGES;
+      } else if ( _backup_pool_pages == "explicit" ) {
+         pages = BackupManager::EXPLICIT_HUGE_PAGES;
+      } else if ( _backup_pool_pages != "transparent" ) {
+         warning( "Unknown backup pool pages '", _backup_pool_pages, "', using transparent huge pages" );
+      }
+
+      // Workers keep their own cache of free backup blocks, and back up
+      // their inputs in the piece of the pool of their NUMA node
+      std::vector<unsigned> nodes( _numaNodes.begin(), _numaNodes.end() );
+      BackupManager* mgr = new BackupManager("BackupMgr", _backup_pool_size, _crc_enabled, _smpPlugin->getNumThreads(),
+                                             nodes, pages, _backup_compression);
 
       memory_space_id_t backup_id = addSeparateMemoryAddressSpace( *mgr, true /*allocWide*/, 0 /* slabSize*/ );
       _backupMemory = &getSeparateMemory( backup_id );
+
+      if ( _lazy_checkpoint ) {
+         BackupLazyCopy::enable();
+      }
+      if ( _backup_async ) {
+         mgr->startCopyEngine();
+      }
    }
 #endif   
 
@@ -788,177 +911,33 @@ void System::start ()
    // Thread Manager initialization is delayed until a safe point
    _threadManager->init();
 
-#ifdef NANOS_RESILIENCY_ENABLED //OMER::ENCODING
-   if(sys._crc_enabled){
-	   unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
-
-	   __get_cpuid(1, &eax, &ebx, &ecx, &edx);
-
-	   if (ecx & bit_SSE4_2){
-		   // i have the instruction
-		   _crcParam = true;
-		//#define CRC_SUPPORTED 
-		   //std::cerr << "Intel CRC Exists "<<std::endl;
-		   unsigned int temp[256] = {
-				0x00000000,0x8f158014,0x1bc776d9,0x94d2f6cd,
-				0x378eedb2,0xb89b6da6,0x2c499b6b,0xa35c1b7f,
-				0x6f1ddb64,0xe0085b70,0x74daadbd,0xfbcf2da9,
-				0x589336d6,0xd786b6c2,0x4354400f,0xcc41c01b,
-				0xde3bb6c8,0x512e36dc,0xc5fcc011,0x4ae94005,
-				0xe9b55b7a,0x66a0db6e,0xf2722da3,0x7d67adb7,
-				0xb1266dac,0x3e33edb8,0xaae11b75,0x25f49b61,
-				0x86a8801e,0x09bd000a,0x9d6ff6c7,0x127a76d3,
-				0xb99b1b61,0x368e9b75,0xa25c6db8,0x2d49edac,
-				0x8e15f6d3,0x010076c7,0x95d2800a,0x1ac7001e,
-				0xd686c005,0x59934011,0xcd41b6dc,0x425436c8,
-				0xe1082db7,0x6e1dada3,0xfacf5b6e,0x75dadb7a,
-				0x67a0ada9,0xe8b52dbd,0x7c67db70,0xf3725b64,
-				0x502e401b,0xdf3bc00f,0x4be936c2,0xc4fcb6d6,
-				0x08bd76cd,0x87a8f6d9,0x137a0014,0x9c6f8000,
-				0x3f339b7f,0xb0261b6b,0x24f4eda6,0xabe16db2,
-				0x76da4033,0xf9cfc027,0x6d1d36ea,0xe208b6fe,
-				0x4154ad81,0xce412d95,0x5a93db58,0xd5865b4c,
-				0x19c79b57,0x96d21b43,0x0200ed8e,0x8d156d9a,
-				0x2e4976e5,0xa15cf6f1,0x358e003c,0xba9b8028,
-				0xa8e1f6fb,0x27f476ef,0xb3268022,0x3c330036,
-				0x9f6f1b49,0x107a9b5d,0x84a86d90,0x0bbded84,
-				0xc7fc2d9f,0x48e9ad8b,0xdc3b5b46,0x532edb52,
-				0xf072c02d,0x7f674039,0xebb5b6f4,0x64a036e0,
-				0xcf415b52,0x4054db46,0xd4862d8b,0x5b93ad9f,
-				0xf8cfb6e0,0x77da36f4,0xe308c039,0x6c1d402d,
-				0xa05c8036,0x2f490022,0xbb9bf6ef,0x348e76fb,
-				0x97d26d84,0x18c7ed90,0x8c151b5d,0x03009b49,
-				0x117aed9a,0x9e6f6d8e,0x0abd9b43,0x85a81b57,
-				0x26f40028,0xa9e1803c,0x3d3376f1,0xb226f6e5,
-				0x7e6736fe,0xf172b6ea,0x65a04027,0xeab5c033,
-				0x49e9db4c,0xc6fc5b58,0x522ead95,0xdd3b2d81,
-				0xedb48066,0x62a10072,0xf673f6bf,0x796676ab,
-				0xda3a6dd4,0x552fedc0,0xc1fd1b0d,0x4ee89b19,
-				0x82a95b02,0x0dbcdb16,0x996e2ddb,0x167badcf,
-				0xb527b6b0,0x3a3236a4,0xaee0c069,0x21f5407d,
-				0x338f36ae,0xbc9ab6ba,0x28484077,0xa75dc063,
-				0x0401db1c,0x8b145b08,0x1fc6adc5,0x90d32dd1,
-				0x5c92edca,0xd3876dde,0x47559b13,0xc8401b07,
-				0x6b1c0078,0xe409806c,0x70db76a1,0xffcef6b5,
-				0x542f9b07,0xdb3a1b13,0x4fe8edde,0xc0fd6dca,
-				0x63a176b5,0xecb4f6a1,0x7866006c,0xf7738078,
-				0x3b324063,0xb427c077,0x20f536ba,0xafe0b6ae,
-				0x0cbcadd1,0x83a92dc5,0x177bdb08,0x986e5b1c,
-				0x8a142dcf,0x0501addb,0x91d35b16,0x1ec6db02,
-				0xbd9ac07d,0x328f4069,0xa65db6a4,0x294836b0,
-				0xe509f6ab,0x6a1c76bf,0xfece8072,0x71db0066,
-				0xd2871b19,0x5d929b0d,0xc9406dc0,0x4655edd4,
-				0x9b6ec055,0x147b4041,0x80a9b68c,0x0fbc3698,
-				0xace02de7,0x23f5adf3,0xb7275b3e,0x3832db2a,
-				0xf4731b31,0x7b669b25,0xefb46de8,0x60a1edfc,
-				0xc3fdf683,0x4ce87697,0xd83a805a,0x572f004e,
-				0x4555769d,0xca40f689,0x5e920044,0xd1878050,
-				0x72db9b2f,0xfdce1b3b,0x691cedf6,0xe6096de2,
-				0x2a48adf9,0xa55d2ded,0x318fdb20,0xbe9a5b34,
-				0x1dc6404b,0x92d3c05f,0x06013692,0x8914b686,
-				0x22f5db34,0xade05b20,0x3932aded,0xb6272df9,
-				0x157b3686,0x9a6eb692,0x0ebc405f,0x81a9c04b,
-				0x4de80050,0xc2fd8044,0x562f7689,0xd93af69d,
-				0x7a66ede2,0xf5736df6,0x61a19b3b,0xeeb41b2f,
-				0xfcce6dfc,0x73dbede8,0xe7091b25,0x681c9b31,
-				0xcb40804e,0x4455005a,0xd087f697,0x5f927683,
-				0x93d3b698,0x1cc6368c,0x8814c041,0x07014055,
-				0xa45d5b2a,0x2b48db3e,0xbf9a2df3,0x308fade7
-
-		   };
-
-		   unsigned int temp2[256] = {
-				0x00000000,0xe417f38a,0xcdc391e5,0x29d4626f,
-				0x9e6b553b,0x7a7ca6b1,0x53a8c4de,0xb7bf3754,
-				0x393adc87,0xdd2d2f0d,0xf4f94d62,0x10eebee8,
-				0xa75189bc,0x43467a36,0x6a921859,0x8e85ebd3,
-				0x7275b90e,0x96624a84,0xbfb628eb,0x5ba1db61,
-				0xec1eec35,0x08091fbf,0x21dd7dd0,0xc5ca8e5a,
-				0x4b4f6589,0xaf589603,0x868cf46c,0x629b07e6,
-				0xd52430b2,0x3133c338,0x18e7a157,0xfcf052dd,
-				0xe4eb721c,0x00fc8196,0x2928e3f9,0xcd3f1073,
-				0x7a802727,0x9e97d4ad,0xb743b6c2,0x53544548,
-				0xddd1ae9b,0x39c65d11,0x10123f7e,0xf405ccf4,
-				0x43bafba0,0xa7ad082a,0x8e796a45,0x6a6e99cf,
-				0x969ecb12,0x72893898,0x5b5d5af7,0xbf4aa97d,
-				0x08f59e29,0xece26da3,0xc5360fcc,0x2121fc46,
-				0xafa41795,0x4bb3e41f,0x62678670,0x867075fa,
-				0x31cf42ae,0xd5d8b124,0xfc0cd34b,0x181b20c1,
-				0xcc3a92c9,0x282d6143,0x01f9032c,0xe5eef0a6,
-				0x5251c7f2,0xb6463478,0x9f925617,0x7b85a59d,
-				0xf5004e4e,0x1117bdc4,0x38c3dfab,0xdcd42c21,
-				0x6b6b1b75,0x8f7ce8ff,0xa6a88a90,0x42bf791a,
-				0xbe4f2bc7,0x5a58d84d,0x738cba22,0x979b49a8,
-				0x20247efc,0xc4338d76,0xede7ef19,0x09f01c93,
-				0x8775f740,0x636204ca,0x4ab666a5,0xaea1952f,
-				0x191ea27b,0xfd0951f1,0xd4dd339e,0x30cac014,
-				0x28d1e0d5,0xccc6135f,0xe5127130,0x010582ba,
-				0xb6bab5ee,0x52ad4664,0x7b79240b,0x9f6ed781,
-				0x11eb3c52,0xf5fccfd8,0xdc28adb7,0x383f5e3d,
-				0x8f806969,0x6b979ae3,0x4243f88c,0xa6540b06,
-				0x5aa459db,0xbeb3aa51,0x9767c83e,0x73703bb4,
-				0xc4cf0ce0,0x20d8ff6a,0x090c9d05,0xed1b6e8f,
-				0x639e855c,0x878976d6,0xae5d14b9,0x4a4ae733,
-				0xfdf5d067,0x19e223ed,0x30364182,0xd421b208,
-				0x9d995363,0x798ea0e9,0x505ac286,0xb44d310c,
-				0x03f20658,0xe7e5f5d2,0xce3197bd,0x2a266437,
-				0xa4a38fe4,0x40b47c6e,0x69601e01,0x8d77ed8b,
-				0x3ac8dadf,0xdedf2955,0xf70b4b3a,0x131cb8b0,
-				0xefecea6d,0x0bfb19e7,0x222f7b88,0xc6388802,
-				0x7187bf56,0x95904cdc,0xbc442eb3,0x5853dd39,
-				0xd6d636ea,0x32c1c560,0x1b15a70f,0xff025485,
-				0x48bd63d1,0xacaa905b,0x857ef234,0x616901be,
-				0x7972217f,0x9d65d2f5,0xb4b1b09a,0x50a64310,
-				0xe7197444,0x030e87ce,0x2adae5a1,0xcecd162b,
-				0x4048fdf8,0xa45f0e72,0x8d8b6c1d,0x699c9f97,
-				0xde23a8c3,0x3a345b49,0x13e03926,0xf7f7caac,
-				0x0b079871,0xef106bfb,0xc6c40994,0x22d3fa1e,
-				0x956ccd4a,0x717b3ec0,0x58af5caf,0xbcb8af25,
-				0x323d44f6,0xd62ab77c,0xfffed513,0x1be92699,
-				0xac5611cd,0x4841e247,0x61958028,0x858273a2,
-				0x51a3c1aa,0xb5b43220,0x9c60504f,0x7877a3c5,
-				0xcfc89491,0x2bdf671b,0x020b0574,0xe61cf6fe,
-				0x68991d2d,0x8c8eeea7,0xa55a8cc8,0x414d7f42,
-				0xf6f24816,0x12e5bb9c,0x3b31d9f3,0xdf262a79,
-				0x23d678a4,0xc7c18b2e,0xee15e941,0x0a021acb,
-				0xbdbd2d9f,0x59aade15,0x707ebc7a,0x94694ff0,
-				0x1aeca423,0xfefb57a9,0xd72f35c6,0x3338c64c,
-				0x8487f118,0x60900292,0x494460fd,0xad539377,
-				0xb548b3b6,0x515f403c,0x788b2253,0x9c9cd1d9,
-				0x2b23e68d,0xcf341507,0xe6e07768,0x02f784e2,
-				0x8c726f31,0x68659cbb,0x41b1fed4,0xa5a60d5e,
-				0x12193a0a,0xf60ec980,0xdfdaabef,0x3bcd5865,
-				0xc73d0ab8,0x232af932,0x0afe9b5d,0xeee968d7,
-				0x59565f83,0xbd41ac09,0x9495ce66,0x70823dec,
-				0xfe07d63f,0x1a1025b5,0x33c447da,0xd7d3b450,
-				0x606c8304,0x847b708e,0xadaf12e1,0x49b8e16b
-
-
-		   };
-		   for (int n = 0; n < 256; n++) {
-			   _mul_table1_336[n] = temp[n];
-			   _mul_table1_672[n] = temp2[n];
-		   }
-
-	   }
-	   else{
-		   // i dont have crc instruction
-		   //std::cerr << "Intel CRC Does NOT Exist, Computing CRC in Software"<<std::endl;
-			_crcParam = false;
-			unsigned long c;
-			int n, k;
-
-			for (n = 0; n < 256; n++) {
-				c = (unsigned long) n;
-				for (k = 0; k < 8; k++) {
-					if (c & 1)
-						c = 0x04C11DB7 ^ (c >> 1); //0xBA0DC66B //0x04C11DB7
-					else
-						c = c >> 1;
-				}
-				_crcTable[n] = c;
-			}
-	   }
+#ifdef NANOS_RESILIENCY_ENABLED
+   _redundancy.enable( _taskRedundancy );
+   if ( _redundancy.isEnabled() ) {
+      // Redundant executions compare their outputs with CRCs even if CRC protection is disabled
+      if ( !_crc_enabled ) crc::Crc32cEngine::select( _crcEngine );
+      verbose( "Resiliency: tasks '", _taskRedundancy, "' are run redundantly." );
+   }
+   if ( _crc_enabled ) {
+      if ( !crc::Crc32cEngine::select( _crcEngine ) ) {
+         warning( "CRC engine '", _crcEngine, "' is not available. Using '", crc::Crc32cEngine::getName(), "' instead." );
+      }
+      verbose( "Resiliency CRC: using '", crc::Crc32cEngine::getName(), "' CRC-32C engine." );
+      _crcDirectory.setBlocks( _crcChunkSize, _crcIncrementalMin );
+      if ( _crcIncremental && !_crcDirectory.enableIncremental() ) {
+         warning( "Soft-dirty page bits are not available. Task outputs will be hashed completely." );
+         _crcIncremental = false;
+      }
+      if ( _crcAdaptive ) _crcPolicy.enable( _crcBudget );
+      if ( _crcCoverage <= 0.0f || _crcCoverage > 100.0f ) {
+         warning( "CRC coverage must be a percentage greater than 0. Checking task inputs completely." );
+         _crcCoverage = 100.0f;
+      }
+      if ( _crcCoverage < 100.0f ) {
+         const unsigned period = (unsigned) ( 100.0f / _crcCoverage + 0.5f );
+         _crcDirectory.enableSampling( period );
+         verbose( "Resiliency CRC: large task inputs are checked by hashing one block out of ", period, "." );
+      }
    }
 #endif
 }
@@ -1022,6 +1001,9 @@ void System::finish ()
    verbose ( std::dec, error::FailureStats<error::ExecutionFailure>::get(),  " task executions failed" );
    verbose ( std::dec, error::FailureStats<error::TaskRecovery>::get(),      " tasks have been reexecuted" );
    verbose ( std::dec, error::FailureStats<error::DiscardedTask>::get(),     " tasks have been discarded (initialization, parent or sibling(s) failed" );
+   if ( isResiliencyEnabled() && _backup_async ) {
+      reinterpret_cast<BackupManager&>( getBackupMemory().getCache().getDevice() ).stopCopyEngine();
+   }
 #endif // NANOS_RESILIENCY_ENABLED
    sys.getNetwork()->nodeBarrier();
 
@@ -1123,264 +1105,286 @@ void System::finish ()
    delete _pes[mythread->runningOn()->getId() ];
 
    //! \note deleting allocator (if any)
-   if ( allocator != NULL ) free (allocator);
+   if ( allocator != NULL ) {
+      allocator->~Allocator();
+      free (allocator);
+      allocator = NULL;
+   }
 
    verbose ( "NANOS++ shutting down.... end" );
    //! \note printing execution summary
    if ( _summary ) executionSummary();
+#ifdef NANOS_LOCK_STATS
+   LockStats::report( 20 );
+#endif
 
    _net.finalize(); //this can call exit (because of GASNet)
 }
 
 #ifdef NANOS_RESILIENCY_ENABLED
-unsigned int System::getCRC32(uint64_t address)
-{
-	crcStruct *str = this->_hashmap.find(address);
-	if(str==NULL)
-	{
-		str = (crcStruct*)malloc(sizeof(crcStruct *));
-		str->crc1 = 0;
-		str->crc2 = 0;
-		str->crc3 = 0;
-		bool inserted = false;
-		_hashmap.insert(address, *str, inserted);
-		return 0;
-	}
-	if(str->crc1==str->crc2){
-		return str->crc1;
-	}
-	else if(str->crc1==str->crc3){
-		return str->crc1;
+void System::startComputeCRC(WD &wd){
+	CRCJob *job = NEW CRCJob( ResiliencyCosts::getTaskType( &wd ) );
+	for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
+		if (wd.getCopies()[index].isOutput()) {
+			CopyData const& cd = wd.getCopies()[index];
+			global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+			CRCDirectory::RunList runs;
+			CRCDirectory::getRuns(cd, runs);
+			const bool protect = _crcPolicy.protect(wd, index);
+			for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+				// The checksum of the previous data must not be used to check the new one
+				if ( protect ) _crcDirectory.addOutput(*job, reg, *it, _crcChunkSize);
+				else _crcDirectory.discard(reg, *it);
+			}
+		}
 	}
-	else {
-		return str->crc2;
+	if ( job->getNumRuns() == 0 ) {
+		delete job;
+		return;
 	}
-
-}
-
-void System::setCRC32(uint64_t address, unsigned int inCrc32 )
-{
-	crcStruct *str = this->_hashmap.find(address);
-	if(str==NULL)
-	{
-		str = (crcStruct*)malloc(sizeof(crcStruct *));
-		str->crc1 = inCrc32;
-		str->crc2 = inCrc32;
-		str->crc3 = inCrc32;
-		bool inserted = false;
-		_hashmap.insert(address, *str, inserted);
+	// Successors are released without waiting for the hash, unless the outputs are small
+	const bool defer = job->getBytes() >= _crcChunkSize;
+	if ( !defer && _crcPolicy.isEnabled() ) {
+		const std::size_t bytes = job->getBytes();
+		const double start = OS::getMonotonicTimeUs();
+		_crcDirectory.submit( job, false );
+		_crcPolicy.hashed( bytes, OS::getMonotonicTimeUs() - start );
 		return;
 	}
-	str->crc1 = inCrc32;
-	str->crc2 = inCrc32;
-	str->crc3 = inCrc32;
+	_crcDirectory.submit( job, defer );
 }
 
-unsigned int System::compute_Crc32(unsigned int initval, void *buf, size_t bufLen)
+//! \brief Adds the host memory read by the protected inputs of a WD to a job.
+static void addInputRuns( WD &wd, CRCJob &job, size_t chunkSize, CRCPolicy &policy )
 {
-	   unsigned int crc32 = initval;
-	   unsigned char *byteBuf, *byteBuf2;
-		size_t i;
-		size_t res =  bufLen/1024;
-		size_t remainder = bufLen%1024;
-
-		byteBuf = (unsigned char*) buf;
-		for (i=0; i < (res*1024); i+=1024) {
-			crc32 = subcompute_Crc32(crc32, &byteBuf[i]);
-		}
-		byteBuf2 = (unsigned char*) &byteBuf[res*1024];
-		for (i=0; i < remainder; i++) {
-			crc32 = _mm_crc32_u8(crc32, byteBuf2[i]);
+	for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
+		if (wd.getCopies()[index].isInput() && policy.protect(wd, index)) {
+			global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+			CRCDirectory::RunList runs;
+			CRCDirectory::getRuns(wd.getCopies()[index], runs);
+			for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+				job.addRun(reg, *it, chunkSize);
+			}
 		}
-		return crc32;
-}
-
-unsigned int System::subcompute_Crc32(long long unsigned int initval, void *buffer){
-    uint64_t crc0, crc1, crc2, tmp; 
-    uint64_t *p_buffer;
-    uint64_t BLOCKSIZE = 336;
-    uint64_t BLOCKSIZE8 = (BLOCKSIZE / 8);
-
-    p_buffer = (uint64_t *)buffer;
-    crc1 = crc2 = 0;
-
-    // Do first 8 bytes here for better pipelining
-    crc0 = _mm_crc32_u64((uint64_t)initval, p_buffer[0]);
-
-    for(int i = 0; i < 42; i++){
-      crc1 = _mm_crc32_u64(crc1, (uint64_t)(p_buffer[1 + 1*BLOCKSIZE8 + i]));
-      crc2 = _mm_crc32_u64(crc2, (uint64_t)(p_buffer[1 + 2*BLOCKSIZE8 + i]));
-      crc0 = _mm_crc32_u64(crc0, (uint64_t)(p_buffer[1 + 0*BLOCKSIZE8 + i]));
-    }
-
-    // merge in crc1
-    tmp  = p_buffer[127];
-    tmp ^= _mul_table1_336[crc1 & 0xFF];
-    tmp ^= (_mul_table1_336[(crc1 >>  8) & 0xFF]) <<  8;
-    tmp ^= (_mul_table1_336[(crc1 >> 16) & 0xFF]) << 16;
-    tmp ^= (_mul_table1_336[(crc1 >> 24) & 0xFF]) << 24;
-
-    // merge in crc0
-    tmp ^= _mul_table1_672[crc0 & 0xFF];
-    tmp ^= (_mul_table1_672[(crc0 >>  8) & 0xFF]) <<  8;
-    tmp ^= (_mul_table1_672[(crc0 >> 16) & 0xFF]) << 16;
-    tmp ^= (_mul_table1_672[(crc0 >> 24) & 0xFF]) << 24;
-
-    return (unsigned int) _mm_crc32_u64(crc2, (uint64_t)tmp);
+	}
 }
 
-unsigned int System::compute_Crc32_Software(unsigned int initval, void *buf, size_t bufLen)
-{
-
-    unsigned int crc32 = initval;
-    unsigned char *byteBuf;
-    size_t i;
-
-    // accumulate crc32 for buffer
-    //crc32 = inCrc32 ^ 0xFFFFFFFF;
-    byteBuf = (unsigned char*) buf;
-    for (i=0; i < bufLen; i++) {
-    		crc32 = (crc32 >> 8) ^ _crcTable[ (crc32 ^ (byteBuf[i])) & 0xFF ];
+bool System::checkSDCviaCRC32(WD &wd){
+	bool result = false;
+	CRCJob *job = wd.getCRCJob();
+	wd.setCRCJob(NULL);
 
-    }
-    return( crc32 ^ 0xFFFFFFFF );
-}
+	// Only jobs hashed by this thread tell what hashing costs
+	const bool timed = job == NULL && _crcPolicy.isEnabled();
+	const double start = timed ? OS::getMonotonicTimeUs() : 0.0;
 
-void System::startComputeCRC(WD &wd){
-	if(_crcParam){
+	if ( job == NULL ) {
+		job = NEW CRCJob( ResiliencyCosts::getTaskType( &wd ) );
 		for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
-			if (wd.getCopies()[index].isOutput()) {
-				CopyData cd = wd.getCopies()[index];
-				unsigned int inCrc32 = 0xFFFFFFFF;
-				size_t len = cd.getSize();
-				void *buffer = (void*) cd.getAddress();////
-				uint64_t key = cd.getAddress().value();
-				if(cd.getNumDimensions()>1){
-					for (unsigned int i = 0; i < cd.getDimensions()[1].accessed_length; i += 1){
-							uint64_t address = cd.getAddress().value() + cd.getDimensions()[0].accessed_length * i;
-							buffer = (void *) address;
-							len =  cd.getDimensions()[0].accessed_length;
-							inCrc32 = sys.compute_Crc32(inCrc32, buffer, len);
+			if (wd.getCopies()[index].isInput() && _crcPolicy.protect(wd, index)) {
+				CopyData const& cd = wd.getCopies()[index];
+				global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+				CRCDirectory::RunList runs;
+				CRCDirectory::getRuns(cd, runs);
+
+				// Contiguous inputs may have been hashed already while checkpointing them
+				if ( runs.size() == 1 && isResiliencyEnabled() ) {
+					_crcDirectory.wait( reg );
+					BackupManager &backup = reinterpret_cast<BackupManager&>( getBackupMemory().getCache().getDevice() );
+					uint32_t crc;
+					bool mismatch;
+					if ( backup.takeChecksum( runs[0].address, runs[0].length, wd, crc )
+					     && _crcDirectory.check( reg, runs[0], crc, mismatch ) ) {
+						result |= mismatch;
+						continue;
 					}
 				}
-				else{
-					inCrc32 = sys.compute_Crc32(inCrc32, buffer, len);
-				}
-				setCRC32(key, inCrc32);
-				//std::cerr << "Computed CRC "<<inCrc32<<std::endl;
-			}
-		}
-	}
-	else{
-		for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
-			if (wd.getCopies()[index].isOutput()) {
-				CopyData cd = wd.getCopies()[index];
-				unsigned int inCrc32 = 0xFFFFFFFF;
-				size_t len = cd.getSize();
-				void *buffer = (void*) cd.getAddress();////
-				uint64_t key = cd.getAddress().value();
-				if(cd.getNumDimensions()>1){
-					for (unsigned int i = 0; i < cd.getDimensions()[1].accessed_length; i += 1){
-							uint64_t address = cd.getAddress().value() + cd.getDimensions()[0].accessed_length * i;
-							buffer = (void *) address;
-							len =  cd.getDimensions()[0].accessed_length;
-							inCrc32 = sys.compute_Crc32_Software(inCrc32, buffer, len);
+				for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+					bool mismatch;
+					// Large inputs are checked by sampling their blocks if the producer stored them
+					if ( _crcDirectory.isSampled(*it) ) {
+						_crcDirectory.wait( reg );
+						ResiliencyCosts::Scope cost( ResiliencyCosts::CRC_VERIFY, &wd, it->length );
+						if ( _crcDirectory.sample( reg, *it, mismatch ) ) {
+							result |= mismatch;
+							continue;
+						}
 					}
+					job->addRun(reg, *it, _crcChunkSize);
 				}
-				else{
-					inCrc32 = sys.compute_Crc32_Software(inCrc32, buffer, len);
-				}
-				setCRC32(key, inCrc32);
-				//std::cerr << "Computed CRC "<<inCrc32<<std::endl;
 			}
 		}
+		// Small inputs are not worth waking up other threads
+		if ( job->getBytes() >= _crcParallelThreshold ) {
+			_crcDirectory.share(*job);
+		}
 	}
 
-}
-
-bool System::checkSDCviaCRC32(WD &wd){
-	bool result = false;
-	if(_crcParam){
-		for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
-			if (wd.getCopies()[index].isInput()) {
-				CopyData cd = wd.getCopies()[index];
-				unsigned int computedCRC = 0xFFFFFFFF;
-				size_t len = cd.getSize();
-				void *buffer = (void*) cd.getAddress();////
-				uint64_t key = cd.getAddress().value();
-				if(cd.getNumDimensions()>1){
-					for (unsigned int i = 0; i < cd.getDimensions()[1].accessed_length; i += 1){
-							uint64_t address = cd.getAddress().value() + cd.getDimensions()[0].accessed_length * i;
-							buffer = (void *) address;
-							len =  cd.getDimensions()[0].accessed_length;
-							computedCRC = sys.compute_Crc32(computedCRC, buffer, len);
-					}
-				}else{
-					computedCRC = sys.compute_Crc32(computedCRC, buffer, len);
-				}
-				unsigned int storedCRC = getCRC32(key);
-				//std::cerr << "Computed CRC "<<computedCRC << " vs. Stored CRC "<<storedCRC<<std::endl;
-				if(storedCRC == 0){
-					setCRC32(key,computedCRC);
-					continue;
-				}
-				if(storedCRC != computedCRC){
-					setCRC32(key, computedCRC);
-					result = true;
-				}
-			}
+	_crcDirectory.join(*job);
+	for (unsigned run = 0; run < job->getNumRuns(); run++) {
+		bool mismatch;
+		// The producer's checksum may still be being computed
+		_crcDirectory.wait( job->getRegion(run) );
+		if ( _crcDirectory.check( job->getRegion(run), job->getRun(run), job->getCRC(run), mismatch ) ) {
+			result |= mismatch;
+		} else {
+			// Stored pieces only cover part of the run: check them one by one
+			ResiliencyCosts::Scope cost( ResiliencyCosts::CRC_VERIFY, &wd, job->getRun(run).length );
+			result |= _crcDirectory.verify( job->getRegion(run), job->getRun(run) );
 		}
 	}
-	else{
-			for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
-					if (wd.getCopies()[index].isInput()) {
-						CopyData cd = wd.getCopies()[index];
-						unsigned int computedCRC = 0xFFFFFFFF;
-						size_t len = cd.getSize();
-						void *buffer = (void*) cd.getAddress();
-						uint64_t key = cd.getAddress().value();
-						if(cd.getNumDimensions()>1){
-							for (unsigned int i = 0; i < cd.getDimensions()[1].accessed_length; i += 1){
-									uint64_t address = cd.getAddress().value() + cd.getDimensions()[0].accessed_length * i;
-									buffer = (void *) address;
-									len =  cd.getDimensions()[0].accessed_length;
-									computedCRC = sys.compute_Crc32_Software(computedCRC, buffer, len);
-							}
-						}else{
-							computedCRC = sys.compute_Crc32_Software(computedCRC, buffer, len);
-						}
-						unsigned int storedCRC = getCRC32(key);
-						//std::cerr << "Computed CRC "<<computedCRC << " vs. Stored CRC "<<storedCRC<<std::endl;
-						if(storedCRC == 0){
-							setCRC32(key,computedCRC);
-							continue;
-						}
-						if(storedCRC != computedCRC){
-							setCRC32(key, computedCRC);
-							result = true;
-						}
-					}
-				}
+	if ( timed ) _crcPolicy.hashed( job->getBytes(), OS::getMonotonicTimeUs() - start );
+	delete job;
+
+	if ( result ) {
+		error::FailureStats<error::SilentDataCorruption>::increase();
+		_crcPolicy.corrupted(wd);
 	}
-	//std::cerr <<"Does SDC Check Pass "<<result<<std::endl;
 	return result;
 }
 
-void System::restore(WD &wd) {
-	//std::cerr << "Restoring Task "<<wd.getId()<<std::endl;
+void System::prefetchCRC(WD &wd){
+	// Sampled checks are cheap enough to be done when the task starts
+	if ( !_crcAsync || _crcCoverage < 100.0f || wd.getCRCJob() != NULL ) return;
+
+	CRCJob *job = NEW CRCJob( ResiliencyCosts::getTaskType( &wd ) );
+	addInputRuns(wd, *job, _crcChunkSize, _crcPolicy);
+	if ( job->getNumRuns() == 0 ) {
+		delete job;
+		return;
+	}
+	// Idle threads hash the inputs while this thread finishes its current task
+	_crcDirectory.share(*job);
+	wd.setCRCJob(job);
+}
+
+void System::dropCRCJob(WD &wd){
+	CRCJob *job = wd.getCRCJob();
+	if ( job == NULL ) return;
+	wd.setCRCJob(NULL);
+	_crcDirectory.join(*job);
+	delete job;
+}
+
+bool System::restore(WD &wd) {
    debug ( "Resiliency CRC: Task ", wd.getId(), " is being recovered to be re-executed further on.");
-   // Wait for successors to finish.
-   //wd.waitCompletion();
+   if ( !isResiliencyEnabled() || !wd.isRecoverable() ) {
+      debug ( "Resiliency CRC: Task ", wd.getId(), " has no backup to recover its inputs from." );
+      return false;
+   }
+
+   BackupManager &backup = reinterpret_cast<BackupManager&>( getBackupMemory().getCache().getDevice() );
+   bool restored = true;
+   bool complete = true;
+   for (unsigned int index = 0; index < wd.getNumCopies() && complete; index++) {
+      if (!wd.getCopies()[index].isInput()) continue;
+      global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+      CRCDirectory::RunList runs;
+      CRCDirectory::getRuns(wd.getCopies()[index], runs);
+      for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end() && complete; ++it) {
+         CRCDirectory::DamageList damage;
+         _crcDirectory.locate( reg, *it, damage );
+         for (CRCDirectory::DamageList::const_iterator piece = damage.begin(); piece != damage.end(); ++piece) {
+            const bool held = wd._mcontrol.restoreBackupRange( index, memory::Address( piece->run.address ), piece->run.length );
+            // The restore copy hashes what it writes: a corrupted backup must not be reused
+            uint32_t crc;
+            const bool matches = held && backup.takeChecksum( piece->run.address, piece->run.length, wd, crc ) && crc == piece->crc;
+            if ( !matches && restoreFromAncestors( wd, *piece ) ) {
+               // An enclosing task still holds this version of the piece: nobody has to run again
+               _crcAncestorRepairs++;
+            } else if ( !held ) {
+               complete = false;
+               break;
+            } else if ( !matches ) {
+               debug ( "Resiliency CRC: the backup of task ", wd.getId(), " does not match the CRC of its input either." );
+               _crcCorruptedBackups++;
+               restored = false;
+            }
+            _crcRestoredPieces++;
+            _crcRestoredBytes += piece->run.length;
+         }
+      }
+   }
+
+   if ( !complete ) {
+      // Some piece is not held by the backups of its copy: restore them all, then check again
+      try {
+         wd._mcontrol.restoreBackupData();
+         while ( !wd._mcontrol.isDataRestored( wd ) ) {
+            myThread->idle();
+         }
+      } catch ( error::TaskRecoveryFailed &ex ) {
+         // Backups that were lost (like pages of a lazy backup) leave nothing to restore from
+         debug ( "Resiliency: Task ", wd.getId(), " recovery failed, its backups are lost." );
+         return false;
+      }
+      restored = true;
+      for (unsigned int index = 0; index < wd.getNumCopies() && restored; index++) {
+         if (!wd.getCopies()[index].isInput()) continue;
+         global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+         CRCDirectory::RunList runs;
+         CRCDirectory::getRuns(wd.getCopies()[index], runs);
+         for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end() && restored; ++it) {
+            CRCDirectory::DamageList damage;
+            _crcDirectory.locate( reg, *it, damage );
+            restored = damage.empty();
+         }
+      }
+      if ( !restored ) _crcCorruptedBackups++;
+   }
+
+   debug ( "Resiliency: Task ", wd.getId(), restored ? " recovery complete." : " recovery failed.");
+   return restored;
+}
+
+bool System::restoreFromAncestors(WD &wd, CRCDirectory::Damage const &piece) {
+   BackupManager &backup = reinterpret_cast<BackupManager&>( getBackupMemory().getCache().getDevice() );
+   // Backups are checked in scratch memory: the host data is only overwritten with a matching one
+   std::vector<char> scratch( piece.run.length );
+   for (WD *ancestor = wd.getParent(); ancestor != NULL; ancestor = ancestor->getParent()) {
+      // Only recoverable tasks keep backups of their inputs
+      if ( !ancestor->isRecoverable() || ancestor->isInvalid() ) continue;
+
+      for (unsigned int index = 0; index < ancestor->getNumCopies(); index++) {
+         if ( !ancestor->getCopies()[index].isInput() ) continue;
+         // The backup may be older than the corrupted data: it is only used if it matches the expected CRC
+         uint32_t crc;
+         if ( ancestor->_mcontrol.restoreBackupRange( index, memory::Address( piece.run.address ), piece.run.length, &scratch[0] )
+              && backup.takeChecksum( (uint64_t) &scratch[0], piece.run.length, *ancestor, crc ) && crc == piece.crc ) {
+            memcpy( (void *) piece.run.address, &scratch[0], piece.run.length );
+            debug ( "Resiliency CRC: input of task ", wd.getId(), " restored from the backup of task ", ancestor->getId() );
+            return true;
+         }
+      }
+   }
+   return false;
+}
 
-   // Restore the data
-   wd._mcontrol.restoreBackupData();
+void System::rollbackCRC(WD &wd) {
+   for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
+      if (!wd.getCopies()[index].isInput()) continue;
+      global_reg_t reg = index < wd._mcontrol._memCacheCopies.size() ? wd._mcontrol._memCacheCopies[index]._reg : global_reg_t();
+      CRCDirectory::RunList runs;
+      CRCDirectory::getRuns(wd.getCopies()[index], runs);
+      // Checksums of the discarded data may still be being computed
+      _crcDirectory.wait( reg );
+      for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+         // Restored data is hashed again, like any output
+         ResiliencyCosts::Scope cost( ResiliencyCosts::CRC_COMPUTE, &wd, it->length );
+         _crcDirectory.update( reg, *it );
+      }
+   }
+}
 
-   while ( !wd._mcontrol.isDataRestored( wd ) ) {
-      myThread->idle();
+void System::declareInjectionTargets(WD &wd) {
+   for (unsigned int index = 0; index < wd.getNumCopies(); index++) {
+      if (!wd.getCopies()[index].isOutput()) continue;
+      CRCDirectory::RunList runs;
+      CRCDirectory::getRuns(wd.getCopies()[index], runs);
+      for (CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+         error::ErrorInjectionInterface::declareOutput( (void *) it->address, it->length );
+      }
    }
-   debug ( "Resiliency: Task ", wd.getId(), " recovery complete.");
-   // Reset invalid state
-   //wd.setInvalid(false);
 }
 
 #endif
@@ -1504,7 +1508,16 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
       total_size = NANOS_ALIGNED_MEMORY_OFFSET(offset_PMD,size_PMD,1);
    }
 
-   chunk = NEW char[total_size];
+   // Chunks of finished tasks of the same kind have the same layout
+   int recycle_class = -1;
+   if ( _wdRecycling && *uwd == NULL ) {
+      recycle_class = _wdRecycler.getClass( devices, data_size, num_copies, num_dimensions, total_size );
+      if ( recycle_class >= 0 ) chunk = (char *) _wdRecycler.allocate( recycle_class );
+   }
+   if ( chunk == NULL ) {
+      chunk = NEW char[total_size];
+      if ( recycle_class >= 0 ) _wdRecycler.countAllocation();
+   }
    if ( props != NULL ) {
       if (props->clear_chunk)
           memset(chunk, 0, sizeof(char) * total_size);
@@ -1541,6 +1554,7 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
    
    // Set total size
    wd->setTotalSize(total_size );
+   wd->setRecycleClass( recycle_class );
    
    if ( wd->getNUMANode() >= (int)sys.getNumNumaNodes() )
       throw NANOS_INVALID_PARAM;
@@ -1738,6 +1752,25 @@ void System::duplicateWD ( WD **uwd, WD *wd)
    }
 }
 
+/*! \brief Destroys a WD and frees its chunk
+ *
+ *  \param [in] wd is the WD to destroy
+ *
+ *  \par Description:
+ *
+ *  If the WD was created by createWD with task recycling enabled, its chunk is
+ *  kept by the recycling pool for the next task of the same kind, unless the
+ *  pool is full.
+ *
+ *  \sa createWD
+ */
+void System::deleteWD ( WD *wd )
+{
+   const int cls = wd->getRecycleClass();
+   wd->~WorkDescriptor();
+   if ( cls < 0 || !_wdRecycler.recycle( cls, wd ) ) delete[] (char *) wd;
+}
+
 void System::setupWD ( WD &work, WD *parent )
 {
    work.setDepth( parent->getDepth() +1 );
@@ -2090,12 +2123,101 @@ void System::executionSummary( void )
    message( "============ Nanos++ Final Execution Summary ==================" );
    message( "=== Application ended in ", seconds, " seconds" );
    message( "=== ", std::dec, getCreatedTasks(),         " tasks have been executed" );
+   if ( _wdRecycling ) {
+      WDRecycler::Stats recycling;
+      _wdRecycler.getStats( recycling );
+      message( "=== ", std::dec, recycling.reused, " task chunks reused, ", recycling.allocated, " allocated, ",
+               recycling.recycled, " recycled, ", recycling.released, " freed because the pool was full (",
+               recycling.classes, " task classes)" );
+   }
+#ifdef NANOS_ENABLE_ALLOCATOR
+   Allocator::Stats allocations;
+   Allocator::getStats( allocations );
+   message( "=== ", std::dec, allocations.allocations, " small objects allocated (", allocations.frees, " freed by their thread, ",
+            allocations.remoteFrees, " by other threads), ", allocations.bigObjects, " big objects, ", allocations.chunkBytes,
+            " bytes in chunks, ", allocations.heaps, " heaps (", allocations.orphans, " left with objects in use)" );
+#endif
 #ifdef NANOS_RESILIENCY_ENABLED
    message( "=== ", std::dec, error::FailureStats<error::ErrorInjection>::get(),    " errors injected" );
    message( "=== ", std::dec, error::FailureStats<error::CheckpointFailure>::get(), " tasks could not be initialized (backup failed)" );
    message( "=== ", std::dec, error::FailureStats<error::ExecutionFailure>::get(),  " task executions failed" );
    message( "=== ", std::dec, error::FailureStats<error::TaskRecovery>::get(),      " tasks have been reexecuted" );
    message( "=== ", std::dec, error::FailureStats<error::DiscardedTask>::get(),     " tasks have been discarded (initialization, parent or sibling(s) failed" );
+   if ( _crc_enabled ) {
+      message( "=== ", std::dec, error::FailureStats<error::SilentDataCorruption>::get(), " tasks had corrupted inputs (detected by CRC)" );
+   }
+   if ( isResiliencyEnabled() ) {
+      BackupPool::Stats pool;
+      BackupManager &backup = reinterpret_cast<BackupManager&>( getBackupMemory().getCache().getDevice() );
+      backup.getPoolStats( pool );
+      message( "=== ", std::dec, pool.highWater, " of ", pool.capacity, " bytes of the backup pool used at most (",
+               pool.used, " in use, ", pool.cached, " cached in size classes, ", pool.requested, " of ",
+               pool.allocated, " allocated bytes requested)" );
+      if ( backup.getNumPartitions() > 1 ) {
+         for ( unsigned i = 0; i < backup.getNumPartitions(); i++ ) {
+            BackupPool::Stats partition;
+            backup.getPartition( i ).pool->getStats( partition );
+            message( "===    NUMA node ", std::dec, backup.getPartition( i ).node, ": ", partition.highWater, " of ",
+                     partition.capacity, " bytes used at most (", partition.used, " in use)" );
+         }
+         message( "=== ", std::dec, backup.getSpills(), " backups did not fit in the NUMA node of their thread" );
+      }
+      if ( backup.isCompressed() ) {
+         std::size_t encoded, stored;
+         backup.getCompressionStats( encoded, stored );
+         message( "=== ", std::dec, encoded, " bytes of backups compressed into ", stored, " bytes" );
+      }
+      if ( _backup_async ) {
+         unsigned copies, helped;
+         backup.getAsyncStats( copies, helped );
+         message( "=== ", std::dec, copies, " checkpoint copies made asynchronously (", helped, " by waiting workers)" );
+      }
+      if ( _lazy_checkpoint ) {
+         BackupLazyCopy::Stats lazy;
+         BackupLazyCopy::getStats( lazy );
+         message( "=== ", std::dec, lazy.inputs, " read-only inputs backed up lazily (", lazy.protectedBytes,
+                  " bytes write-protected, ", lazy.shared, " more readers shared them), ", lazy.copiedPages,
+                  " pages copied on write, ", lazy.lostPages, " lost" );
+      }
+      message( "=== ", std::dec, pool.threadHits, " backup allocations served by the thread, ", pool.sharedHits,
+               " by the shared lists, ", pool.refills, " refills, ", pool.large, " large, ", pool.failures, " failed" );
+   }
+   if ( _crc_enabled ) {
+      CRCDirectory::Stats stats;
+      _crcDirectory.getStats( stats );
+      message( "=== ", std::dec, stats.hits,       " CRC checks (", stats.mismatches, " mismatches)" );
+      message( "=== ", std::dec, stats.misses,     " CRC misses, ", stats.collisions, " collisions, ", stats.repairs, " repaired checksums" );
+      if ( _crcIncremental ) message( "=== ", std::dec, stats.reused, " unwritten output blocks not hashed again" );
+      if ( isResiliencyEnabled() ) {
+         message( "=== ", std::dec, _crcRestoredPieces.value(), " corrupted input pieces restored from backups (",
+                  _crcRestoredBytes.value(), " bytes, ", _crcAncestorRepairs.value(), " from the backups of enclosing tasks), ",
+                  _crcCorruptedBackups.value(), " corrupted backups found" );
+      }
+      if ( _crcCoverage < 100.0f ) {
+         message( "=== ", std::dec, stats.sampled, " large inputs checked by sampling ", stats.sampledBytes, " of ",
+                  stats.sampledTotal, " bytes (", _crcCoverage, "% coverage requested)" );
+      }
+      if ( _crcPolicy.isEnabled() ) {
+         CRCPolicy::Stats policy;
+         _crcPolicy.getStats( policy );
+         message( "=== ", std::dec, policy.protectedCopies, " task copies protected, ", policy.skippedCopies,
+                  " left unprotected (", policy.types, " task types, ", _crcBudget, "% budget)" );
+      }
+   }
+   if ( _redundancy.isEnabled() ) {
+      RedundantExecution::Stats redundancy;
+      _redundancy.getStats( redundancy );
+      message( "=== ", std::dec, redundancy.replicated, " tasks run redundantly (", redundancy.remote, " replicas run by idle threads), ",
+               redundancy.outvoted, " decided by a third execution, ", redundancy.unresolved, " unresolved, ",
+               redundancy.skipped, " run once because their outputs could not be redirected" );
+   }
+   nanos_resiliency_stats_t costs;
+   _resiliencyCosts.getTotal( costs );
+   for ( unsigned op = 0; op < ResiliencyCosts::OPERATIONS; op++ ) {
+      if ( costs.count[op] == 0 ) continue;
+      message( "=== ", std::dec, costs.count[op], " ", ResiliencyCosts::getName( (ResiliencyCosts::Operation) op ), " operations took ",
+               costs.time_ns[op] / 1000000.0, " ms (", costs.bytes[op], " bytes, ", _resiliencyCosts.getNumTaskTypes(), " task types)" );
+   }
 #endif // NANOS_RESILIENCY_ENABLED
    message( "===============================================================" );
 }
@@ -78,6 +78,8 @@ inline bool System::getDelayedStart () const { return _delayedStart; }
 
 inline int System::getCreatedTasks() const { return _schedStats._createdTasks.value(); }
 
+inline WDRecycler const & System::getWDRecycler() const { return _wdRecycler; }
+
 inline int System::getTaskNum() const { return _schedStats._totalTasks.value(); }
 
 inline int System::getReadyNum() const { return _schedStats._readyTasks.value(); }
@@ -519,11 +521,24 @@ inline bool System::haveDependencePendantWrites ( void *addr ) const
 #ifdef NANOS_RESILIENCY_ENABLED
 inline bool System::isResiliencyEnabled() const { return !_resiliency_disabled; }
 
+inline bool System::isLazyCheckpointEnabled() const { return _lazy_checkpoint; }
+inline bool System::isBackupAsync() const { return _backup_async; }
+
 inline unsigned System::getTaskMaxRetrials() const { return _task_max_trials; }
 
 inline size_t System::getBackupPoolSize() const { return _backup_pool_size; }
 
 inline std::string const& System::getInjectionPolicy() const { return _injectionPolicy; }
+
+inline bool System::isInjectingOutputs() const { return _injectOutputs; }
+
+inline CRCDirectory & System::getCRCDirectory() { return _crcDirectory; }
+
+inline CRCPolicy & System::getCRCPolicy() { return _crcPolicy; }
+
+inline ResiliencyCosts & System::getResiliencyCosts() { return _resiliencyCosts; }
+
+inline RedundantExecution & System::getRedundancy() { return _redundancy; }
 #endif
 #if 0
 inline void System::setFaultyAddress(uintptr_t addr) { _faulty_address = addr; }
@@ -62,8 +62,13 @@
 #include <vector>
 #include <string>
 
+#include "wdrecycler_decl.hpp"
+
 #ifdef NANOS_RESILIENCY_ENABLED
-#include "hashmap.hpp"
+#include "crcdirectory_decl.hpp"
+#include "crcpolicy_decl.hpp"
+#include "resiliencycosts_decl.hpp"
+#include "redundantexecution_decl.hpp"
 #endif
 
 namespace nanos {
@@ -245,29 +250,57 @@ namespace nanos {
 #ifdef NANOS_RESILIENCY_ENABLED
          //! Specifies which error injection policy is going to be loaded
          std::string               _injectionPolicy;
+         //! Task outputs are declared to the error injection policy (any policy but "none").
+         bool                      _injectOutputs;
          //! Disables resiliency mechanism at runtime.
          bool                      _resiliency_disabled;
          //! Specifies the maximum number of times a recoverable task can re-execute (avoids infinite recursion).
          unsigned                  _task_max_trials;
          //! Specifies the size of the memory pool used to store task input data backups.
          size_t                    _backup_pool_size;
-
-         //! Table storing byte CRCs for Intel instruction.
-         unsigned int 				_mul_table1_336[256];
-         //! Table storing byte CRCs for Intel instruction.
-         unsigned int 				_mul_table1_672[256];
-         //! Table storing byte CRCs when calculating CRC in software.
-         unsigned int				_crcTable[256];
-         //! Flag when TRUE showing the Intel instruction is available to calculate CRC. Otherwise CRCs are calculated in software.
-         bool 						_crcParam;
-         //! Struct for three copies of CRCs.
-         typedef struct{
-                unsigned int crc1;
-                unsigned int crc2;
-                unsigned int crc3;
-          }crcStruct;
-         //! Hashmap to store the computed CRCs.
-         HashMap<uint64_t, crcStruct> _hashmap;
+         //! Pages that back the backup pool: "small", "transparent" or "explicit" (huge pages).
+         std::string               _backup_pool_pages;
+         //! Compresses task backups before storing them in the backup pool.
+         bool                      _backup_compression;
+         //! Write-protects read-only task inputs instead of copying them into the backup pool.
+         bool                      _lazy_checkpoint;
+         bool                      _backup_async;
+
+         //! Name of the CRC-32C backend requested by the user ("auto" picks the fastest one).
+         std::string               _crcEngine;
+         //! Stores the computed CRCs of task outputs.
+         CRCDirectory              _crcDirectory;
+         //! Size of the pieces in which large task inputs are split to hash them in parallel.
+         size_t                    _crcChunkSize;
+         //! Inputs smaller than this (in bytes) are hashed by the thread that runs the task.
+         size_t                    _crcParallelThreshold;
+         //! Starts hashing the inputs of a task as soon as it is prefetched.
+         bool                      _crcAsync;
+         //! Only hashes again the blocks of large outputs that have been written (needs soft-dirty page bits).
+         bool                      _crcIncremental;
+         //! Outputs smaller than this (in bytes) are always hashed completely.
+         size_t                    _crcIncrementalMin;
+         //! Percentage of the blocks of large inputs that are hashed to check them (100 checks them completely).
+         float                     _crcCoverage;
+         //! Corrupted pieces of task inputs restored from their backups.
+         Atomic<unsigned>          _crcRestoredPieces;
+         Atomic<uint64_t>          _crcRestoredBytes;
+         //! Restored pieces that did not match their CRC either.
+         Atomic<unsigned>          _crcCorruptedBackups;
+         //! Corrupted pieces restored from the backup of an enclosing task instead of the task's own.
+         Atomic<unsigned>          _crcAncestorRepairs;
+         //! Decides which task copies are protected, keeping the hashing cost within a budget.
+         CRCPolicy                 _crcPolicy;
+         //! Protects copies according to their measured cost instead of protecting all of them.
+         bool                      _crcAdaptive;
+         //! Percentage of the run time of a task that can be spent hashing its data.
+         float                     _crcBudget;
+         //! Time and bytes spent in every resiliency operation, per task type and thread.
+         ResiliencyCosts           _resiliencyCosts;
+         //! Tasks run redundantly: "all", or a comma separated list of task descriptions.
+         std::string               _taskRedundancy;
+         //! Runs the selected tasks twice and compares their outputs.
+         RedundantExecution        _redundancy;
 #endif
 #ifdef NANOS_FAULT_INJECTION
          //! Enables random memory page poisoning for resiliency testing.
@@ -295,6 +328,8 @@ namespace nanos {
          Atomic<int> _atomicSeedWg;
          Atomic<unsigned int> _affinityFailureCount;
          bool                      _createLocalTasks;
+         bool                      _wdRecycling;            //!< Reuse the chunks of finished tasks
+         WDRecycler                _wdRecycler;
          bool _verboseDevOps;
          bool _verboseCopies;
          bool _splitOutputForThreads;
@@ -358,6 +393,11 @@ namespace nanos {
 
          void duplicateWD ( WD **uwd, WD *wd );
 
+        /* \brief Destroys a WD created by createWD or duplicateWD and frees its chunk,
+         * or keeps the chunk for a new task of the same kind.
+         */
+         void deleteWD ( WD *wd );
+
         /* \brief prepares a WD to be scheduled/executed.
          * \param work WD to be set up
          */
@@ -387,6 +427,9 @@ namespace nanos {
 
          int getCreatedTasks() const ;
 
+         //! \brief Returns the pool that recycles the chunks of finished tasks (with --wd-recycling).
+         WDRecycler const & getWDRecycler() const;
+
          int getTaskNum() const;
 
          int getIdleNum() const;
@@ -425,6 +468,8 @@ namespace nanos {
           * \brief Returns whether resiliency features are enabled or not
           */
          bool isResiliencyEnabled ( ) const;
+         bool isLazyCheckpointEnabled ( ) const;
+         bool isBackupAsync ( ) const;
 
          /*!
           * \brief Returns the maximum number of times a task can try to recover from an error by re-executing itself.
@@ -441,6 +486,31 @@ namespace nanos {
           */
          std::string const& getInjectionPolicy() const;
 
+         /*!
+          * \brief Returns whether task outputs have to be declared to the error injection policy.
+          */
+         bool isInjectingOutputs() const;
+
+         /*!
+          * \brief Returns the directory where the CRCs of task data are kept.
+          */
+         CRCDirectory & getCRCDirectory();
+
+         /*!
+          * \brief Returns the policy that decides which task copies are protected with a CRC.
+          */
+         CRCPolicy & getCRCPolicy();
+
+         /*!
+          * \brief Returns the accounts of the time and bytes spent in resiliency operations.
+          */
+         ResiliencyCosts & getResiliencyCosts();
+
+         /*!
+          * \brief Returns the mode that runs selected tasks redundantly.
+          */
+         RedundantExecution & getRedundancy();
+
          /*!
           * \brief Returns current task execution error count.
           */
@@ -466,41 +536,53 @@ namespace nanos {
           */
          int getDiscardedTasks ( ) const;
 
-         /*! \brief Obtain the CopyData's CRC-32 by majority vote among the copies.
+         /*!
+          * \brief Starts the CRC-32 calculation.
+          *
           */
-         unsigned int getCRC32(uint64_t address);
-
-          /*! \brief Set the CopyData's CRC-32 copies.
-           */
-          void setCRC32(uint64_t address, unsigned int);
-
+         void startComputeCRC(WD &wd);
+         /*!
+          * \brief Checks the existence of SDCs vi CRC-32.
+          *
+          */
+         bool checkSDCviaCRC32(WD &wd);
          /*!
-          * \brief Calculates the CRC-32 of the given buffer using Intel instruction.
+          * \brief Starts hashing the inputs of a prefetched WD, so that idle threads can help.
+          *
           */
-         unsigned int compute_Crc32(unsigned int initval, void *buf, size_t bufLen );
+         void prefetchCRC(WD &wd);
          /*!
-          * \brief Sub-function for the CRC-32 calculation.
+          * \brief Withdraws the input hashing started for a WD that is not going to run.
+          *
           */
-         unsigned int subcompute_Crc32(long long unsigned int  initval, void *buffer);
+         void dropCRCJob(WD &wd);
          /*!
-          * \brief Calculates the CRC-32 of the given buffer in software.
+          * \brief Restores the WD wd if some SDCs are detected.
+          *
+          * Only the pieces of the inputs that do not match their CRC are copied back from
+          * the backups, and the restored data is checked against the same CRC.
+          * \returns false if the data could not be restored to its expected CRC.
           */
-         unsigned int compute_Crc32_Software(unsigned int initval, void *buf, size_t bufLen);
+         bool restore(WD &wd);
          /*!
-          * \brief Starts the CRC-32 calculation.
+          * \brief Restores a corrupted piece of an input of \a wd from the backup of an enclosing task.
           *
+          * Used when the backup of the task itself can not repair it. Backups are only trusted if
+          * the restored data matches the CRC expected for the piece, so none of the enclosing
+          * tasks has to be invalidated and run again.
           */
-         void startComputeCRC(WD &wd);
+         bool restoreFromAncestors(WD &wd, CRCDirectory::Damage const &piece);
          /*!
-          * \brief Checks the existence of SDCs vi CRC-32.
+          * \brief Stores the CRC of the inputs of a WD whose data has been rolled back to its backup.
           *
+          * The stored CRCs belong to the data written later on, by the tasks that are going to be re-executed.
           */
-         bool checkSDCviaCRC32(WD &wd);
+         void rollbackCRC(WD &wd);
          /*!
-          * \brief Restores the WD wd if some SDCs are detected.
+          * \brief Declares the outputs of a finished WD as candidates for error injection.
           *
           */
-         void restore(WD &wd);
+         void declareInjectionTargets(WD &wd);
 
 #endif
 
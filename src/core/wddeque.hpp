@@ -528,6 +528,93 @@ inline bool WDLFQueue::removeWD( BaseThread *thread, WorkDescriptor *toRem, Work
    return false;
 }
 
+/***********************
+ * WDWorkStealingDeque *
+ ***********************/
+
+inline WDWorkStealingDeque::~WDWorkStealingDeque ()
+{
+   Buffer *buffer = _buffer;
+   while ( buffer != NULL ) {
+      Buffer *previous = buffer->_previous;
+      delete buffer;
+      buffer = previous;
+   }
+}
+
+inline bool WDWorkStealingDeque::empty ( void ) const
+{
+   return _bottom <= _top;
+}
+
+inline size_t WDWorkStealingDeque::size () const
+{
+   long size = _bottom - _top;
+   return size > 0 ? (size_t) size : 0;
+}
+
+inline WDWorkStealingDeque::Buffer * WDWorkStealingDeque::grow ( Buffer *buffer, long top, long bottom )
+{
+   Buffer *bigger = NEW Buffer( ( buffer->_mask + 1 ) * 2, buffer );
+   for ( long i = top; i < bottom; i++ )
+      bigger->put( i, buffer->get( i ) );
+   memoryFence();
+   _buffer = bigger;
+   return bigger;
+}
+
+inline void WDWorkStealingDeque::push ( WorkDescriptor *wd )
+{
+   const long bottom = _bottom;
+   const long top = _top;
+   Buffer *buffer = _buffer;
+   if ( bottom - top > buffer->_mask ) buffer = grow( buffer, top, bottom );
+
+   buffer->put( bottom, wd );
+   memoryFence();
+   _bottom = bottom + 1;
+
+   /* int tasks = */ ++( sys.getSchedulerStats()._readyTasks );
+}
+
+inline WorkDescriptor * WDWorkStealingDeque::pop ()
+{
+   const long bottom = _bottom - 1;
+   Buffer *buffer = _buffer;
+   _bottom = bottom;
+   memoryFence();
+   const long top = _top;
+
+   WorkDescriptor *wd = NULL;
+   if ( top <= bottom ) {
+      wd = buffer->get( bottom );
+      if ( top == bottom ) {
+         // Last WD: race with the thieves for it
+         if ( !compareAndSwap( &_top, top, top + 1 ) ) wd = NULL;
+         _bottom = bottom + 1;
+      }
+   } else {
+      _bottom = bottom + 1;
+   }
+
+   if ( wd != NULL ) --( sys.getSchedulerStats()._readyTasks );
+   return wd;
+}
+
+inline WorkDescriptor * WDWorkStealingDeque::steal ()
+{
+   const long top = _top;
+   memoryFence();
+   const long bottom = _bottom;
+   if ( top >= bottom ) return NULL;
+
+   WorkDescriptor *wd = _buffer->get( top );
+   if ( !compareAndSwap( &_top, top, top + 1 ) ) return NULL;
+
+   --( sys.getSchedulerStats()._readyTasks );
+   return wd;
+}
+
 template <typename T>
 inline WDPriorityQueue<T>::WDPriorityQueue( bool enableDeviceCounter, bool optimise, bool reverse, PriorityValueFun getter )
    : _dq(), _lock(), _nelems(0), _optimise( optimise ), _reverse( reverse ), _ndevs(), _deviceCounter( enableDeviceCounter ),
@@ -242,6 +242,62 @@ namespace nanos {
          bool removeWD( BaseThread *thread, WorkDescriptor *toRem, WorkDescriptor **next );
 
    };
+
+   /*! \brief Chase-Lev work-stealing deque of ready WorkDescriptors.
+    *
+    *  Only the thread that owns the deque pushes and pops at its bottom, without
+    *  locks; other threads steal from its top with a single compare and swap.
+    *  The buffer grows when it is full, and the old buffers are kept until the
+    *  deque is destroyed, since thieves may still be reading them. Unlike the
+    *  WDPool queues it does not check any scheduling constraint: the caller has
+    *  to check the WDs it takes.
+    */
+   class WDWorkStealingDeque
+   {
+      private:
+         struct Buffer
+         {
+            long                       _mask;      /**< Capacity - 1 (the capacity is a power of two) */
+            WorkDescriptor * volatile *_slots;
+            Buffer                    *_previous;  /**< Smaller buffer replaced by this one */
+
+            Buffer ( long capacity, Buffer *previous ) : _mask( capacity - 1 ), _slots( NEW WorkDescriptor * volatile[capacity] ), _previous( previous ) {}
+            ~Buffer () { delete[] _slots; }
+
+            WorkDescriptor *get ( long index ) const { return _slots[index & _mask]; }
+            void put ( long index, WorkDescriptor *wd ) { _slots[index & _mask] = wd; }
+         };
+
+         volatile long     _top;      /**< Next WD to steal */
+         volatile long     _bottom;   /**< Next free slot of the owner */
+         Buffer * volatile _buffer;
+      private:
+         /*! \brief WDWorkStealingDeque copy constructor (private)
+          */
+         WDWorkStealingDeque ( const WDWorkStealingDeque & );
+         /*! \brief WDWorkStealingDeque copy assignment operator (private)
+          */
+         const WDWorkStealingDeque & operator= ( const WDWorkStealingDeque & );
+
+         Buffer * grow ( Buffer *buffer, long top, long bottom );
+      public:
+         /*! \brief WDWorkStealingDeque default constructor
+          */
+         WDWorkStealingDeque ( long capacity = 256 ) : _top( 0 ), _bottom( 0 ), _buffer( NEW Buffer( capacity, NULL ) ) {}
+         /*! \brief WDWorkStealingDeque destructor
+          */
+         ~WDWorkStealingDeque ();
+
+         bool empty ( void ) const;
+         size_t size () const;
+
+         /*! \brief Pushes a WD at the bottom. Only called by the owner. */
+         void push ( WorkDescriptor *wd );
+         /*! \brief Pops the last WD pushed. Only called by the owner. */
+         WorkDescriptor * pop ();
+         /*! \brief Takes the oldest WD. Called by any thread; fails if another thread took it first. */
+         WorkDescriptor * steal ();
+   };
    
    /*! \brief Class used to compare WDs by priority.
     *  \see WDPriorityQueue::push
@@ -0,0 +1,192 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "wdrecycler_decl.hpp"
+#include "atomic.hpp"
+#include "lock.hpp"
+
+#include <string.h>
+
+using namespace nanos;
+
+namespace {
+   //! Magazine of the current thread (there is a single recycler, owned by System)
+   __thread void *_threadMagazine = NULL;
+}
+
+WDRecycler::WDRecycler () : _numClasses( 0 ), _classesLock(), _magazines( NULL )
+{
+   for ( unsigned i = 0; i < MAX_CLASSES; i++ ) {
+      _classes[i].ready = false;
+      _classes[i].shared = NULL;
+      _classes[i].sharedCount = 0;
+   }
+}
+
+WDRecycler::~WDRecycler ()
+{
+   for ( unsigned i = 0; i < MAX_CLASSES; i++ ) {
+      FreeChunk *chunk = _classes[i].shared;
+      while ( chunk != NULL ) {
+         FreeChunk *next = chunk->next;
+         delete[] (char *) chunk;
+         chunk = next;
+      }
+   }
+   Magazine *magazine = _magazines;
+   while ( magazine != NULL ) {
+      for ( unsigned i = 0; i < MAX_CLASSES; i++ ) {
+         for ( unsigned j = 0; j < magazine->count[i]; j++ ) delete[] (char *) magazine->chunks[i][j];
+      }
+      Magazine *next = magazine->next;
+      free( magazine );
+      magazine = next;
+   }
+}
+
+WDRecycler::Magazine & WDRecycler::getMagazine ()
+{
+   Magazine *magazine = (Magazine *) _threadMagazine;
+   if ( magazine != NULL ) return *magazine;
+
+   magazine = (Magazine *) malloc( sizeof( Magazine ) );
+   if ( magazine == NULL ) throw NANOS_ENOMEM;
+   memset( magazine, 0, sizeof( Magazine ) );
+
+   // Magazines are freed with the recycler, so that the chunks they keep are not lost
+   Magazine *head;
+   do {
+      head = _magazines;
+      magazine->next = head;
+   } while ( !compareAndSwap( &_magazines, head, magazine ) );
+
+   _threadMagazine = magazine;
+   return *magazine;
+}
+
+int WDRecycler::find ( unsigned slot, nanos_device_t const *devices, size_t dataSize, size_t numCopies, size_t numDimensions ) const
+{
+   // Slots are filled in probing order, so the key is not further than the first empty slot
+   for ( unsigned probes = 0; probes < MAX_CLASSES; probes++ ) {
+      Class const &c = _classes[slot];
+      if ( !c.ready ) return -1;
+      if ( c.devices == devices && c.dataSize == dataSize && c.numCopies == numCopies && c.numDimensions == numDimensions )
+         return (int) slot;
+      slot = ( slot + 1 ) % MAX_CLASSES;
+   }
+   return -1;
+}
+
+int WDRecycler::getClass ( nanos_device_t const *devices, size_t dataSize, size_t numCopies, size_t numDimensions, size_t totalSize )
+{
+   const unsigned slot = ( ( (uintptr_t) devices >> 4 ) ^ dataSize ^ ( numCopies << 8 ) ^ ( numDimensions << 12 ) ) % MAX_CLASSES;
+
+   int cls = find( slot, devices, dataSize, numCopies, numDimensions );
+   if ( cls < 0 ) {
+      LockBlock guard( _classesLock );
+      cls = find( slot, devices, dataSize, numCopies, numDimensions );
+      if ( cls < 0 ) {
+         if ( _numClasses.value() == MAX_CLASSES ) return -1;
+
+         unsigned free = slot;
+         while ( _classes[free].ready ) free = ( free + 1 ) % MAX_CLASSES;
+
+         Class &c = _classes[free];
+         c.devices = devices;
+         c.dataSize = dataSize;
+         c.numCopies = numCopies;
+         c.numDimensions = numDimensions;
+         c.totalSize = totalSize;
+         memoryFence();
+         c.ready = true;
+         _numClasses++;
+         cls = (int) free;
+      }
+   }
+
+   // The same devices array may describe different layouts (e.g. if it is on the stack)
+   if ( _classes[cls].totalSize != totalSize ) return -1;
+   return cls;
+}
+
+void * WDRecycler::allocate ( int cls )
+{
+   Magazine &magazine = getMagazine();
+   unsigned &count = magazine.count[cls];
+
+   if ( count == 0 ) {
+      // Take up to half a magazine from the shared list
+      Class &c = _classes[cls];
+      if ( c.shared == NULL ) return NULL;
+
+      LockBlock guard( c.lock );
+      while ( c.shared != NULL && count < MAGAZINE_SIZE / 2 ) {
+         magazine.chunks[cls][count++] = c.shared;
+         c.shared = c.shared->next;
+         c.sharedCount--;
+      }
+      if ( count == 0 ) return NULL;
+   }
+
+   magazine.reused++;
+   return magazine.chunks[cls][--count];
+}
+
+void WDRecycler::countAllocation ()
+{
+   getMagazine().allocated++;
+}
+
+bool WDRecycler::recycle ( int cls, void *chunk )
+{
+   Magazine &magazine = getMagazine();
+   unsigned &count = magazine.count[cls];
+
+   if ( count == MAGAZINE_SIZE ) {
+      // Give half of the magazine to the other threads
+      Class &c = _classes[cls];
+      LockBlock guard( c.lock );
+      while ( count > MAGAZINE_SIZE / 2 && c.sharedCount < MAX_SHARED ) {
+         FreeChunk *free = (FreeChunk *) magazine.chunks[cls][--count];
+         free->next = c.shared;
+         c.shared = free;
+         c.sharedCount++;
+      }
+      if ( count == MAGAZINE_SIZE ) {
+         magazine.released++;
+         return false;
+      }
+   }
+
+   magazine.chunks[cls][count++] = chunk;
+   magazine.recycled++;
+   return true;
+}
+
+void WDRecycler::getStats ( Stats &stats ) const
+{
+   memset( &stats, 0, sizeof( Stats ) );
+   for ( Magazine const *magazine = _magazines; magazine != NULL; magazine = magazine->next ) {
+      stats.reused += magazine->reused;
+      stats.allocated += magazine->allocated;
+      stats.recycled += magazine->recycled;
+      stats.released += magazine->released;
+   }
+   stats.classes = _numClasses.value();
+}
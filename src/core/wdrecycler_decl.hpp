@@ -0,0 +1,130 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef WDRECYCLER_DECL_HPP
+#define WDRECYCLER_DECL_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic_decl.hpp"
+#include "lock_decl.hpp"
+#include "allocator_decl.hpp"
+#include "nanos-int.h"
+
+namespace nanos {
+
+/*!
+ * \brief Keeps the chunks of finished tasks, so that System::createWD reuses
+ * them for new tasks of the same kind instead of allocating a new chunk.
+ *
+ * Tasks are grouped in classes by their devices (that identify the outline
+ * function) and by the size of their data, number of copies and number of
+ * dimensions, that fix the layout of the chunk. Every thread keeps a magazine
+ * of free chunks of each class, that only it accesses, and exchanges half of
+ * it with a list of the class shared by all threads when it gets empty or full.
+ */
+class WDRecycler {
+   public:
+      //! Task classes that can be told apart
+      static const unsigned MAX_CLASSES = 128;
+      //! Free chunks of each class kept by a thread
+      static const unsigned MAGAZINE_SIZE = 16;
+      //! Free chunks of each class kept in the shared list
+      static const unsigned MAX_SHARED = 1024;
+
+      //! Counters of the pool.
+      struct Stats {
+         uint64_t reused;     //!< Chunks of finished tasks given to new tasks
+         uint64_t allocated;  //!< Chunks allocated because none was free
+         uint64_t recycled;   //!< Chunks of finished tasks kept in the pool
+         uint64_t released;   //!< Chunks freed because the pool was full
+         unsigned classes;    //!< Task classes seen
+      };
+
+   private:
+      //! Free chunk, linked through its first bytes.
+      struct FreeChunk {
+         FreeChunk *next;
+      };
+
+      struct Class {
+         nanos_device_t const  *devices;
+         size_t                 dataSize;
+         size_t                 numCopies;
+         size_t                 numDimensions;
+         size_t                 totalSize;
+         volatile bool          ready;        //!< Key set, the slot can be compared
+         Lock                   lock;         //!< Protects the shared list
+         FreeChunk             *shared;
+         unsigned               sharedCount;
+         char                   pad[NANOS_CACHELINE];
+      };
+
+      //! Free chunks and counters of a thread. Only accessed by its thread.
+      struct Magazine {
+         void       *chunks[MAX_CLASSES][MAGAZINE_SIZE];
+         unsigned    count[MAX_CLASSES];
+         uint64_t    reused;
+         uint64_t    allocated;
+         uint64_t    recycled;
+         uint64_t    released;
+         Magazine   *next;                    //!< Next magazine in the list of all magazines
+      };
+
+      Class                   _classes[MAX_CLASSES];
+      Atomic<unsigned>        _numClasses;
+      Lock                    _classesLock;   //!< Serializes the creation of classes
+      Magazine * volatile     _magazines;
+
+      WDRecycler( WDRecycler const & );
+      WDRecycler & operator= ( WDRecycler const & );
+
+      //! \brief Returns the magazine of the current thread, creating it if needed.
+      Magazine & getMagazine ();
+
+      //! \brief Finds the class of a key starting at \a slot. Returns -1 if it is not there.
+      int find ( unsigned slot, nanos_device_t const *devices, size_t dataSize, size_t numCopies, size_t numDimensions ) const;
+
+   public:
+      WDRecycler ();
+
+      ~WDRecycler ();
+
+      /*! \brief Returns the class of the tasks created with these parameters, creating it if needed.
+       *  \returns -1 if there is no room for more classes, or if \a totalSize does not match the class.
+       */
+      int getClass ( nanos_device_t const *devices, size_t dataSize, size_t numCopies, size_t numDimensions, size_t totalSize );
+
+      //! \brief Returns a free chunk of the class, or NULL if there is none.
+      void * allocate ( int cls );
+
+      //! \brief Notifies that a chunk of the class had to be allocated.
+      void countAllocation ();
+
+      //! \brief Keeps the chunk of a finished task. Returns false if the pool is full and the chunk must be freed.
+      bool recycle ( int cls, void *chunk );
+
+      //! \brief Returns a snapshot of the counters. Counters of other threads may be slightly outdated.
+      void getStats ( Stats &stats ) const;
+};
+
+} // namespace nanos
+
+#endif /* WDRECYCLER_DECL_HPP */
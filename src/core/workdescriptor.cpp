@@ -303,6 +303,10 @@ void WorkDescriptor::finish ()
    if(sys._crc_enabled){
 	   sys.startComputeCRC(*this);
    }
+   // Outputs of finished tasks are the candidates of silent error injection
+   if ( sys.isInjectingOutputs() ) {
+      sys.declareInjectionTargets(*this);
+   }
 #endif
 
    // Getting execution time
@@ -45,7 +45,7 @@ inline WorkDescriptor::WorkDescriptor ( int ndevices, DeviceData **devs, size_t
                                  size_t numCopies, CopyData *copies, nanos_translate_args_t translate_args, const char *description )
                                : _id( sys.getWorkDescriptorId() ), _hostId(0), _components( 0 ), 
                                  _componentsSyncCond( EqualConditionChecker<int>( &_components.override(), 0 ) ), _parent(NULL), _forcedParent(NULL),
-                                 _data_size ( data_size ), _data_align( data_align ),  _data ( wdata ), _totalSize(0),
+                                 _data_size ( data_size ), _data_align( data_align ),  _data ( wdata ), _totalSize(0), _recycleClass( -1 ),
                                  _wdData ( NULL ), _scheduleData( NULL ),
                                  _flags(), _tiedTo ( NULL ), _tiedToLocation( (memory_space_id_t) -1 ),
                                  _state( INIT ), _syncCond( NULL ),  _myQueue ( NULL ), _depth ( 0 ),
@@ -59,7 +59,7 @@ inline WorkDescriptor::WorkDescriptor ( int ndevices, DeviceData **devs, size_t
                                  _translateArgs( translate_args ),
                                  _priority( 0 ), _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
                                  _copiesNotInChunk(false), _description(description), _instrumentationContextData(), _slicer(NULL),
-                                 _taskReductions(),_numFailedExecutions( 0 ),
+                                 _taskReductions(),_numFailedExecutions( 0 ), _crcJob( NULL ),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( nullptr ), _callback(0), _arguments(0),
                                  _mcontrol( this, numCopies )
                                  {
@@ -79,7 +79,7 @@ inline WorkDescriptor::WorkDescriptor ( DeviceData *device, size_t data_size, si
                                  size_t numCopies, CopyData *copies, nanos_translate_args_t translate_args, const char *description )
                                : _id( sys.getWorkDescriptorId() ), _hostId( 0 ), _components( 0 ), 
                                  _componentsSyncCond( EqualConditionChecker<int>( &_components.override(), 0 ) ), _parent(NULL), _forcedParent(NULL),
-                                 _data_size ( data_size ), _data_align ( data_align ), _data ( wdata ), _totalSize(0),
+                                 _data_size ( data_size ), _data_align ( data_align ), _data ( wdata ), _totalSize(0), _recycleClass( -1 ),
                                  _wdData ( NULL ), _scheduleData( NULL ),
                                  _flags(), _tiedTo ( NULL ), _tiedToLocation( (memory_space_id_t) -1 ),
                                  _state( INIT ), _syncCond( NULL ), _myQueue ( NULL ), _depth ( 0 ),
@@ -92,7 +92,7 @@ inline WorkDescriptor::WorkDescriptor ( DeviceData *device, size_t data_size, si
                                  _doSubmit(NULL), _doWait(), _depsDomain( sys.getDependenciesManager()->createDependenciesDomain() ),
                                  _translateArgs( translate_args ),
                                  _priority( 0 ),  _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
-                                 _copiesNotInChunk(false), _description(description), _instrumentationContextData(), _slicer(NULL), _taskReductions(),_numFailedExecutions( 0 ),
+                                 _copiesNotInChunk(false), _description(description), _instrumentationContextData(), _slicer(NULL), _taskReductions(),_numFailedExecutions( 0 ), _crcJob( NULL ),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( nullptr ), _callback(0), _arguments(0), _mcontrol( this, numCopies )
                                  {
                                      _devices = new DeviceData*[1];
@@ -112,7 +112,7 @@ inline WorkDescriptor::WorkDescriptor ( DeviceData *device, size_t data_size, si
 inline WorkDescriptor::WorkDescriptor ( const WorkDescriptor &wd, DeviceData **devs, CopyData * copies, void *data, const char *description )
                                : _id( sys.getWorkDescriptorId() ), _hostId( 0 ), _components( 0 ), 
                                  _componentsSyncCond( EqualConditionChecker<int>(&_components.override(), 0 ) ), _parent(NULL), _forcedParent(wd._forcedParent),
-                                 _data_size( wd._data_size ), _data_align( wd._data_align ), _data ( data ), _totalSize(0),
+                                 _data_size( wd._data_size ), _data_align( wd._data_align ), _data ( data ), _totalSize(0), _recycleClass( -1 ),
                                  _wdData ( NULL ), _scheduleData( NULL ),
                                  _flags(), _tiedTo ( wd._tiedTo ), _tiedToLocation( wd._tiedToLocation ),
                                  _state ( INIT ), _syncCond( NULL ), _myQueue ( NULL ), _depth ( wd._depth ),
@@ -127,7 +127,7 @@ inline WorkDescriptor::WorkDescriptor ( const WorkDescriptor &wd, DeviceData **d
                                  _depsDomain( sys.getDependenciesManager()->createDependenciesDomain() ),
                                  _translateArgs( wd._translateArgs ),
                                  _priority( wd._priority ), _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
-                                 _copiesNotInChunk( wd._copiesNotInChunk), _description(description), _instrumentationContextData(), _slicer(wd._slicer), _taskReductions(),_numFailedExecutions( 0 ),
+                                 _copiesNotInChunk( wd._copiesNotInChunk), _description(description), _instrumentationContextData(), _slicer(wd._slicer), _taskReductions(),_numFailedExecutions( 0 ), _crcJob( NULL ),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( nullptr ), _callback(0), _arguments(0), _mcontrol( this, wd._numCopies )
                                  {
                                     if ( wd._parent != NULL ) wd._parent->addWork(*this);
@@ -169,6 +169,11 @@ inline WorkDescriptor::~WorkDescriptor()
 
     if (_copiesNotInChunk)
         delete[] _copies;
+
+#ifdef NANOS_RESILIENCY_ENABLED
+    //! Withdraw the input checksums of a task that has not been executed
+    if ( _crcJob != NULL ) sys.dropCRCJob( *this );
+#endif
 }
 
 /* DeviceData inlined functions */
@@ -186,6 +191,10 @@ inline size_t WorkDescriptor::getDataAlignment () const { return _data_align; }
 
 inline void WorkDescriptor::setTotalSize ( size_t size ) { _totalSize = size; }
 
+inline void WorkDescriptor::setRecycleClass ( int cls ) { _recycleClass = cls; }
+
+inline int WorkDescriptor::getRecycleClass () const { return _recycleClass; }
+
 inline WorkDescriptor * WorkDescriptor::getParent() const { return _parent!=NULL?_parent:_forcedParent ; }
 inline void WorkDescriptor::forceParent ( WorkDescriptor * p ) { _forcedParent = p; }
 
@@ -564,6 +573,10 @@ inline unsigned WorkDescriptor::getFailedExecutions() const { return _numFailedE
 
 inline void WorkDescriptor::increaseFailedExecutions() { _numFailedExecutions++; }
 
+inline CRCJob * WorkDescriptor::getCRCJob() const { return _crcJob; }
+
+inline void WorkDescriptor::setCRCJob( CRCJob *job ) { _crcJob = job; }
+
 inline void WorkDescriptor::restore()
 {
    debug ( "Resiliency: Task ", getId(), " is being recovered to be re-executed further on.");
@@ -577,6 +590,7 @@ inline void WorkDescriptor::restore()
    while ( !_mcontrol.isDataRestored( *this ) ) {
       myThread->idle();
    }
+   if ( sys._crc_enabled ) sys.rollbackCRC( *this );
 
    // Reset invalid state
    setInvalid(false);
@@ -55,6 +55,8 @@
 
 namespace nanos {
 
+class CRCJob;
+
 typedef std::set<const Device *>  DeviceList;
 
    /*! \brief This class represents a device object
@@ -237,6 +239,7 @@ typedef std::set<const Device *>  DeviceList;
          size_t                        _data_align;             //!< WD data alignment
          void                         *_data;                   //!< WD data
          size_t                        _totalSize;              //!< Chunk total size, when allocating WD + extra data
+         int                           _recycleClass;           //!< Class of the recycling pool the chunk goes back to (-1 if none)
          void                         *_wdData;                 //!< Internal WD data. Allowing higher layer to associate data to WD
          ScheduleWDData               *_scheduleData;           //!< Data set by the scheduling policy
          WDFlags                       _flags;                  //!< WD Flags
@@ -275,6 +278,7 @@ typedef std::set<const Device *>  DeviceList;
          task_reduction_vector_t       _taskReductions;         //< Vector of task reductions
          int                           _criticality;
          unsigned int                  _numFailedExecutions;    //!< Number of times this task has been executed (resiliency)
+         CRCJob                       *_crcJob;                 //!< Input checksums being computed ahead of the execution (resiliency)
          //Atomic< std::list<GraphEntry *> * > _myGraphRepList;
          //bool _listed;
          void                        (*_notifyCopy)( WD &wd, BaseThread const &thread);
@@ -406,6 +410,10 @@ typedef std::set<const Device *>  DeviceList;
 
          void setTotalSize ( size_t size );
 
+         void setRecycleClass ( int cls );
+
+         int getRecycleClass () const;
+
          void setBlocked ();
 
          bool isReady () const;
@@ -774,6 +782,12 @@ typedef std::set<const Device *>  DeviceList;
 
          //! \brief Restores the workdescriptor to its original state.
          void restore();
+
+         //! \brief Returns the checksums of the inputs that are being computed ahead of the execution (if any).
+         CRCJob * getCRCJob() const;
+
+         //! \brief Sets the checksums of the inputs that are being computed ahead of the execution.
+         void setCRCJob( CRCJob *job );
 #endif
 
          unsigned getFailedExecutions() const;
@@ -0,0 +1,336 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "schedule.hpp"
+#include "wddeque.hpp"
+#include "plugin.hpp"
+#include "system.hpp"
+#include "config.hpp"
+
+#include <vector>
+
+namespace nanos {
+   namespace ext {
+
+      /*! \brief Work-stealing scheduler
+       *
+       *  Every thread keeps the tasks it creates in its own Chase-Lev deque and
+       *  runs the newest one first; idle threads steal the oldest task of a
+       *  random victim, trying the threads of their own NUMA node before the
+       *  rest. Tasks that can not be kept in a deque (tied to a location or
+       *  sliced) and tasks that a thread takes but can not run go to a queue
+       *  shared by the team. With priorities, prioritized tasks go to a shared
+       *  priority queue that is served before the deques.
+       */
+      class WorkStealing : public SchedulePolicy
+      {
+         public:
+            static bool       _usePriority;
+            static bool       _useSmartPriority;
+         private:
+            struct TeamData : public ScheduleTeamData
+            {
+               /*! queue of ready tasks that can not be kept in a deque */
+               WDPool                *_shared;
+               /*! queue of ready tasks with a priority */
+               WDPriorityQueue<>     *_priorities;
+
+               TeamData () : ScheduleTeamData(), _shared( NEW WDDeque( true /* enableDeviceCounter */ ) ), _priorities( NULL )
+               {
+                  if ( _usePriority || _useSmartPriority ) _priorities = NEW WDPriorityQueue<>( true /* enableDeviceCounter */, true /* optimise option */ );
+               }
+               virtual ~TeamData () { delete _shared; delete _priorities; }
+            };
+
+            struct ThreadData : public ScheduleThreadData
+            {
+               /*! ready tasks queued by the thread itself */
+               WDWorkStealingDeque    _deque;
+               /*! ready tasks queued for this thread by other threads */
+               WDDeque                _inbox;
+               /*! state of the victim selection */
+               unsigned               _seed;
+               int                    _node;
+
+               ThreadData () : ScheduleThreadData(), _deque(), _inbox( false ), _seed( 0 ), _node( -1 ) {}
+               virtual ~ThreadData () {}
+            };
+
+            /* disable copy and assigment */
+            explicit WorkStealing ( const WorkStealing & );
+            const WorkStealing & operator= ( const WorkStealing & );
+
+         public:
+            WorkStealing() : SchedulePolicy ( "Work Stealing" )
+            {
+               _usePriority = _usePriority && sys.getPrioritiesNeeded();
+            }
+
+            virtual ~WorkStealing () {}
+
+            virtual size_t getTeamDataSize () const { return sizeof(TeamData); }
+            virtual size_t getThreadDataSize () const { return sizeof(ThreadData); }
+
+            virtual ScheduleTeamData * createTeamData ()
+            {
+               return NEW TeamData();
+            }
+
+            virtual ScheduleThreadData * createThreadData ()
+            {
+               return NEW ThreadData();
+            }
+
+         private:
+            bool isPrioritized ( WD &wd ) const
+            {
+               return usingPriorities() && wd.getPriority() != 0;
+            }
+
+            /*!
+             *  \brief Checks whether \a thread can run a task taken from a deque.
+             *  Tasks that it can not run are left in the shared queue, which checks the constraints.
+             */
+            WD * take ( BaseThread *thread, WD *wd, TeamData &tdata )
+            {
+               if ( wd == NULL || Scheduler::checkBasicConstraints( *wd, *thread ) ) return wd;
+
+               tdata._shared->push_back( wd );
+               return NULL;
+            }
+
+            //! \brief Steals a task from a random victim, trying the ones in the NUMA node of \a thread first.
+            WD * steal ( BaseThread *thread, ThreadData &data, TeamData &tdata )
+            {
+               ThreadTeam *team = thread->getTeam();
+               const int size = team->getFinalSize();
+               if ( size <= 1 ) return NULL;
+
+               if ( data._node < 0 ) {
+                  data._node = thread->runningOn()->getNumaNode();
+                  data._seed = thread->getId() * 2654435761U + 1;
+               }
+               // xorshift
+               data._seed ^= data._seed << 13;
+               data._seed ^= data._seed >> 17;
+               data._seed ^= data._seed << 5;
+               const int first = data._seed % size;
+
+               for ( int local = 1; local >= 0; local-- ) {
+                  for ( int i = 0; i < size; i++ ) {
+                     BaseThread &victim = team->getThread( ( first + i ) % size );
+                     if ( &victim == thread || victim.getTeam() == NULL ) continue;
+                     if ( ( (int) victim.runningOn()->getNumaNode() == data._node ) != ( local == 1 ) ) continue;
+
+                     ThreadData &vdata = ( ThreadData & ) *victim.getTeamData()->getScheduleData();
+                     WD *wd = take( thread, vdata._deque.steal(), tdata );
+                     if ( wd == NULL ) wd = vdata._inbox.pop_back( thread );
+                     if ( wd != NULL ) return wd;
+                  }
+               }
+               return NULL;
+            }
+
+         public:
+            /*!
+            *  \brief Enqueues a work descriptor: in the deque of \a thread if it is the
+            *  current thread, or in its inbox otherwise (deques only admit their owner)
+            */
+            virtual void queue ( BaseThread *thread, WD &wd )
+            {
+               BaseThread *targetThread = wd.isTiedTo();
+               if ( targetThread ) {
+                  targetThread->addNextWD( &wd );
+                  return;
+               }
+
+               TeamData &tdata = ( TeamData & ) *thread->getTeam()->getScheduleData();
+               if ( isPrioritized( wd ) ) {
+                  tdata._priorities->push_back( &wd );
+               } else if ( wd.isTiedLocation() || wd.getSlicer() != NULL ) {
+                  tdata._shared->push_back( &wd );
+               } else {
+                  ThreadData &data = ( ThreadData & ) *thread->getTeamData()->getScheduleData();
+                  if ( thread == myThread ) data._deque.push( &wd );
+                  else data._inbox.push_back( &wd );
+               }
+            }
+
+            /*!
+            *  \brief Enqueues a batch of work descriptors. Tasks for the current thread
+            *  are pushed to its deque without locking; prioritized ones are inserted
+            *  in the priority queue at once.
+            */
+            virtual void queue ( BaseThread ** threads, WD ** wds, size_t numElems )
+            {
+               fatal_cond( numElems == 0, "Cannot queue 0 elements.");
+
+               ThreadTeam* team = threads[0]->getTeam();
+               std::vector<WD *> prioritized;
+
+               for ( size_t i = 0; i < numElems; ++i ) {
+                  if ( threads[i]->getTeam() != team ) fatal( "Batch submission does not support different teams" );
+
+                  if ( isPrioritized( *wds[i] ) && wds[i]->isTiedTo() == NULL ) prioritized.push_back( wds[i] );
+                  else queue( threads[i], *wds[i] );
+               }
+
+               if ( !prioritized.empty() ) {
+                  TeamData &tdata = ( TeamData & ) *team->getScheduleData();
+                  LockBlock lock( tdata._priorities->getLock() );
+                  tdata._priorities->push_back( &prioritized[0], prioritized.size() );
+               }
+            }
+
+            /*! This scheduling policy supports all WDs, no restrictions. */
+            bool isValidForBatch ( const WD * wd ) const
+            {
+               return true;
+            }
+
+            /*!
+             * \brief Propagates the priority of a WD to its immediate predecessors,
+             * when they are waiting in the priority queue.
+             * \param [in/out] predecessor The preceding DependableObject.
+             * \param [in] successor DependableObject whose WD priority has to be
+             * propagated.
+             */
+            void atSuccessor   ( DependableObject &successor, DependableObject &predecessor )
+            {
+               if ( ! _useSmartPriority ) return;
+
+               WD *pred = ( WD* ) predecessor.getRelatedObject();
+               if ( pred == NULL ) return;
+
+               WD *succ = ( WD* ) successor.getRelatedObject();
+               if ( succ == NULL ) {
+                  fatal( "SmartPriority::successorFound  successor->getRelatedObject() is NULL" );
+               }
+
+               // Propagate priority
+               if ( pred->getPriority() < succ->getPriority() ) {
+                  pred->setPriority( succ->getPriority() );
+
+                  // Reorder, if it is not already in a deque
+                  TeamData &tdata = ( TeamData & ) *myThread->getTeam()->getScheduleData();
+                  if ( pred->getMyQueue() == tdata._priorities ) tdata._priorities->reorderWD( pred );
+               }
+            }
+
+            virtual WD *atSubmit ( BaseThread *thread, WD &newWD )
+            {
+               queue( thread, newWD );
+               return 0;
+            }
+
+            virtual WD *atIdle ( BaseThread *thread, int numSteal );
+
+            WD * atPrefetch ( BaseThread *thread, WD &current )
+            {
+               WD * found = current.getImmediateSuccessor(*thread);
+               if ( found && usingPriorities() ) {
+                  TeamData &tdata = ( TeamData & ) *thread->getTeam()->getScheduleData();
+                  if ( found->getPriority() < tdata._priorities->maxPriority() ) {
+                     queue( thread, *found );
+                     found = NULL;
+                  }
+               }
+               return found != NULL ? found : atIdle( thread, false );
+            }
+
+            WD * atBeforeExit ( BaseThread *thread, WD &current, bool schedule )
+            {
+               WD * found = current.getImmediateSuccessor(*thread);
+               if ( found && usingPriorities() && schedule ) {
+                  TeamData &tdata = ( TeamData & ) *thread->getTeam()->getScheduleData();
+                  if ( found->getPriority() < tdata._priorities->maxPriority() ) {
+                     queue( thread, *found );
+                     found = NULL;
+                  }
+               }
+               return found;
+            }
+
+            bool reorderWD ( BaseThread *t, WD *wd )
+            {
+               if ( !usingPriorities() ) return true;
+
+               // Only the priority queue is ordered: tasks queued as unprioritized keep their place
+               TeamData &tdata = ( TeamData & ) *t->getTeam()->getScheduleData();
+               if ( wd->getMyQueue() != tdata._priorities ) return true;
+               return tdata._priorities->reorderWD( wd );
+            }
+
+            bool usingPriorities() const
+            {
+               return _usePriority || _useSmartPriority;
+            }
+      };
+
+      /*!
+       *  \brief Function called by the scheduler when a thread becomes idle: runs prioritized
+       *  tasks first, then the newest task of its own deque, and steals when it has nothing left
+       *  \param thread pointer to the thread to be scheduled
+       *  \sa BaseThread
+       */
+      WD * WorkStealing::atIdle ( BaseThread *thread, int numSteal )
+      {
+         TeamData &tdata = ( TeamData & ) *thread->getTeam()->getScheduleData();
+         ThreadData &data = ( ThreadData & ) *thread->getTeamData()->getScheduleData();
+         WD *wd = NULL;
+
+         if ( usingPriorities() && tdata._priorities->maxPriority() > 0 ) wd = tdata._priorities->pop_front( thread );
+         if ( wd == NULL ) wd = take( thread, data._deque.pop(), tdata );
+         if ( wd == NULL ) wd = data._inbox.pop_front( thread );
+         if ( wd == NULL ) wd = tdata._shared->pop_front( thread );
+         if ( wd == NULL ) wd = steal( thread, data, tdata );
+         // Tasks with a negative priority run when there is nothing else to do
+         if ( wd == NULL && usingPriorities() ) wd = tdata._priorities->pop_front( thread );
+
+         return wd;
+      }
+
+      bool WorkStealing::_usePriority = true;
+      bool WorkStealing::_useSmartPriority = false;
+
+      class WSSchedPlugin : public Plugin
+      {
+         public:
+            WSSchedPlugin() : Plugin( "Work-stealing scheduling Plugin",1 ) {}
+
+            virtual void config( Config& cfg )
+            {
+               cfg.setOptionsSection( "WS module", "Work-stealing scheduling module" );
+
+               cfg.registerConfigOption ( "schedule-priority", NEW Config::FlagOption( WorkStealing::_usePriority ), "Priority queue used as ready task queue");
+               cfg.registerArgOption( "schedule-priority", "schedule-priority" );
+
+               cfg.registerConfigOption ( "schedule-smart-priority", NEW Config::FlagOption( WorkStealing::_useSmartPriority ), "Smart priority queue propagates high priorities to predecessors");
+               cfg.registerArgOption( "schedule-smart-priority", "schedule-smart-priority" );
+            }
+
+            virtual void init() {
+               sys.setDefaultSchedulePolicy(NEW WorkStealing());
+            }
+      };
+
+   }
+}
+
+DECLARE_PLUGIN("sched-ws",nanos::ext::WSSchedPlugin);
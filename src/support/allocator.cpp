@@ -19,44 +19,122 @@
 
 #include "allocator.hpp"
 #include "basethread.hpp"
+#include <algorithm>
 
 using namespace nanos;
 
-Allocator *nanos::allocator;
+__thread Allocator *nanos::allocator = NULL;
 
 size_t Allocator::_headerSize = NANOS_ALIGNED_MEMORY_OFFSET( 0, sizeof(Allocator::ObjectHeader), 16 );
+Allocator::Heap * volatile Allocator::_heaps = NULL;
 
 Allocator & nanos::getAllocator ( void )
 {
+   BaseThread *my_thread = getMyThreadSafe();
+   if ( my_thread != NULL ) return my_thread->getAllocator();
+
    if (!allocator) {
       allocator = (Allocator *) malloc(sizeof(Allocator));
       if ( allocator == NULL ) throw(NANOS_ENOMEM);
       new (allocator) Allocator();
    }
+   return *allocator;
+}
 
-   BaseThread *my_thread = getMyThreadSafe();
-   if ( my_thread == NULL ) return *allocator;
-   else return my_thread->getAllocator();
+Allocator::Allocator ( )
+{
+   _heap = (Heap *) malloc( sizeof(Heap) );
+   if ( _heap == NULL ) throw(NANOS_ENOMEM);
+   memset( _heap, 0, sizeof(Heap) );
+
+   // Heaps are never freed, so that they can be listed without locking
+   Heap *head;
+   do {
+      head = _heaps;
+      _heap->_nextHeap = head;
+   } while ( !__sync_bool_compare_and_swap( &_heaps, head, _heap ) );
+}
+
+Allocator::~Allocator ()
+{
+   Heap &heap = *_heap;
+   // Remote frees are counted once they are done, so none is pending if nothing is in use
+   __sync_synchronize();
+   if ( heap._allocations - heap._frees - heap._remoteFrees != 0 ) {
+      heap._orphan = true;
+      return;
+   }
+
+   Chunk *chunk = heap._chunks;
+   while ( chunk != NULL ) {
+      Chunk *next = chunk->_next;
+      free( chunk );
+      chunk = next;
+   }
+   for ( size_t i = 0; i < _numClasses; i++ ) {
+      heap._free[i] = NULL;
+      heap._bump[i] = heap._bumpEnd[i] = NULL;
+   }
+   heap._chunks = NULL;
+   heap._remote = NULL;
 }
 
-void * Allocator::Arena::allocate ( void )
+Allocator::ObjectHeader * Allocator::refill ( size_t cls )
 {
-   unsigned int obj;
+   Heap &heap = *_heap;
 
-   if ( !_free ) return NULL;
+   ObjectHeader *remote = __sync_lock_test_and_set( &heap._remote, (ObjectHeader *) NULL );
+   while ( remote != NULL ) {
+      ObjectHeader *next = nextFree( remote );
+      nextFree( remote ) = heap._free[remote->_class];
+      heap._free[remote->_class] = remote;
+      remote = next;
+   }
 
-   for ( obj = 0 ; obj < numObjects ; obj++ ) {
-      if ( _bitmap[obj]._bit ) break;
+   ObjectHeader *ptr = heap._free[cls];
+   if ( ptr != NULL ) {
+      heap._free[cls] = nextFree( ptr );
+      return ptr;
    }
 
-   if (obj == numObjects) {
-      _free = false;
-      return NULL; 
+   const size_t objectSize = 1UL << ( cls + _minShift );
+   if ( heap._bump[cls] + objectSize > heap._bumpEnd[cls] ) {
+      const size_t size = std::max( _chunkSize, objectSize * 8 );
+      Chunk *chunk = (Chunk *) malloc( size );
+      if ( chunk == NULL ) throw(NANOS_ENOMEM);
+      chunk->_next = heap._chunks;
+      heap._chunks = chunk;
+      heap._chunkBytes += size;
+      heap._bump[cls] = ((char *) chunk ) + NANOS_ALIGNED_MEMORY_OFFSET( 0, sizeof(Chunk), 16 );
+      heap._bumpEnd[cls] = ((char *) chunk ) + size;
    }
 
-   _bitmap[obj]._bit = false;
+   ptr = (ObjectHeader *) heap._bump[cls];
+   heap._bump[cls] += objectSize;
+   ptr->_heap = _heap;
+   ptr->_class = cls;
+   return ptr;
+}
 
-   return (void *) &_arena[obj*_objectSize];
+void Allocator::addStats ( Heap const &heap, Stats &stats )
+{
+   stats.allocations += heap._allocations;
+   stats.frees += heap._frees;
+   stats.remoteFrees += heap._remoteFrees;
+   stats.bigObjects += heap._bigObjects;
+   stats.chunkBytes += heap._chunkBytes;
+   stats.heaps++;
+   if ( heap._orphan ) stats.orphans++;
 }
 
+void Allocator::getStats ( Stats &stats )
+{
+   memset( &stats, 0, sizeof(Stats) );
+   for ( Heap *heap = _heaps; heap != NULL; heap = heap->_nextHeap ) addStats( *heap, stats );
+}
 
+void Allocator::getHeapStats ( Stats &stats ) const
+{
+   memset( &stats, 0, sizeof(Stats) );
+   addStats( *_heap, stats );
+}
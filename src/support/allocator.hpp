@@ -27,34 +27,26 @@
 
 namespace nanos {
 
-extern Allocator *allocator;
+//! Allocator of the threads that are not runtime threads
+extern __thread Allocator *allocator;
 
-inline size_t Allocator::Arena::getObjectSize () const
+inline void const * Allocator::getThreadToken ( void )
 {
-   return _objectSize;
+   // Any thread local variable has a different address in every thread
+   static __thread char token;
+   return &token;
 }
 
-inline void Allocator::Arena::deallocate ( void *object )
+inline size_t Allocator::getClass ( size_t size )
 {
-   unsigned long offset = ((char *) object - _arena);
-   unsigned long index = offset / _objectSize;
-
-   //if (sys.getNetwork()->getNodeNum() == 0 && _objectSize > 32768) std::cerr << "Free object size " << _objectSize << " : " << (void *) _objectSize << " addr range is " << (void *) object << ":" << ((void *) (((char*)object)+_objectSize)) << " this is arena " << (void*) this << std::endl;
-   _free = true;
-   _bitmap[index]._bit = true;
-
-   //if (sys.getNetwork()->getNodeNum() == 0 && _objectSize > 32768) std::cerr << "memset from " << (void *) &_arena[index*_objectSize] << " to " << (void*) (&_arena[index*_objectSize+_objectSize]) << std::endl;
-   //memset( &_arena[index*_objectSize], 0, _objectSize );
+   size_t realSize = size + _headerSize;
+   if ( realSize <= ( 1UL << _minShift ) ) return 0;
+   return ( sizeof( unsigned long ) * 8 - __builtin_clzl( realSize - 1 ) ) - _minShift;
 }
 
-inline Allocator::Arena * Allocator::Arena::getNext ( void ) const
+inline Allocator::ObjectHeader * & Allocator::nextFree ( ObjectHeader *object )
 {
-   return _next;
-}
-
-inline void Allocator::Arena::setNext ( Arena * a )
-{
-   _next = a;
+   return *(ObjectHeader **) ( ((char *) object ) + _headerSize );
 }
 
 inline void * Allocator::allocateBigObject ( size_t size )
@@ -63,59 +55,26 @@ inline void * Allocator::allocateBigObject ( size_t size )
 
    ptr = (ObjectHeader *) malloc( size + _headerSize );
    if ( ptr == NULL ) throw(NANOS_ENOMEM);
-   ptr->_arena = NULL; 
+   ptr->_heap = NULL;
+   ptr->_class = size;
+   _heap->_bigObjects++;
 
    return  ((char *) ptr ) + _headerSize;
 }
 
 inline void * Allocator::allocate ( size_t size, const char* file, int line )
 {
-   if ( size > _sizeOfBig ) return allocateBigObject(size);
-
-   /* realSize is (size + header )'s next power of 2 */
-   size_t realSize = size + _headerSize + 1;
-   realSize |= realSize >> 1;
-   realSize |= realSize >> 2;
-   realSize |= realSize >> 4;
-   realSize |= realSize >> 8;
-   realSize |= realSize >> 16;
-   realSize++;
- 
-
-   ArenaCollection::iterator it;
-   for ( it = _arenas.begin(); it != _arenas.end(); it++ ) {
-      if ( (*it)->getObjectSize() == realSize ) break;
-   }
-
-   Arena *arena = NULL;
-
-   if ( it == _arenas.end() ) {
-      // no arena found for that size, create a new one
-      arena = (Arena *) malloc ( sizeof(Arena) );
-      if ( arena == NULL ) throw(NANOS_ENOMEM);
-      new ( arena ) Arena( realSize );
-      _arenas.push_back( arena );
-   }
-   else arena = *it;
+   if ( size + _headerSize > _maxSmall ) return allocateBigObject(size);
 
+   Heap &heap = *_heap;
+   if ( heap._owner == NULL ) heap._owner = getThreadToken();
 
-   ObjectHeader * ptr = NULL;
+   const size_t cls = getClass( size );
+   ObjectHeader *ptr = heap._free[cls];
+   if ( ptr != NULL ) heap._free[cls] = nextFree( ptr );
+   else ptr = refill( cls );
 
-   while ( ptr == NULL ) {
-      ptr = (ObjectHeader *) arena->allocate();
-      if ( ptr == NULL ) { 
-          if ( arena->getNext() == NULL ) {
-             Arena *next = ( Arena *) malloc ( sizeof(Arena) );
-             if ( next == NULL ) throw(NANOS_ENOMEM);
-             new (next) Arena(realSize);
-             arena->setNext( next );
-          }
-          arena = arena->getNext(); 
-      }
-   }
-
-   ptr->_arena = arena;
-   //if (sys.getNetwork()->getNodeNum() == 0 && realSize > 32768) std::cerr << "Allocate object size " << realSize << " : " << (void *) realSize << " addr range is " << (void *) ptr << ":" << ((void *) (((char*)ptr)+realSize)) << " this is arena " << (void *) arena << std::endl;
+   heap._allocations++;
 
    return  ((char *) ptr ) + _headerSize;
 }
@@ -126,20 +85,32 @@ inline void Allocator::deallocate ( void *object, const char *file, int line )
 
    ObjectHeader * ptr = (ObjectHeader *) ( ((char *)object) - _headerSize );
 
-   Arena *arena = ptr->_arena;
-
-   // If there is no arena then it was a big object that just needs to be freed
-   if ( arena == NULL )
-     free(ptr);
-   else
-     arena->deallocate(ptr);
+   Heap *heap = ptr->_heap;
+
+   // If there is no heap then it was a big object that just needs to be freed
+   if ( heap == NULL ) {
+      free(ptr);
+   } else if ( heap->_owner == getThreadToken() ) {
+      nextFree( ptr ) = heap->_free[ptr->_class];
+      heap->_free[ptr->_class] = ptr;
+      heap->_frees++;
+   } else {
+      // Give it back to the owner
+      ObjectHeader *head;
+      do {
+         head = heap->_remote;
+         nextFree( ptr ) = head;
+      } while ( !__sync_bool_compare_and_swap( &heap->_remote, head, ptr ) );
+      // Only counted once pushed: the heap is not released while this is pending
+      __sync_fetch_and_add( &heap->_remoteFrees, 1 );
+   }
 }
 
 inline size_t Allocator::getObjectSize ( void *object )
 {
    ObjectHeader * ptr = (ObjectHeader *) ( ((char *)object) - _headerSize );
-   Arena *arena = ptr->_arena;
-   return arena->getObjectSize() - _headerSize ;
+   if ( ptr->_heap == NULL ) return ptr->_class;
+   return ( 1UL << ( ptr->_class + _minShift ) ) - _headerSize ;
 }
 
 } // namespace nanos
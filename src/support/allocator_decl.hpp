@@ -25,12 +25,12 @@
 #include "malign.hpp"
 #include <list>
 #include <map>
+#include <stdint.h>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 
 #define NANOS_CACHELINE 128 /* FIXME: This definition must be architectural dependant */
-#define NANOS_OBJECTS_PER_ARENA 1000
 
 namespace nanos {
 
@@ -85,86 +85,69 @@ class InternalAllocator
        inline void destroy( pointer p ) { p->~T(); }
 };
 /*! \class Allocator
+ *  \brief Thread-caching allocator of small objects.
+ *
+ *  Objects are rounded up (with their header) to a power of two size class.
+ *  Every Allocator owns a heap with an intrusive free list per class, carved
+ *  from chunks taken from the system. Objects freed by the thread that owns
+ *  their heap go back to its free lists; objects freed by other threads are
+ *  pushed into a lock-free list of the heap, which its owner takes back
+ *  when a free list runs empty. Objects larger than the biggest class are
+ *  taken from the system directly.
  */
 class Allocator
 {
-   private:
-     /*! \class Arena
-      */
-      class Arena
-      {
-         private: /* Arena data members and disabled constructors */
-            static const size_t numObjects = NANOS_OBJECTS_PER_ARENA;      /** Number of maximum objects allocated in this arena*/
-
-            union bitmap_entry {
-               bool             _bit;
-               char             pad[NANOS_CACHELINE];
-            };                                         /**< bitmap_entry struct */
-
-            size_t            _objectSize;            /**< Object size in current Arena  */
-            char             *_arena;                 /**< Memory region used by Arena */
-            bitmap_entry     *_bitmap;                /**< Bit map (free/busy) */
-            Arena            *_next;                  /**< Next Arena in the list */
-            bool              _free;                  /**< Are there free entries */
-            /*! \brief Arena copy constructor (disabled)
-             */
-            Arena ( const Arena &a );
-            /*! \brief Arena copy assignment operator (disabled)
-             */
-            Arena & operator= ( const Arena &a );
-           /*! \brief Arena default constructor (disabled)
-            */
-            Arena ();
-         public: /* Arena method members */
-           /*! \brief Arena constructor
-            */
-            Arena ( size_t objectSize ) : _objectSize(objectSize), _next (NULL), _free(true)
-            {
-               _arena = (char *) malloc( (objectSize + sizeof(bitmap_entry) ) * numObjects );
-               if ( _arena == NULL ) throw ( NANOS_ENOMEM );
-               _bitmap = (bitmap_entry *) (_arena + objectSize * numObjects);
-               for ( size_t i = 0; i < numObjects; i++ ) _bitmap[i]._bit = true;
-            }
-           /*! \brief Arena destructor
-            */
-            ~Arena ()
-            {
-               delete _next;
-               free(_arena);
-               free(_bitmap);
-            }
-           /*! \brief Returns the size of allocated object
-            */
-            size_t getObjectSize ( void ) const ; 
-           /*! \brief Returns a free object address (and mark it as busy)
-            */
-            void * allocate ( void ) ;
-           /*! \brief Mark 'object' as free
-            */
-            void deallocate ( void *object ) ;
-           /*! \brief Returns next Arena object in the list
-            */
-            Arena * getNext ( void ) const;
-           /*! \brief Set as next Arena object 'a'
-            */
-            void setNext ( Arena * a );
-      };
-      template<typename T>
-      struct InternalCollection {
-         typedef std::list<T, InternalAllocator<T> > type;
+   public:
+      //! Allocation counters, added up over all the heaps.
+      struct Stats {
+         uint64_t allocations;  //!< Small objects allocated
+         uint64_t frees;        //!< Small objects freed by the thread that owns them
+         uint64_t remoteFrees;  //!< Small objects freed by other threads
+         uint64_t bigObjects;   //!< Objects too big for the size classes
+         uint64_t chunkBytes;   //!< Memory taken from the system for the size classes
+         unsigned heaps;        //!< Heaps created
+         unsigned orphans;      //!< Heaps whose Allocator was destroyed with objects still in use
       };
 
+   private:
+      static const size_t _minShift = 5;                     /**< Smallest class (32 bytes, header included) */
+      static const size_t _numClasses = 11;                  /**< Classes up to 32 KB */
+      static const size_t _maxSmall = 1UL << ( _minShift + _numClasses - 1 );
+      static const size_t _chunkSize = 64 * 1024;            /**< Minimum system allocation for a class */
+
+      struct Heap;
+
       struct ObjectHeader {
-         Arena     *_arena;
+         Heap      *_heap;   /**< Owner heap, NULL for big objects */
+         size_t     _class;  /**< Size class (or size of a big object) */
       };
 
-   private: /* Allocator data members */
-      typedef InternalCollection<Arena *>::type  ArenaCollection;
+      //! Chunk of memory carved into objects of a class.
+      struct Chunk {
+         Chunk     *_next;
+      };
 
-      ArenaCollection               _arenas;      /**< Vector of Arenas in Allocator*/
-      static size_t                 _headerSize;  /**< Size of ObjectHeader */
+      struct Heap {
+         ObjectHeader            *_free[_numClasses];      /**< Free objects, only used by the owner */
+         char                    *_bump[_numClasses];      /**< Unused part of the last chunk of each class */
+         char                    *_bumpEnd[_numClasses];
+         Chunk                   *_chunks;
+         void const              *_owner;                  /**< Thread that allocates from this heap */
+         Heap                    *_nextHeap;               /**< Next heap in the list of all heaps */
+         bool                     _orphan;
+         uint64_t                 _allocations;
+         uint64_t                 _frees;
+         uint64_t                 _bigObjects;
+         uint64_t                 _chunkBytes;
+         // Written by the threads that free objects of this heap
+         char                     _pad[NANOS_CACHELINE];
+         ObjectHeader * volatile  _remote;                 /**< Objects freed by other threads */
+         volatile uint64_t        _remoteFrees;
+      };
 
-      static const size_t                  _sizeOfBig = 1024*1024*10;
+      Heap                         *_heap;
+      static size_t                 _headerSize;  /**< Size of ObjectHeader */
+      static Heap * volatile        _heaps;       /**< All the heaps created, for the statistics */
 
      /*! \brief Allocator copy constructor (disabled)
       */
@@ -173,32 +156,55 @@ class Allocator
       */
       Allocator & operator= ( const Allocator &a );
 
+     /*! \brief Address that identifies the calling thread */
+      static void const * getThreadToken ( void );
+
+     /*! \brief Size class of objects of 'size' bytes */
+      static size_t getClass ( size_t size );
+
+     /*! \brief Adds the counters of 'heap' to 'stats' */
+      static void addStats ( Heap const &heap, Stats &stats );
+
+     /*! \brief Link of a free object, stored where its data was */
+      static ObjectHeader * & nextFree ( ObjectHeader *object );
 
      /*! \brief Alternative allocation method for big objects */
-      void * allocateBigObject ( size_t size ); 
+      void * allocateBigObject ( size_t size );
+
+     /*! \brief Gets an object of class 'cls' when its free list is empty
+      *
+      *  Takes back the objects freed by other threads first, and carves a new
+      *  object from the last chunk of the class (or a new chunk) if none of them
+      *  is of that class.
+      */
+      ObjectHeader * refill ( size_t cls );
 
    public: /* Allocator method members */
-    /*! \brief Allocator default constructor 
+    /*! \brief Allocator default constructor
      */
-     Allocator ( ) : _arenas() {}
-    /*! \brief Allocator destructor 
+     Allocator ( );
+    /*! \brief Allocator destructor
+     *
+     *  Chunks are only given back to the system if no object of the heap is
+     *  in use. Otherwise the heap is left behind, and the objects still in use
+     *  can be freed later from any thread.
      */
-     ~Allocator () { }
+     ~Allocator ();
     /*! \brief Allocates 'size' bytes in memory and returns memory pointer
-     *
-     *  This function will check in his list of Arenas looking for one who
-     *  stores objects of the given 'size'. If Allocator finds an Arena region
-     *  with this 'size' will ask to it for a new object. If none of the current
-     *  Arenas works with the given 'size' Allocator will create a new Arena entry
-     *  in order to manage this (and future) objects of the given 'size'.
      */
      void * allocate ( size_t size, const char *file = NULL, int line = 0 ) ;
-    /*! \brief Deallocates 'object' (object has a header which identifies related Arena
+    /*! \brief Deallocates 'object' (object has a header which identifies its heap)
      */
      static void deallocate ( void *object, const char *file = NULL, int line = 0 ) ;
     /*! \brief Get 'object' size for a given pointer
      */
      static size_t getObjectSize ( void *object ) ;
+    /*! \brief Adds up the counters of all the heaps
+     */
+     static void getStats ( Stats &stats ) ;
+    /*! \brief Counters of the heap of this Allocator only, which other threads do not allocate from
+     */
+     void getHeapStats ( Stats &stats ) const ;
 };
 
 
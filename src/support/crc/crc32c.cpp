@@ -0,0 +1,109 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c.hpp"
+#include "crc32c_kernels.hpp"
+
+namespace nanos {
+namespace crc {
+
+//! Backends sorted by preference: "auto" picks the first supported one.
+static const Crc32cBackend backends[] = {
+#if defined(__x86_64__)
+#ifdef HAVE_VPCLMULQDQ_INTRINSICS
+   { "vpclmul", setupVpclmul, crc32cVpclmul },
+#endif
+   { "pclmul",  setupPclmul,  crc32cPclmul  },
+   { "sse42",   setupSse42,   crc32cSse42   },
+#endif
+#if defined(__aarch64__)
+   { "armv8",   setupArmv8,   crc32cArmv8   },
+#endif
+   { "table16", setupTable,   crc32cTable16 },
+   { "table8",  setupTable,   crc32cTable8  },
+};
+
+static const size_t numBackends = sizeof(backends) / sizeof(backends[0]);
+
+Crc32cBackend const* Crc32cEngine::_backend = &backends[numBackends-1];
+Crc32cKernel         Crc32cEngine::_update  = crc32cTable8;
+
+bool Crc32cEngine::select( std::string const& name )
+{
+   Crc32cBackend const* chosen = NULL;
+
+   for ( size_t i = 0; i < numBackends && chosen == NULL; i++ ) {
+      if ( ( name == "auto" || name == backends[i].name ) && backends[i].setup() ) {
+         chosen = &backends[i];
+      }
+   }
+
+   const bool found = chosen != NULL;
+   if ( !found ) {
+      select( "auto" );
+   } else {
+      _backend = chosen;
+      _update = chosen->update;
+   }
+   return found;
+}
+
+size_t Crc32cEngine::getNumBackends()
+{
+   return numBackends;
+}
+
+Crc32cBackend const& Crc32cEngine::getBackend( size_t i )
+{
+   return backends[i];
+}
+
+//! \returns x^(2^k) modulo the CRC-32C polynomial.
+static constexpr uint32_t xPow2ModP( size_t k )
+{
+   return k == 0 ? 1u << 30 : squareModP( xPow2ModP( k - 1 ) );
+}
+
+//! x^(2^k) modulo the CRC-32C polynomial, for k = 0..63.
+template <typename Indices = MakeIndexList<64>::type>
+struct PowersOfX;
+
+template <size_t... I>
+struct PowersOfX< IndexList<I...> > {
+   static constexpr uint32_t table[sizeof...(I)] = { xPow2ModP( I )... };
+};
+
+template <size_t... I>
+constexpr uint32_t PowersOfX< IndexList<I...> >::table[sizeof...(I)];
+
+uint32_t Crc32cEngine::combine( uint32_t crcA, uint32_t crcB, size_t lengthB )
+{
+   // Appending lengthB bytes multiplies the first CRC by x^(8*lengthB).
+   // Pre and post inversions cancel out, so finalized values can be used.
+   uint64_t n = 8 * uint64_t( lengthB );
+   for ( unsigned k = 0; n != 0; k++, n >>= 1 ) {
+      if ( n & 1 ) {
+         crcA = multiplyModP( crcA, PowersOfX<>::table[k] );
+      }
+   }
+   return crcA ^ crcB;
+}
+
+} // namespace crc
+} // namespace nanos
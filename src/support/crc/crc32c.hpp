@@ -0,0 +1,132 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nanos {
+namespace crc {
+
+/*!
+ * \brief Signature of a CRC-32C (Castagnoli) kernel.
+ *
+ * Kernels update a CRC register with the contents of a buffer. No pre or
+ * post inversion is applied, so they behave like the SSE4.2 crc32
+ * instruction: callers seed the register (e.g. with 0xFFFFFFFF) and can
+ * chain calls over consecutive pieces of data.
+ */
+typedef uint32_t (*Crc32cKernel)( uint32_t crc, void const* buffer, size_t length );
+
+/*!
+ * \brief Describes one of the available CRC-32C implementations.
+ * All backends compute exactly the same values.
+ */
+struct Crc32cBackend {
+   char const*   name;   //!< Name used to select the backend (see NX_CRC_ENGINE)
+   bool        (*setup)(); //!< Checks if the backend can run in this machine and prepares its tables
+   Crc32cKernel  update; //!< Kernel entry point
+};
+
+/*!
+ * \brief Dispatches CRC-32C computations to the fastest backend that
+ * is supported by the machine.
+ *
+ * The backend is chosen once at startup (see select()). Until then, the
+ * portable table based implementation is used.
+ */
+class Crc32cEngine {
+   private:
+      static Crc32cBackend const* _backend;
+      static Crc32cKernel         _update;
+
+   public:
+      /*!
+       * \brief Selects the backend that will be used from now on.
+       * \param[in] name backend name, or "auto" to pick the fastest supported one.
+       * \returns false if the requested backend is unknown or not supported
+       * by this machine. In that case the fastest supported one is selected.
+       */
+      static bool select( std::string const& name );
+
+      //! \returns the name of the backend in use.
+      static char const* getName() { return _backend->name; }
+
+      //! \returns the number of backends built into the library.
+      static size_t getNumBackends();
+
+      //! \returns the i-th backend, sorted from fastest to slowest.
+      static Crc32cBackend const& getBackend( size_t i );
+
+      //! \brief Updates a CRC-32C register with the contents of a buffer.
+      static uint32_t update( uint32_t crc, void const* buffer, size_t length )
+      {
+         return _update( crc, buffer, length );
+      }
+
+      /*!
+       * \brief Combines the CRC-32C values of two consecutive pieces of data.
+       * \param[in] crcA CRC-32C of the first piece.
+       * \param[in] crcB CRC-32C of the second piece.
+       * \param[in] lengthB length in bytes of the second piece.
+       * \returns the CRC-32C of both pieces concatenated, without reading them.
+       */
+      static uint32_t combine( uint32_t crcA, uint32_t crcB, size_t lengthB );
+};
+
+/*!
+ * \brief Streaming CRC-32C computation.
+ *
+ * Data can be fed in pieces of any length and alignment; the result is the
+ * same as if the whole message had been processed at once.
+ * \code
+ * Crc32c crc;
+ * crc.update( header, header_size );
+ * crc.update( payload, payload_size );
+ * uint32_t value = crc.finalize();
+ * \endcode
+ */
+class Crc32c {
+   private:
+      uint32_t _crc; //!< CRC register
+
+   public:
+      Crc32c() : _crc( 0xFFFFFFFF ) {}
+
+      //! \brief Restarts the computation.
+      void init() { _crc = 0xFFFFFFFF; }
+
+      //! \brief Appends \a length bytes starting at \a buffer to the message.
+      void update( void const* buffer, size_t length )
+      {
+         _crc = Crc32cEngine::update( _crc, buffer, length );
+      }
+
+      //! \returns the CRC-32C of the data seen so far.
+      uint32_t finalize() const { return ~_crc; }
+};
+
+} // namespace crc
+} // namespace nanos
+
+#endif // CRC32C_HPP
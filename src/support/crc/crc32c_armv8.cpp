@@ -0,0 +1,70 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c_kernels.hpp"
+
+#if defined(__aarch64__)
+
+#include <arm_acle.h>
+#include <sys/auxv.h>
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+
+/*
+ * ARMv8 implementation using the optional CRC32 extension.
+ */
+
+namespace nanos {
+namespace crc {
+
+bool setupArmv8()
+{
+   return getauxval( AT_HWCAP ) & HWCAP_CRC32;
+}
+
+__attribute__((target("arch=armv8-a+crc")))
+uint32_t crc32cArmv8( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   while ( length >= 32 ) {
+      crc = __crc32cd( crc, loadLE64( p      ) );
+      crc = __crc32cd( crc, loadLE64( p +  8 ) );
+      crc = __crc32cd( crc, loadLE64( p + 16 ) );
+      crc = __crc32cd( crc, loadLE64( p + 24 ) );
+      p += 32;
+      length -= 32;
+   }
+   while ( length >= 8 ) {
+      crc = __crc32cd( crc, loadLE64( p ) );
+      p += 8;
+      length -= 8;
+   }
+   while ( length-- > 0 ) {
+      crc = __crc32cb( crc, *p++ );
+   }
+   return crc;
+}
+
+} // namespace crc
+} // namespace nanos
+
+#endif // __aarch64__
@@ -0,0 +1,146 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef CRC32C_KERNELS_HPP
+#define CRC32C_KERNELS_HPP
+
+#include "crc32c.hpp"
+
+#include <string.h>
+
+/*
+ * Internal interface between the CRC-32C dispatcher and its backends.
+ * Every backend lives in its own translation unit so that ISA specific
+ * code is only reached after the CPU has been checked at runtime.
+ */
+
+namespace nanos {
+namespace crc {
+
+//! CRC-32C polynomial in reversed (LSB first) bit order.
+constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+/*!
+ * \brief Multiplies two polynomials modulo the CRC-32C polynomial.
+ * Both operands and the result use the CRC register (reflected) bit order,
+ * where bit 31 holds the coefficient of x^0. \a m walks the bits of \a a
+ * while \a b is multiplied by x at each step.
+ */
+constexpr uint32_t multiplyModP( uint32_t a, uint32_t b, uint32_t m = 1u << 31 )
+{
+   return m == 0 ? 0
+        : ( ( a & m ) ? b : 0 ) ^ multiplyModP( a, ( b & 1 ) ? ( b >> 1 ) ^ CRC32C_POLY : b >> 1, m >> 1 );
+}
+
+//! \returns a^2 modulo the CRC-32C polynomial.
+constexpr uint32_t squareModP( uint32_t a )
+{
+   return multiplyModP( a, a );
+}
+
+//! \returns x^n modulo the CRC-32C polynomial, in CRC register bit order.
+constexpr uint32_t xPowModP( uint64_t n )
+{
+   return n == 0 ? 1u << 31
+        : ( n & 1 ) ? multiplyModP( xPowModP( n - 1 ), 1u << 30 )
+        : squareModP( xPowModP( n / 2 ) );
+}
+
+//! Compile time list of indices, used to expand table initializers.
+template <size_t... I> struct IndexList {};
+
+template <size_t N, size_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexList<0, I...> { typedef IndexList<I...> type; };
+
+/*!
+ * \brief Lookup tables that advance a CRC register over BYTES zero bytes.
+ *
+ * Shifting is linear, so the register is split in four bytes and the
+ * contribution of each one is looked up in its own table. Tables are
+ * built by the compiler.
+ */
+template <size_t BYTES, typename Indices = typename MakeIndexList<256>::type>
+struct ShiftTable;
+
+template <size_t BYTES, size_t... I>
+struct ShiftTable<BYTES, IndexList<I...> > {
+   static constexpr uint32_t factor = xPowModP( 8 * uint64_t( BYTES ) );
+   static constexpr uint32_t table[4][256] = {
+      { multiplyModP( uint32_t( I ),       factor )... },
+      { multiplyModP( uint32_t( I ) << 8,  factor )... },
+      { multiplyModP( uint32_t( I ) << 16, factor )... },
+      { multiplyModP( uint32_t( I ) << 24, factor )... }
+   };
+
+   //! \returns the CRC register \a crc advanced over BYTES zero bytes.
+   static uint32_t shift( uint32_t crc )
+   {
+      return table[0][ crc        & 0xFF] ^ table[1][(crc >>  8) & 0xFF]
+           ^ table[2][(crc >> 16) & 0xFF] ^ table[3][(crc >> 24) & 0xFF];
+   }
+};
+
+template <size_t BYTES, size_t... I>
+constexpr uint32_t ShiftTable<BYTES, IndexList<I...> >::table[4][256];
+
+//! \brief Loads 8 bytes in little endian order from a possibly unaligned address.
+inline uint64_t loadLE64( unsigned char const* p )
+{
+   uint64_t value;
+   memcpy( &value, p, sizeof(value) );
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   value = __builtin_bswap64( value );
+#endif
+   return value;
+}
+
+// Portable implementations (always available)
+bool     setupTable();
+uint32_t crc32cTable8( uint32_t crc, void const* buffer, size_t length );
+uint32_t crc32cTable16( uint32_t crc, void const* buffer, size_t length );
+
+#if defined(__x86_64__)
+// Intel SSE4.2 crc32 instruction, three interleaved streams
+bool     setupSse42();
+uint32_t crc32cSse42( uint32_t crc, void const* buffer, size_t length );
+
+// PCLMULQDQ folding (128 bit lanes)
+bool     setupPclmul();
+uint32_t crc32cPclmul( uint32_t crc, void const* buffer, size_t length );
+
+#ifdef HAVE_VPCLMULQDQ_INTRINSICS
+// AVX-512 VPCLMULQDQ folding (512 bit lanes)
+bool     setupVpclmul();
+uint32_t crc32cVpclmul( uint32_t crc, void const* buffer, size_t length );
+#endif
+#endif // __x86_64__
+
+#if defined(__aarch64__)
+// ARMv8 CRC32 extension
+bool     setupArmv8();
+uint32_t crc32cArmv8( uint32_t crc, void const* buffer, size_t length );
+#endif
+
+} // namespace crc
+} // namespace nanos
+
+#endif // CRC32C_KERNELS_HPP
@@ -0,0 +1,123 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c_kernels.hpp"
+
+#if defined(__x86_64__)
+
+#include <cpuid.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+
+/*
+ * Carry-less multiplication (PCLMULQDQ) implementation.
+ *
+ * The buffer is folded 64 bytes at a time into four 128 bit accumulators.
+ * Folding a 128 bit chunk X over a distance of D bits replaces it by
+ * X_hi * (x^(D+32) mod P) + X_lo * (x^(D-32) mod P), which leaves the
+ * remainder of the whole message unchanged. The last 16 bytes are then
+ * reduced to 32 bits with the crc32 instruction. Short buffers and tails
+ * are handled by the SSE4.2 kernel.
+ */
+
+namespace nanos {
+namespace crc {
+
+//! Buffers shorter than this are not worth folding.
+static const size_t FOLD_THRESHOLD = 128;
+
+//! \returns x^n mod P as a 33 bit value, in the bit order expected by pclmulqdq.
+static constexpr uint64_t foldConstant( unsigned n )
+{
+   return uint64_t( xPowModP( n ) ) << 1;
+}
+
+//! Folding constants for distances of 128 and 512 bits.
+static constexpr uint64_t foldConstants[2][2] = {
+   { foldConstant( 128 + 32 ), foldConstant( 128 - 32 ) },
+   { foldConstant( 512 + 32 ), foldConstant( 512 - 32 ) }
+};
+
+bool setupPclmul()
+{
+   unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+   return __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && (ecx & bit_SSE4_2) && (ecx & bit_PCLMUL);
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static inline __m128i fold( __m128i x, __m128i next, __m128i k )
+{
+   __m128i hi = _mm_clmulepi64_si128( x, k, 0x00 );
+   __m128i lo = _mm_clmulepi64_si128( x, k, 0x11 );
+   return _mm_xor_si128( _mm_xor_si128( hi, lo ), next );
+}
+
+static inline __m128i load128( unsigned char const* p )
+{
+   return _mm_loadu_si128( reinterpret_cast<__m128i const*>( p ) );
+}
+
+__attribute__((target("sse4.2,pclmul")))
+uint32_t crc32cPclmul( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   if ( length < FOLD_THRESHOLD )
+      return crc32cSse42( crc, p, length );
+
+   const __m128i k128 = _mm_set_epi64x( foldConstants[0][1], foldConstants[0][0] );
+   const __m128i k512 = _mm_set_epi64x( foldConstants[1][1], foldConstants[1][0] );
+
+   // The initial CRC value is equivalent to xoring it into the first 4 bytes
+   __m128i x0 = _mm_xor_si128( load128( p ), _mm_cvtsi32_si128( crc ) );
+   __m128i x1 = load128( p + 16 );
+   __m128i x2 = load128( p + 32 );
+   __m128i x3 = load128( p + 48 );
+   p += 64;
+   length -= 64;
+
+   while ( length >= 64 ) {
+      x0 = fold( x0, load128( p      ), k512 );
+      x1 = fold( x1, load128( p + 16 ), k512 );
+      x2 = fold( x2, load128( p + 32 ), k512 );
+      x3 = fold( x3, load128( p + 48 ), k512 );
+      p += 64;
+      length -= 64;
+   }
+
+   x0 = fold( x0, x1, k128 );
+   x0 = fold( x0, x2, k128 );
+   x0 = fold( x0, x3, k128 );
+
+   while ( length >= 16 ) {
+      x0 = fold( x0, load128( p ), k128 );
+      p += 16;
+      length -= 16;
+   }
+
+   uint64_t crc64 = _mm_crc32_u64( 0, (uint64_t) _mm_cvtsi128_si64( x0 ) );
+   crc64 = _mm_crc32_u64( crc64, (uint64_t) _mm_extract_epi64( x0, 1 ) );
+
+   return crc32cSse42( (uint32_t) crc64, p, length );
+}
+
+} // namespace crc
+} // namespace nanos
+
+#endif // __x86_64__
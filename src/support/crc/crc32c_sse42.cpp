@@ -0,0 +1,118 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c_kernels.hpp"
+
+#if defined(__x86_64__)
+
+#include <cpuid.h>
+#include <nmmintrin.h>
+
+/*
+ * SSE4.2 implementation. Three crc32 streams run interleaved over
+ * consecutive lanes of a block to hide the latency of the instruction, and
+ * their partial CRCs are merged with compile time shift tables. The lane
+ * size is chosen from the remaining length, so that short buffers still
+ * use the interleaved streams. Anything shorter than the smallest block is
+ * processed 8 bytes at a time.
+ */
+
+namespace nanos {
+namespace crc {
+
+//! Lane sizes, from longest to shortest. Blocks are three lanes long.
+static const size_t LONG_LANE   = 1024;
+static const size_t MEDIUM_LANE = 256;
+static const size_t SHORT_LANE  = 64;
+
+bool setupSse42()
+{
+   unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+   return __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && (ecx & bit_SSE4_2);
+}
+
+//! \brief Processes a block of 3*LANE bytes with three interleaved streams.
+template <size_t LANE>
+__attribute__((target("sse4.2")))
+static inline uint32_t crc32cBlock( uint32_t crc, unsigned char const* p )
+{
+   uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+
+   for ( size_t i = 0; i < LANE; i += 8 ) {
+      crc0 = _mm_crc32_u64( crc0, loadLE64( p + i ) );
+      crc1 = _mm_crc32_u64( crc1, loadLE64( p + LANE + i ) );
+      crc2 = _mm_crc32_u64( crc2, loadLE64( p + 2*LANE + i ) );
+   }
+
+   return ShiftTable<2*LANE>::shift( (uint32_t) crc0 )
+        ^ ShiftTable<LANE>::shift( (uint32_t) crc1 )
+        ^ (uint32_t) crc2;
+}
+
+//! \brief Processes as many blocks of 3*LANE bytes as fit in the buffer.
+template <size_t LANE>
+__attribute__((target("sse4.2")))
+static inline uint32_t crc32cBlocks( uint32_t crc, unsigned char const* &p, size_t &length )
+{
+   while ( length >= 3*LANE ) {
+      crc = crc32cBlock<LANE>( crc, p );
+      p += 3*LANE;
+      length -= 3*LANE;
+   }
+   return crc;
+}
+
+__attribute__((target("sse4.2")))
+uint32_t crc32cSse42( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   crc = crc32cBlocks<LONG_LANE>( crc, p, length );
+   crc = crc32cBlocks<MEDIUM_LANE>( crc, p, length );
+   crc = crc32cBlocks<SHORT_LANE>( crc, p, length );
+
+   uint64_t crc64 = crc;
+   for ( ; length >= 8; p += 8, length -= 8 ) {
+      crc64 = _mm_crc32_u64( crc64, loadLE64( p ) );
+   }
+   crc = (uint32_t) crc64;
+
+   // Tail: at most one 4, 2 and 1 byte step
+   if ( length & 4 ) {
+      uint32_t value;
+      memcpy( &value, p, sizeof(value) );
+      crc = _mm_crc32_u32( crc, value );
+      p += 4;
+   }
+   if ( length & 2 ) {
+      uint16_t value;
+      memcpy( &value, p, sizeof(value) );
+      crc = _mm_crc32_u16( crc, value );
+      p += 2;
+   }
+   if ( length & 1 ) {
+      crc = _mm_crc32_u8( crc, *p );
+   }
+   return crc;
+}
+
+} // namespace crc
+} // namespace nanos
+
+#endif // __x86_64__
@@ -0,0 +1,99 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c_kernels.hpp"
+
+/*
+ * Portable slicing-by-8 and slicing-by-16 implementations.
+ * table[0] is the classic byte-at-a-time table; table[k] advances a byte
+ * that is followed by k more bytes of data.
+ */
+
+namespace nanos {
+namespace crc {
+
+static uint32_t table[16][256];
+
+//! Fills the lookup tables during library initialization.
+static struct TableInitializer {
+   TableInitializer()
+   {
+      for ( unsigned n = 0; n < 256; n++ ) {
+         uint32_t c = n;
+         for ( int k = 0; k < 8; k++ ) {
+            c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+         }
+         table[0][n] = c;
+      }
+      for ( unsigned n = 0; n < 256; n++ ) {
+         for ( unsigned k = 1; k < 16; k++ ) {
+            uint32_t c = table[k-1][n];
+            table[k][n] = (c >> 8) ^ table[0][c & 0xFF];
+         }
+      }
+   }
+} tableInitializer;
+
+bool setupTable()
+{
+   return true;
+}
+
+static inline uint32_t crc32cBytes( uint32_t crc, unsigned char const* p, size_t length )
+{
+   while ( length-- > 0 ) {
+      crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+   }
+   return crc;
+}
+
+static inline uint32_t slice8( uint64_t word, unsigned first )
+{
+   return table[first+7][ word        & 0xFF] ^ table[first+6][(word >>  8) & 0xFF]
+        ^ table[first+5][(word >> 16) & 0xFF] ^ table[first+4][(word >> 24) & 0xFF]
+        ^ table[first+3][(word >> 32) & 0xFF] ^ table[first+2][(word >> 40) & 0xFF]
+        ^ table[first+1][(word >> 48) & 0xFF] ^ table[first  ][ word >> 56        ];
+}
+
+uint32_t crc32cTable8( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   while ( length >= 8 ) {
+      crc = slice8( loadLE64( p ) ^ crc, 0 );
+      p += 8;
+      length -= 8;
+   }
+   return crc32cBytes( crc, p, length );
+}
+
+uint32_t crc32cTable16( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   while ( length >= 16 ) {
+      crc = slice8( loadLE64( p ) ^ crc, 8 ) ^ slice8( loadLE64( p+8 ), 0 );
+      p += 16;
+      length -= 16;
+   }
+   return crc32cTable8( crc, p, length );
+}
+
+} // namespace crc
+} // namespace nanos
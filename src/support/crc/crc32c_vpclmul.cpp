@@ -0,0 +1,163 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "crc32c_kernels.hpp"
+
+#if defined(__x86_64__) && defined(HAVE_VPCLMULQDQ_INTRINSICS)
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+/*
+ * AVX-512 VPCLMULQDQ implementation. Same folding scheme as the PCLMULQDQ
+ * backend, but each instruction folds four 128 bit lanes at once and the
+ * main loop consumes 256 bytes per iteration. Short buffers are delegated
+ * to the PCLMULQDQ backend.
+ */
+
+namespace nanos {
+namespace crc {
+
+//! Buffers shorter than this are handled by the 128 bit folding kernel.
+static const size_t FOLD_THRESHOLD = 512;
+
+static constexpr uint64_t foldConstant( unsigned n )
+{
+   return uint64_t( xPowModP( n ) ) << 1;
+}
+
+//! Folding constants for distances of 128, 512 and 2048 bits.
+static constexpr uint64_t foldConstants[3][2] = {
+   { foldConstant(  128 + 32 ), foldConstant(  128 - 32 ) },
+   { foldConstant(  512 + 32 ), foldConstant(  512 - 32 ) },
+   { foldConstant( 2048 + 32 ), foldConstant( 2048 - 32 ) }
+};
+
+bool setupVpclmul()
+{
+   unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+   if ( !setupPclmul() )
+      return false;
+
+   // The OS must save the opmask, ZMM and YMM state (XCR0 bits 1, 2 and 5-7)
+   __get_cpuid( 1, &eax, &ebx, &ecx, &edx );
+   if ( !(ecx & bit_OSXSAVE) )
+      return false;
+   uint32_t xcr0lo, xcr0hi;
+   __asm__ ( "xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0) );
+   if ( (xcr0lo & 0xE6) != 0xE6 )
+      return false;
+
+   if ( __get_cpuid_max( 0, NULL ) < 7 )
+      return false;
+   __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+   const bool avx512f = ebx & (1u << 16);
+   const bool vpclmulqdq = ecx & (1u << 10);
+   return avx512f && vpclmulqdq;
+}
+
+__attribute__((target("avx512f,vpclmulqdq")))
+static inline __m512i fold( __m512i x, __m512i next, __m512i k )
+{
+   __m512i hi = _mm512_clmulepi64_epi128( x, k, 0x00 );
+   __m512i lo = _mm512_clmulepi64_epi128( x, k, 0x11 );
+   // hi ^ lo ^ next
+   return _mm512_ternarylogic_epi64( hi, lo, next, 0x96 );
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i load512( unsigned char const* p )
+{
+   return _mm512_loadu_si512( reinterpret_cast<void const*>( p ) );
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i broadcastConstant( uint64_t const k[2] )
+{
+   return _mm512_set_epi64( k[1], k[0], k[1], k[0], k[1], k[0], k[1], k[0] );
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static inline __m128i fold128( __m128i x, __m128i next, __m128i k )
+{
+   __m128i hi = _mm_clmulepi64_si128( x, k, 0x00 );
+   __m128i lo = _mm_clmulepi64_si128( x, k, 0x11 );
+   return _mm_xor_si128( _mm_xor_si128( hi, lo ), next );
+}
+
+__attribute__((target("sse4.2,pclmul,avx512f,vpclmulqdq")))
+uint32_t crc32cVpclmul( uint32_t crc, void const* buffer, size_t length )
+{
+   unsigned char const* p = static_cast<unsigned char const*>( buffer );
+
+   if ( length < FOLD_THRESHOLD )
+      return crc32cPclmul( crc, p, length );
+
+   const __m512i k512  = broadcastConstant( foldConstants[1] );
+   const __m512i k2048 = broadcastConstant( foldConstants[2] );
+
+   // The initial CRC value is equivalent to xoring it into the first 4 bytes
+   __m512i seed = _mm512_inserti32x4( _mm512_setzero_si512(), _mm_cvtsi32_si128( crc ), 0 );
+   __m512i z0 = _mm512_xor_si512( load512( p ), seed );
+   __m512i z1 = load512( p + 64 );
+   __m512i z2 = load512( p + 128 );
+   __m512i z3 = load512( p + 192 );
+   p += 256;
+   length -= 256;
+
+   while ( length >= 256 ) {
+      z0 = fold( z0, load512( p       ), k2048 );
+      z1 = fold( z1, load512( p +  64 ), k2048 );
+      z2 = fold( z2, load512( p + 128 ), k2048 );
+      z3 = fold( z3, load512( p + 192 ), k2048 );
+      p += 256;
+      length -= 256;
+   }
+
+   z0 = fold( z0, z1, k512 );
+   z0 = fold( z0, z2, k512 );
+   z0 = fold( z0, z3, k512 );
+
+   while ( length >= 64 ) {
+      z0 = fold( z0, load512( p ), k512 );
+      p += 64;
+      length -= 64;
+   }
+
+   // Reduce the four 128 bit lanes into one
+   unsigned char lanes[64];
+   _mm512_storeu_si512( lanes, z0 );
+
+   const __m128i k128 = _mm_set_epi64x( foldConstants[0][1], foldConstants[0][0] );
+   __m128i x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( lanes ) );
+   for ( unsigned lane = 1; lane < 4; lane++ ) {
+      x = fold128( x, _mm_loadu_si128( reinterpret_cast<__m128i const*>( lanes + 16*lane ) ), k128 );
+   }
+
+   // Hand the folded 16 bytes and the remaining tail to the 128 bit kernel.
+   // The folded value already carries the CRC, so it is resumed from zero.
+   _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), x );
+   uint32_t partial = crc32cPclmul( 0, lanes, 16 );
+   return crc32cPclmul( partial, p, length );
+}
+
+} // namespace crc
+} // namespace nanos
+
+#endif // __x86_64__ && HAVE_VPCLMULQDQ_INTRINSICS
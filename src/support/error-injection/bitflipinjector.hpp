@@ -0,0 +1,182 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef BIT_FLIP_INJECTOR_HPP
+#define BIT_FLIP_INJECTOR_HPP
+
+#include "error-injection/errorinjectionconfiguration.hpp"
+#include "error-injection/errorinjectionpolicy.hpp"
+#include "exception/failurestats.hpp"
+#include "debug.hpp"
+
+#include <deque>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace nanos {
+namespace error {
+
+/*! Silently corrupts memory by flipping single bits.
+ * \details
+ * 	Candidates are the resources declared by the user and the outputs
+ * 	of the last tasks that finished, which are declared by the runtime.
+ * 	Every byte of the candidates is equally likely to be hit.
+ * 	Which bits are flipped only depends on the injection seed and on
+ * 	the order in which candidates were declared.
+ */
+template < typename RandomEngine = std::minstd_rand >
+class BitFlipInjector : public ErrorInjectionPolicy
+{
+	public:
+		//! Number of task outputs that are kept as candidates
+		static const size_t MAX_OUTPUTS = 64;
+
+	private:
+		struct Target {
+			unsigned char *address;
+			size_t         size;
+
+			Target( void *a, size_t s ) : address( static_cast<unsigned char*>(a) ), size( s ) {}
+
+			bool contains( void *a ) const { return a >= address && a < address + size; }
+		};
+
+		std::vector<Target>  _resources;   //!< Resources declared by the user
+		std::deque<Target>   _outputs;     //!< Outputs of the last tasks that finished
+		size_t               _bytes;       //!< Size of all the candidates
+		unsigned             _limit;       //!< Maximum number of flipped bits (0: unlimited)
+		unsigned             _injected;
+		std::mutex           _mutex;
+		RandomEngine         _generator;
+
+	public:
+		BitFlipInjector( ErrorInjectionConfig const& properties ) noexcept :
+			ErrorInjectionPolicy( properties ),
+			_resources(),
+			_outputs(),
+			_bytes( 0 ),
+			_limit( properties.getInjectionLimit() ),
+			_injected( 0 ),
+			_mutex(),
+			_generator( properties.getInjectionSeed() )
+		{
+		}
+
+		virtual ~BitFlipInjector()
+		{
+		}
+
+		RandomEngine& getRandomGenerator() { return _generator; }
+
+		unsigned getInjectedErrors() const { return _injected; }
+
+		virtual void injectError()
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			if( _bytes == 0 )
+				return;
+
+			std::uniform_int_distribution<size_t> byteDistribution( 0, _bytes - 1 );
+			size_t position = byteDistribution( _generator );
+
+			for( auto it = _resources.begin(); it != _resources.end(); it++ ) {
+				if( position < it->size )
+					return flip( it->address + position );
+				position -= it->size;
+			}
+			for( auto it = _outputs.begin(); it != _outputs.end(); it++ ) {
+				if( position < it->size )
+					return flip( it->address + position );
+				position -= it->size;
+			}
+		}
+
+		// Corrupts the candidate that contains the given address,
+		// or the byte it points to if there is none
+		virtual void injectError( void *address )
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			Target target( address, 1 );
+			for( auto it = _resources.begin(); it != _resources.end(); it++ ) {
+				if( it->contains( address ) )
+					target = *it;
+			}
+			for( auto it = _outputs.begin(); it != _outputs.end(); it++ ) {
+				if( it->contains( address ) )
+					target = *it;
+			}
+
+			std::uniform_int_distribution<size_t> byteDistribution( 0, target.size - 1 );
+			flip( target.address + byteDistribution( _generator ) );
+		}
+
+		virtual void declareResource( void *address, size_t size )
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			_resources.emplace_back( address, size );
+			_bytes += size;
+		}
+
+		virtual void declareOutput( void *address, size_t size )
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			// Outputs written again are only counted once
+			for( auto it = _outputs.begin(); it != _outputs.end(); it++ ) {
+				if( it->address == address ) {
+					_bytes -= it->size;
+					_outputs.erase( it );
+					break;
+				}
+			}
+			_outputs.emplace_back( address, size );
+			_bytes += size;
+
+			if( _outputs.size() > MAX_OUTPUTS ) {
+				_bytes -= _outputs.front().size;
+				_outputs.pop_front();
+			}
+		}
+
+		// Flipped bits stay there: detecting and repairing them
+		// is up to the runtime
+		virtual void recoverError( void* handle ) noexcept
+		{
+		}
+
+	private:
+		void flip( unsigned char *address )
+		{
+			if( _limit > 0 && _injected >= _limit )
+				return;
+
+			std::uniform_int_distribution<unsigned> bitDistribution( 0, 7 );
+			volatile unsigned char *byte = address;
+			*byte ^= static_cast<unsigned char>( 1U << bitDistribution( _generator ) );
+
+			_injected++;
+			FailureStats<ErrorInjection>::increase();
+			debug( "Bit-flip injector: corrupted byte ", static_cast<void*>(address) );
+		}
+};
+
+} // namespace error
+} // namespace nanos
+
+#endif // BIT_FLIP_INJECTOR_HPP
@@ -25,8 +25,10 @@ private:
 			 * 	2) Loads a user-defined error injection plugin (or a stub, if nothing is defined).
 			 * 	3) Read the injection policy from the error injection plugin, that will be used by the thread.
 			 * 	4) Instantiate the thread that will perform the injection.
+			 * \note Constant initialized: the runtime may set the policy
+			 * before the dynamic initialization of this object takes place.
 			 */
-			InjectionInterfaceSingleton() :
+			constexpr InjectionInterfaceSingleton() :
 					_policy( nullptr )
 			{
 			}
@@ -61,6 +63,16 @@ public:
 		interfaceObject._policy->declareResource( handle, size );
 	}
 
+	/*! Declares the output of a task that
+	 * just finished (called by the runtime, even
+	 * after the injection has been terminated)
+	 */
+	static void declareOutput(void* handle, size_t size )
+	{
+		if( interfaceObject._policy )
+			interfaceObject._policy->declareOutput( handle, size );
+	}
+
 	static void resumeInjection()
 	{
 		interfaceObject._policy->resume();
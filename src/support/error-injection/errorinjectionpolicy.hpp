@@ -37,6 +37,10 @@ class ErrorInjectionPolicy {
 		// candidate for corruption using error injection
 		virtual void declareResource(void* handle, size_t size ) = 0;
 
+		// Declares the output of a task that just finished,
+		// which might also be a candidate for corruption
+		virtual void declareOutput( void* handle, size_t size ) {}
+
 		virtual void stop() {}
 
 		virtual void resume() {}
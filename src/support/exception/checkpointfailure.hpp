@@ -35,16 +35,27 @@ class CheckpointFailure {
       CheckpointFailure( OperationFailure& operation ) :
             _failedOperation( operation )
       {
-         FailureStats<CheckpointFailure>::increase();
-         NANOS_INSTRUMENT ( static nanos_event_key_t task_discard_key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-task-operation") );
-         NANOS_INSTRUMENT ( nanos_event_value_t task_discard_val = (nanos_event_value_t ) NANOS_FT_CKPT_FAILURE );
-         NANOS_INSTRUMENT ( sys.getInstrumentation()->raisePointEvents(1, &task_discard_key, &task_discard_val) );
-
          // Operation's task point to thread->currentWD()
          // In checkpoints, this is not the affected workdescriptor, since
          // the current thread does not point to it until it finishes
          // the context switch.
-         WorkDescriptor& task = operation.getPlanningTask();
+         invalidate( operation.getPlanningTask() );
+      }
+
+      //! Checkpoints made on behalf of \a task by another thread.
+      CheckpointFailure( OperationFailure& operation, WorkDescriptor& task ) :
+            _failedOperation( operation )
+      {
+         invalidate( task );
+      }
+
+   private:
+      void invalidate( WorkDescriptor& task )
+      {
+         FailureStats<CheckpointFailure>::increase();
+         NANOS_INSTRUMENT ( static nanos_event_key_t task_discard_key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("ft-task-operation") );
+         NANOS_INSTRUMENT ( nanos_event_value_t task_discard_val = (nanos_event_value_t ) NANOS_FT_CKPT_FAILURE );
+         NANOS_INSTRUMENT ( sys.getInstrumentation()->raisePointEvents(1, &task_discard_key, &task_discard_val) );
 
          // This task's backups are not valid, therefore we
          // can not recover it.
@@ -52,9 +63,9 @@ class CheckpointFailure {
 
          WorkDescriptor* recoverableAncestor = task.propagateInvalidationAndGetRecoverableAncestor();
          if( !recoverableAncestor ) {
-            fatal( "Could not find a recoverable task when recovering from ", operation.what() );
+            fatal( "Could not find a recoverable task when recovering from ", _failedOperation.what() );
          } else {
-            debug("Resiliency: checkpoint error detected ", operation.what() );
+            debug("Resiliency: checkpoint error detected ", _failedOperation.what() );
          }
       }
 };
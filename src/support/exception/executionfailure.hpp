@@ -45,11 +45,12 @@ class ExecutionFailure {
          WorkDescriptor &task = operation.getTask();
          task.increaseFailedExecutions();
 
-         WorkDescriptor* recoverableAncestor = nullptr;
-         if( task.isExecutionRepeatable() ) {
-            recoverableAncestor = task.propagateInvalidationAndGetRecoverableAncestor();
-         } else if( task.getParent() != nullptr ) {
-            recoverableAncestor = task.getParent()->propagateInvalidationAndGetRecoverableAncestor();
+         // The task has to be invalidated before checking whether it can be executed again
+         WorkDescriptor* recoverableAncestor = task.propagateInvalidationAndGetRecoverableAncestor();
+         if( recoverableAncestor == &task && !task.isExecutionRepeatable() ) {
+            recoverableAncestor = nullptr;
+            if( task.getParent() != nullptr )
+               recoverableAncestor = task.getParent()->propagateInvalidationAndGetRecoverableAncestor();
          }
 
          if( !recoverableAncestor ) {
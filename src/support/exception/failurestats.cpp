@@ -23,3 +23,6 @@ Atomic<unsigned> FailureStats<DiscardedTask>::_counter     = 0;
 template<>
 Atomic<unsigned> FailureStats<TaskRecovery>::_counter      = 0;
 
+template<>
+Atomic<unsigned> FailureStats<SilentDataCorruption>::_counter = 0;
+
@@ -31,6 +31,7 @@ class ExecutionFailure;
 class ErrorInjection;
 class DiscardedTask;
 class TaskRecovery;
+class SilentDataCorruption;
 
 template < class Error >
 class FailureStats {
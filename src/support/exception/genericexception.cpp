@@ -25,9 +25,15 @@ namespace error {
 
 GenericException::GenericException( std::string const& message ) :
 		std::runtime_error( message ),
-		_runningTaskOnError( getMyThreadSafe()->getCurrentWD() ),
-		_planningTaskOnError( getMyThreadSafe()->getPlanningWD() )
+		_runningTaskOnError( NULL ),
+		_planningTaskOnError( NULL )
 {
+	// Runtime helper threads (e.g. the backup copy engine) are not nanos threads
+	BaseThread *thread = getMyThreadSafe();
+	if ( thread != NULL ) {
+		_runningTaskOnError = thread->getCurrentWD();
+		_planningTaskOnError = thread->getPlanningWD();
+	}
 }
 
 } // namespace error
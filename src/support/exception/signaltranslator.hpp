@@ -32,7 +32,16 @@ namespace error {
 
 template < class SignalException >
 class SignalTranslator {
+	public:
+		/*! Gets a look at signals before they are translated.
+		 * Returns true if the signal has been dealt with, so that the
+		 * interrupted instruction can be executed again.
+		 */
+		typedef bool (*SignalFilter)( siginfo_t* signalInfo );
+
 	private:
+		static SignalFilter s_filter;
+
 		class SingletonTranslator {
 			private:
 				struct sigaction _recoveryAction;
@@ -56,6 +65,8 @@ class SignalTranslator {
 				}
 
 				static void signalHandler( int signalNumber, siginfo_t* signalInfo, void* executionContext ) {
+					if( s_filter != NULL && s_filter( signalInfo ) )
+						return;
 					throw SignalException( signalInfo, (ucontext_t*) executionContext );
 				}
 		};
@@ -66,8 +77,13 @@ class SignalTranslator {
 			static SingletonTranslator s_objTranslator;
 			s_objTranslator.registerHandler();
 		}
+
+		static void setFilter( SignalFilter filter ) { s_filter = filter; }
 };
 
+template < class SignalException >
+typename SignalTranslator<SignalException>::SignalFilter SignalTranslator<SignalException>::s_filter = NULL;
+
 } // namespace error
 } // namespace nanos
 
@@ -150,6 +150,23 @@ void Hwloc::getNumSockets(unsigned int &allowedNodes, int &numSockets, unsigned
 #endif
 }
 
+bool Hwloc::bindMemoryToNumaNode( void *address, std::size_t size, unsigned int node )
+{
+#ifdef HWLOC
+   hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+   hwloc_bitmap_only( nodeset, node );
+#if HWLOC_API_VERSION >= 0x00020000
+   int res = hwloc_set_area_membind( _hwlocTopology, address, size, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET );
+#else
+   int res = hwloc_set_area_membind_nodeset( _hwlocTopology, address, size, nodeset, HWLOC_MEMBIND_BIND, 0 );
+#endif
+   hwloc_bitmap_free( nodeset );
+   return res == 0;
+#else
+   return false;
+#endif
+}
+
 unsigned int Hwloc::getNumaNodeOfGpu( unsigned int gpu ) {
    unsigned int node = 0;
 #ifdef GPU_DEV
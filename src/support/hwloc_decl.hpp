@@ -24,6 +24,7 @@
 #include <config_decl.hpp>
 
 #include <string>
+#include <cstddef>
 
 #ifdef HWLOC
 #include <hwloc.h>
@@ -53,6 +54,17 @@ class Hwloc {
       unsigned int getNumaNodeOfGpu( unsigned int gpu );
       void getNumSockets(unsigned int &allowedNodes, int &numSockets, unsigned int &hwThreads);
 
+      /*!
+       * \brief Binds the pages of a memory range to a NUMA node.
+       * Pages that have not been touched yet will be allocated in that node.
+       *
+       * If hwloc is not available, this function does nothing and returns false.
+       *
+       * @param node OS index of the NUMA node.
+       * @return true if the range could be bound.
+       */
+      bool bindMemoryToNumaNode( void *address, std::size_t size, unsigned int node );
+
       /*!
        * \brief Checks if we can see the CPU, to create the PE.
        * If hwloc has no info on that CPU, we should not continue creating
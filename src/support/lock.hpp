@@ -30,6 +30,43 @@ inline Lock::state_t Lock::operator* () const
    return getState();
 }
 
+inline void Lock::pause ()
+{
+#if defined(__i386__) || defined(__x86_64__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+   __asm__ __volatile__( "yield" ::: "memory" );
+#elif defined(__powerpc__) || defined(__powerpc64__)
+   __asm__ __volatile__( "or 27,27,27" ::: "memory" );
+#else
+   __asm__ __volatile__( "" ::: "memory" );
+#endif
+}
+
+#ifdef NANOS_LOCK_STATS
+#define NANOS_LOCK_ACQUIRED(spins) LockStats::acquired( this, spins )
+#define NANOS_LOCK_RELEASED() LockStats::released( this )
+#else
+#define NANOS_LOCK_ACQUIRED(spins)
+#define NANOS_LOCK_RELEASED()
+#endif
+
+#ifdef NANOS_TICKET_LOCK
+
+inline Lock::state_t Lock::getState () const
+{
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+   const ticket_t serving = __atomic_load_n( &tickets()[0], __ATOMIC_ACQUIRE );
+   const ticket_t next = __atomic_load_n( &tickets()[1], __ATOMIC_ACQUIRE );
+#else
+   const ticket_t serving = ( (volatile ticket_t *) tickets() )[0];
+   const ticket_t next = ( (volatile ticket_t *) tickets() )[1];
+#endif
+   return serving == next ? NANOS_LOCK_FREE : NANOS_LOCK_BUSY;
+}
+
+#else
+
 inline Lock::state_t Lock::getState () const
 {
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
@@ -39,6 +76,8 @@ inline Lock::state_t Lock::getState () const
 #endif
 }
 
+#endif
+
 inline void Lock::operator++ ( int val )
 {
    acquire();
@@ -49,33 +88,112 @@ inline void Lock::operator-- ( int val )
    release();
 }
 
+#ifdef NANOS_TICKET_LOCK
+
+inline void Lock::acquire ( void )
+{
+   acquire_noinst();
+}
+
+inline void Lock::acquire_noinst ( void )
+{
+   unsigned spins = 0;
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+   const ticket_t ticket = __atomic_fetch_add( &tickets()[1], 1, __ATOMIC_ACQ_REL );
+   ticket_t serving;
+   while ( ( serving = __atomic_load_n( &tickets()[0], __ATOMIC_ACQUIRE ) ) != ticket ) {
+#else
+   const ticket_t ticket = __sync_fetch_and_add( &tickets()[1], 1 );
+   ticket_t serving;
+   while ( ( serving = ( (volatile ticket_t *) tickets() )[0] ) != ticket ) {
+#endif
+      // Back off in proportion to the number of threads served before this one
+      for ( unsigned i = (ticket_t) ( ticket - serving ) * NANOS_LOCK_BACKOFF; i > 0; i-- ) pause();
+      spins++;
+   }
+#ifndef HAVE_NEW_GCC_ATOMIC_OPS
+   memoryFence();
+#endif
+   NANOS_LOCK_ACQUIRED( spins );
+}
+
+inline bool Lock::tryAcquire ( void )
+{
+   // Take the next ticket only if it would be served right away
+   union { state_t state; ticket_t tickets[2]; } current, taken;
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+   current.state = __atomic_load_n( &state_, __ATOMIC_ACQUIRE );
+#else
+   current.state = state_;
+#endif
+   if ( current.tickets[0] != current.tickets[1] ) return false;
+
+   taken = current;
+   taken.tickets[1]++;
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+   if ( !__atomic_compare_exchange_n( &state_, &current.state, taken.state, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) ) return false;
+#else
+   if ( !__sync_bool_compare_and_swap( &state_, current.state, taken.state ) ) return false;
+#endif
+   NANOS_LOCK_ACQUIRED( 0 );
+   return true;
+}
+
+inline void Lock::release ( void )
+{
+   NANOS_LOCK_RELEASED();
+   // Only the holder writes the ticket being served; releasing a free lock does nothing
+   const ticket_t serving = tickets()[0];
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+   if ( serving == __atomic_load_n( &tickets()[1], __ATOMIC_ACQUIRE ) ) return;
+   __atomic_store_n( &tickets()[0], (ticket_t) ( serving + 1 ), __ATOMIC_RELEASE );
+#else
+   if ( serving == ( (volatile ticket_t *) tickets() )[1] ) return;
+   memoryFence();
+   ( (volatile ticket_t *) tickets() )[0] = (ticket_t) ( serving + 1 );
+#endif
+}
+
+#else
+
 inline void Lock::acquire ( void )
 {
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
    acquire_noinst();
 #else
-   if ( (state_ == NANOS_LOCK_FREE) &&  !__sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) return;
+   if ( (state_ == NANOS_LOCK_FREE) &&  !__sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) {
+      NANOS_LOCK_ACQUIRED( 0 );
+      return;
+   }
 
    // Disabling lock instrumentation; do not remove follow code which can be reenabled for testing purposes
    // NANOS_INSTRUMENT( InstrumentState inst(NANOS_ACQUIRING_LOCK) )
+   unsigned spins = 0;
 spin:
-   while ( state_ == NANOS_LOCK_BUSY ) {}
+   while ( state_ == NANOS_LOCK_BUSY ) { pause(); }
 
-   if ( __sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) goto spin;
+   if ( __sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) { spins++; goto spin; }
 
+   NANOS_LOCK_ACQUIRED( spins );
    // NANOS_INSTRUMENT( inst.close() )
 #endif
 }
 
 inline void Lock::acquire_noinst ( void )
 {
+   unsigned spins = 0;
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
-   while (__atomic_exchange_n( &state_, NANOS_LOCK_BUSY, __ATOMIC_ACQ_REL) == NANOS_LOCK_BUSY ) { }
+   while (__atomic_exchange_n( &state_, NANOS_LOCK_BUSY, __ATOMIC_ACQ_REL) == NANOS_LOCK_BUSY ) {
+      // Wait until it looks free instead of writing the lock line on every attempt
+      while ( __atomic_load_n( &state_, __ATOMIC_RELAXED ) == NANOS_LOCK_BUSY ) pause();
+      spins++;
+   }
 #else
 spin:
-   while ( state_ == NANOS_LOCK_BUSY ) {}
-   if ( __sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) goto spin;
+   while ( state_ == NANOS_LOCK_BUSY ) { pause(); }
+   if ( __sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) { spins++; goto spin; }
 #endif
+   NANOS_LOCK_ACQUIRED( spins );
 }
 
 inline bool Lock::tryAcquire ( void )
@@ -85,8 +203,10 @@ inline bool Lock::tryAcquire ( void )
    {
       if (__atomic_exchange_n(&state_, NANOS_LOCK_BUSY, __ATOMIC_ACQ_REL) == NANOS_LOCK_BUSY)
          return false;
-      else // will return NANOS_LOCK_FREE
+      else { // will return NANOS_LOCK_FREE
+         NANOS_LOCK_ACQUIRED( 0 );
          return true;
+      }
    }
    else
    {
@@ -95,13 +215,17 @@ inline bool Lock::tryAcquire ( void )
 #else
    if ( state_ == NANOS_LOCK_FREE ) {
       if ( __sync_lock_test_and_set( &state_,NANOS_LOCK_BUSY ) ) return false;
-      else return true;
+      else {
+         NANOS_LOCK_ACQUIRED( 0 );
+         return true;
+      }
    } else return false;
 #endif
 }
 
 inline void Lock::release ( void )
 {
+   NANOS_LOCK_RELEASED();
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
    __atomic_store_n(&state_, 0, __ATOMIC_RELEASE);
 #else
@@ -109,6 +233,8 @@ inline void Lock::release ( void )
 #endif
 }
 
+#endif // NANOS_TICKET_LOCK
+
 inline LockBlock::LockBlock ( Lock & lock ) : _lock(lock)
 {
    acquire();
@@ -22,12 +22,73 @@
 
 #include "nanos-int.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
+//! Pause iterations per waiter ahead in the queue of a ticket lock
+#define NANOS_LOCK_BACKOFF 32
+
+/*! Lock statistics tell acquisition sites apart by the return address of LockStats::acquired,
+ *  so every function from the caller down to it has to be inlined, even in builds without inlining
+ */
+#ifdef NANOS_LOCK_STATS
+#define NANOS_LOCK_INLINE __attribute__(( always_inline ))
+#else
+#define NANOS_LOCK_INLINE
+#endif
+
 namespace nanos {
 
+   class Lock;
+
+   /*! \brief Contention counters of the runtime locks, per acquisition site.
+    *
+    *  Only built with --enable-lock-stats. Sites are the code addresses where
+    *  locks are acquired, since the same lock is usually taken in a few places
+    *  and there are too many lock objects to keep counters for each of them.
+    */
+   class LockStats
+   {
+      public:
+         struct Site {
+            void * volatile   address;
+            uint64_t          acquisitions;
+            uint64_t          contended;     //!< Acquisitions that had to wait
+            uint64_t          spins;
+            uint64_t          holdNs;
+         };
+
+      private:
+         LockStats();
+
+      public:
+         /*! \brief Accounts an acquisition of \a lock after \a spins failed attempts.
+          *  The site is the address this is called from, so it must be called from NANOS_LOCK_INLINE code.
+          */
+         static void acquired ( Lock const *lock, unsigned spins );
+         //! \brief Accounts the time \a lock has been held by the current thread.
+         static void released ( Lock const *lock );
+         //! \brief Prints the \a top sites with the most failed attempts, and stops counting.
+         static void report ( size_t top );
+   };
+
    class Lock : public nanos_lock_t
    {
       private:
          typedef nanos_lock_state_t state_t;
+#ifdef NANOS_TICKET_LOCK
+         /*! \brief A ticket lock keeps the ticket being served and the next ticket in the
+          *  two halves of the lock state, so that it has the size of nanos_lock_t.
+          *  The lock is free when both are equal.
+          */
+         typedef uint16_t __attribute__(( __may_alias__ )) ticket_t;
+
+         ticket_t * tickets () { return (ticket_t *) &state_; }
+         ticket_t const * tickets () const { return (ticket_t const *) &state_; }
+#endif
+
+         //! \brief Tells the processor that the thread is spinning.
+         static void pause ();
 
          // disable copy constructor and assignment operator
          Lock( const Lock &lock );
@@ -35,21 +96,29 @@ namespace nanos {
 
       public:
          // constructor
+#ifdef NANOS_TICKET_LOCK
+         Lock( state_t init=NANOS_LOCK_FREE ) : nanos_lock_t( NANOS_LOCK_FREE )
+         {
+            // A busy lock has handed out a ticket that is not being served yet
+            if ( init == NANOS_LOCK_BUSY ) tickets()[1] = 1;
+         }
+#else
          Lock( state_t init=NANOS_LOCK_FREE ) : nanos_lock_t( init ) {};
+#endif
 
          // destructor
          ~Lock() {}
 
-         void acquire ( void );
-         void acquire_noinst ( void );
-         bool tryAcquire ( void );
+         NANOS_LOCK_INLINE void acquire ( void );
+         NANOS_LOCK_INLINE void acquire_noinst ( void );
+         NANOS_LOCK_INLINE bool tryAcquire ( void );
          void release ( void );
 
          state_t operator* () const;
 
          state_t getState () const;
 
-         void operator++ ( int val );
+         NANOS_LOCK_INLINE void operator++ ( int val );
 
          void operator-- ( int val );
    };
@@ -63,10 +132,10 @@ namespace nanos {
        explicit LockBlock ( const LockBlock & );
 
      public:
-       LockBlock ( Lock & lock );
+       NANOS_LOCK_INLINE LockBlock ( Lock & lock );
        ~LockBlock ( );
 
-       void acquire();
+       NANOS_LOCK_INLINE void acquire();
        void release();
    };
 
@@ -79,10 +148,10 @@ namespace nanos {
        explicit LockBlock_noinst ( const LockBlock_noinst & );
 
      public:
-       LockBlock_noinst ( Lock & lock );
+       NANOS_LOCK_INLINE LockBlock_noinst ( Lock & lock );
        ~LockBlock_noinst ( );
 
-       void acquire();
+       NANOS_LOCK_INLINE void acquire();
        void release();
    };
 
@@ -93,7 +162,7 @@ namespace nanos {
        explicit SyncLockBlock ( const SyncLockBlock & );
 
      public:
-       SyncLockBlock ( Lock & lock );
+       NANOS_LOCK_INLINE SyncLockBlock ( Lock & lock );
        ~SyncLockBlock ( );
    };
 
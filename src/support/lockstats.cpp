@@ -0,0 +1,148 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "lock_decl.hpp"
+
+#ifdef NANOS_LOCK_STATS
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace nanos;
+
+//! Number of acquisition sites that can be told apart (a power of two)
+#define LOCK_STATS_SITES 1024
+//! Locks a thread can hold at the same time and still account their hold time
+#define LOCK_STATS_HELD 16
+
+namespace {
+
+   LockStats::Site _sites[LOCK_STATS_SITES];
+   volatile bool _enabled = true;
+
+   //! Locks held by the current thread, with the time they were taken at
+   struct Held {
+      Lock const        *lock;
+      LockStats::Site   *site;
+      uint64_t           start;
+   };
+
+   __thread Held _held[LOCK_STATS_HELD];
+   __thread unsigned _numHeld = 0;
+
+   uint64_t now()
+   {
+      struct timespec ts;
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+      return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+   }
+
+   //! \brief Finds the counters of \a address, adding them if needed. NULL if the table is full.
+   LockStats::Site * findSite( void *address )
+   {
+      size_t slot = ( ( (uintptr_t) address ) >> 2 ) & ( LOCK_STATS_SITES - 1 );
+      for ( size_t probes = 0; probes < LOCK_STATS_SITES; probes++ ) {
+         LockStats::Site &site = _sites[slot];
+         void *current = site.address;
+         if ( current == address ) return &site;
+         if ( current == NULL ) {
+            current = __sync_val_compare_and_swap( &site.address, (void *) NULL, address );
+            if ( current == NULL || current == address ) return &site;
+         }
+         slot = ( slot + 1 ) & ( LOCK_STATS_SITES - 1 );
+      }
+      return NULL;
+   }
+
+   bool moreSpins( LockStats::Site const *a, LockStats::Site const *b )
+   {
+      return a->spins > b->spins || ( a->spins == b->spins && a->acquisitions > b->acquisitions );
+   }
+
+}
+
+// Not inlined: the return address is the code that takes the lock
+__attribute__(( noinline ))
+void LockStats::acquired ( Lock const *lock, unsigned spins )
+{
+   if ( !_enabled ) return;
+
+   Site *site = findSite( __builtin_return_address( 0 ) );
+   if ( site == NULL ) return;
+
+   __sync_fetch_and_add( &site->acquisitions, 1 );
+   if ( spins > 0 ) {
+      __sync_fetch_and_add( &site->contended, 1 );
+      __sync_fetch_and_add( &site->spins, spins );
+   }
+
+   if ( _numHeld < LOCK_STATS_HELD ) {
+      Held &held = _held[_numHeld++];
+      held.lock = lock;
+      held.site = site;
+      held.start = now();
+   }
+}
+
+void LockStats::released ( Lock const *lock )
+{
+   // Locks are usually released in the reverse order they were taken
+   for ( unsigned i = _numHeld; i > 0; i-- ) {
+      if ( _held[i-1].lock == lock ) {
+         __sync_fetch_and_add( &_held[i-1].site->holdNs, now() - _held[i-1].start );
+         _held[i-1] = _held[--_numHeld];
+         return;
+      }
+   }
+}
+
+void LockStats::report ( size_t top )
+{
+   _enabled = false;
+
+   std::vector<Site *> sites;
+   for ( size_t i = 0; i < LOCK_STATS_SITES; i++ ) {
+      if ( _sites[i].address != NULL && _sites[i].acquisitions > 0 ) sites.push_back( &_sites[i] );
+   }
+   std::sort( sites.begin(), sites.end(), moreSpins );
+   if ( sites.size() > top ) sites.resize( top );
+
+   message( "=== Lock contention per acquisition site (acquisitions, contended, spins, hold time):" );
+   for ( std::vector<Site *>::const_iterator it = sites.begin(); it != sites.end(); it++ ) {
+      Site const &site = **it;
+      std::string name = "?";
+      Dl_info info;
+      if ( dladdr( site.address, &info ) && info.dli_sname != NULL ) {
+         int status;
+         char *demangled = abi::__cxa_demangle( info.dli_sname, NULL, NULL, &status );
+         name = ( status == 0 && demangled != NULL ) ? demangled : info.dli_sname;
+         free( demangled );
+      }
+      message( "===  ", site.address, " ", name, ": ", site.acquisitions, ", ", site.contended, ", ",
+               site.spins, ", ", site.holdNs / 1000, " us" );
+   }
+}
+
+#endif // NANOS_LOCK_STATS
@@ -0,0 +1,105 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "debug.hpp"
+#include "memory/softdirtytracker.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace nanos::memory;
+
+//! Soft-dirty bit of a pagemap entry (see linux/Documentation/vm/soft-dirty.txt)
+#define PAGEMAP_SOFT_DIRTY ( (uint64_t) 1 << 55 )
+
+SoftDirtyTracker::~SoftDirtyTracker()
+{
+   if ( _pagemap >= 0 ) close( _pagemap );
+   if ( _clearRefs >= 0 ) close( _clearRefs );
+}
+
+bool SoftDirtyTracker::isDirty( void *address )
+{
+   uint64_t entry = 0;
+   off_t offset = ( (uintptr_t) address / MemoryPage::size() ) * sizeof(entry);
+   if ( pread( _pagemap, &entry, sizeof(entry), offset ) != sizeof(entry) )
+      return true;
+   return ( entry & PAGEMAP_SOFT_DIRTY ) != 0;
+}
+
+bool SoftDirtyTracker::init()
+{
+   _pagemap = open( "/proc/self/pagemap", O_RDONLY );
+   _clearRefs = open( "/proc/self/clear_refs", O_WRONLY );
+
+   bool supported = _pagemap >= 0 && _clearRefs >= 0;
+   if ( supported ) {
+      // The kernel may provide the files but not the soft-dirty bits
+      void *probe = mmap( NULL, MemoryPage::size(), PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0 );
+      if ( probe != MAP_FAILED ) {
+         volatile char *page = (volatile char *) probe;
+         page[0] = 1;
+         clear();
+         const bool cleared = !isDirty( probe );
+         page[0] = 2;
+         supported = cleared && isDirty( probe );
+         munmap( probe, MemoryPage::size() );
+      } else {
+         supported = false;
+      }
+   }
+
+   if ( !supported ) {
+      if ( _pagemap >= 0 ) close( _pagemap );
+      if ( _clearRefs >= 0 ) close( _clearRefs );
+      _pagemap = _clearRefs = -1;
+   }
+   return supported;
+}
+
+bool SoftDirtyTracker::getDirtyPages( MemoryChunk const& chunk, std::vector<bool> &dirty )
+{
+   MemoryChunk area( chunk );
+   const uintptr_t first = area.begin().value() / MemoryPage::size();
+   const uintptr_t last = ( area.end().value() - 1 ) / MemoryPage::size();
+
+   dirty.assign( last - first + 1, true );
+
+   // Read the entries in batches, one pread for many pages
+   const size_t batch = 512;
+   uint64_t entries[batch];
+   for ( uintptr_t page = first; page <= last; page += batch ) {
+      const size_t count = std::min<uintptr_t>( batch, last - page + 1 );
+      const ssize_t bytes = count * sizeof(uint64_t);
+      if ( pread( _pagemap, entries, bytes, page * sizeof(uint64_t) ) != bytes )
+         return false;
+      for ( size_t i = 0; i < count; i++ )
+         dirty[page - first + i] = ( entries[i] & PAGEMAP_SOFT_DIRTY ) != 0;
+   }
+   return true;
+}
+
+void SoftDirtyTracker::clear()
+{
+   // "4" clears the soft-dirty bits of every page of the process
+   if ( write( _clearRefs, "4", 1 ) == 1 )
+      _epoch++;
+}
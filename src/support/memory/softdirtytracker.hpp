@@ -0,0 +1,78 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef SOFT_DIRTY_TRACKER_HPP
+#define SOFT_DIRTY_TRACKER_HPP
+
+#include "memory/memorypage.hpp"
+
+#include <vector>
+
+namespace nanos {
+namespace memory {
+
+/*!
+ * \brief Finds out which memory pages have been written, using the
+ * soft-dirty bits that Linux exposes in /proc/self/pagemap.
+ *
+ * Soft-dirty bits can only be cleared for the whole process at once. To
+ * tell if some information is still meaningful, every clear increases an
+ * epoch: a page that is not dirty has not been written since the epoch
+ * began. This class is not thread-safe; concurrent callers must serialize
+ * calls, and must not read pages while they are being cleared.
+ */
+class SoftDirtyTracker {
+   private:
+      int      _pagemap;    //!< Descriptor of /proc/self/pagemap (-1 if disabled)
+      int      _clearRefs;  //!< Descriptor of /proc/self/clear_refs (-1 if disabled)
+      unsigned _epoch;      //!< Number of times the soft-dirty bits have been cleared
+
+      SoftDirtyTracker( SoftDirtyTracker const& );
+      SoftDirtyTracker& operator=( SoftDirtyTracker const& );
+
+      //! \returns whether the soft-dirty bit of the page that contains an address is set.
+      bool isDirty( void *address );
+
+   public:
+      SoftDirtyTracker() : _pagemap( -1 ), _clearRefs( -1 ), _epoch( 0 ) {}
+
+      ~SoftDirtyTracker();
+
+      /*! \brief Opens the kernel interfaces and checks that writes set the soft-dirty bit.
+       *  \returns false if the kernel does not support soft-dirty bits.
+       */
+      bool init();
+
+      bool isEnabled() const { return _pagemap >= 0; }
+
+      unsigned getEpoch() const { return _epoch; }
+
+      /*! \brief Reads the soft-dirty bit of every page that overlaps a chunk.
+       *  \returns false if the bits could not be read.
+       */
+      bool getDirtyPages( MemoryChunk const& chunk, std::vector<bool> &dirty );
+
+      //! \brief Clears the soft-dirty bits of the whole process and starts a new epoch.
+      void clear();
+};
+
+} // namespace memory
+} // namespace nanos
+
+#endif // SOFT_DIRTY_TRACKER_HPP
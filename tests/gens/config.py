@@ -69,8 +69,8 @@ if options.deps_plugins:
 max_cpus=int(max_cpus)
 
 scheduling_performance=[]
-scheduling_small=['--schedule=dbf','--schedule=dbf --schedule-priority']
-scheduling_large=['--schedule=bf --bf-stack','--schedule=bf --no-bf-stack','--schedule=dbf', '--schedule=affinity']
+scheduling_small=['--schedule=dbf','--schedule=dbf --schedule-priority','--schedule=ws']
+scheduling_large=['--schedule=bf --bf-stack','--schedule=bf --no-bf-stack','--schedule=dbf', '--schedule=ws', '--schedule=affinity']
 throttle=['--throttle=dummy','--throttle=idlethreads','--throttle=numtasks','--throttle=readytasks','--throttle=taskdepth']
 barriers=['--barrier=centralized','--barrier=tree']
 binding=['--disable-binding','--no-disable-binding']
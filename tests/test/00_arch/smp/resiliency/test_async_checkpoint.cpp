@@ -0,0 +1,143 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ test_ENV="NX_BACKUP_ASYNC=yes NX_TASK_RETRIALS=2"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <string.h>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include "backupmanager.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define NUM_TASKS 16
+#define BLOCK_SIZE ( 64 * 1024 )
+
+typedef struct {
+   unsigned char *input;
+   long *result;
+   int executions;
+} consume_args;
+
+static unsigned char data[NUM_TASKS][BLOCK_SIZE];
+static long results[NUM_TASKS];
+
+static unsigned char value( size_t block, size_t i )
+{
+   return (unsigned char) ( i * 7 + block );
+}
+
+// Try to write to an invalid address: SIGSEGV
+static void fail()
+{
+   volatile int * volatile a = 0;
+   *a = 1;
+}
+
+static void consume( void *ptr )
+{
+   consume_args *args = (consume_args *) ptr;
+   size_t block = ( args->input - data[0] ) / BLOCK_SIZE;
+   args->executions++;
+
+   // The first execution of the last task overwrites its data before
+   // failing: the backup made by the copy engine must be complete by then
+   if ( block == NUM_TASKS - 1 && args->executions == 1 ) {
+      memset( args->input, 0, BLOCK_SIZE );
+      fail();
+   }
+
+   long sum = 0;
+   for ( size_t i = 0; i < BLOCK_SIZE; i++ )
+      sum += args->input[i] == value( block, i );
+   *args->result = sum;
+}
+
+static nanos_smp_args_t consume_device = { consume };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} consume_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(consume_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &consume_device } }
+};
+
+int main ( int argc, char **argv )
+{
+   for ( size_t b = 0; b < NUM_TASKS; b++ )
+      for ( size_t i = 0; i < BLOCK_SIZE; i++ )
+         data[b][i] = value( b, i );
+
+   for ( size_t b = 0; b < NUM_TASKS; b++ ) {
+      consume_args *args = NULL;
+      nanos_copy_data_t *copies = NULL;
+      nanos_region_dimension_internal_t *dimensions = NULL;
+      nanos_wd_t wd = NULL;
+      nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+      dyn_props.flags.is_recover = true;
+
+      NANOS_SAFE( nanos_create_wd_compact( &wd, &consume_definition.base, &dyn_props, sizeof(consume_args),
+                                           (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+      args->input = data[b];
+      args->result = &results[b];
+      args->executions = 0;
+
+      dimensions[0].size = BLOCK_SIZE;
+      dimensions[0].lower_bound = 0;
+      dimensions[0].accessed_length = BLOCK_SIZE;
+      copies[0].address = data[b];
+      copies[0].sharing = NANOS_SHARED;
+      copies[0].flags.input = true;
+      copies[0].flags.output = true;
+      copies[0].dimension_count = 1;
+      copies[0].dimensions = dimensions;
+      copies[0].offset = 0;
+
+      NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+   }
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   bool error = false;
+   for ( size_t b = 0; b < NUM_TASKS; b++ ) {
+      if ( results[b] != BLOCK_SIZE ) {
+         cout << "Block " << b << " was not restored: " << BLOCK_SIZE - results[b] << " wrong bytes" << endl;
+         error = true;
+      }
+   }
+
+   BackupManager &backup = reinterpret_cast<BackupManager&>( sys.getBackupMemory().getCache().getDevice() );
+   unsigned copies, helped;
+   backup.getAsyncStats( copies, helped );
+   if ( !backup.isAsync() || copies < NUM_TASKS ) {
+      cout << copies << " asynchronous checkpoint copies" << endl;
+      error = true;
+   }
+
+   cout << "Async checkpoint: " << ( error ? "FAILED" : "OK" ) << endl;
+   return error ? 1 : 0;
+}
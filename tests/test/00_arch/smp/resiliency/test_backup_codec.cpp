@@ -0,0 +1,106 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "config.hpp"
+#include "backupcodec.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define FRAME_SIZE ( 64 * 1024 )
+
+// Sparse data: runs of zeros and of repeated values, with a few random words
+static void fill( vector<char> &data, unsigned seed )
+{
+   srand( seed );
+   size_t i = 0;
+   while ( i < data.size() ) {
+      size_t run = rand() % 4096 + 1;
+      int kind = rand() % 4;
+      char value = (char) rand();
+      for ( size_t j = 0; j < run && i < data.size(); j++, i++ )
+         data[i] = kind == 0 ? 0 : kind == 1 ? value : kind == 2 ? (char) ( j % 8 ) : (char) rand();
+   }
+}
+
+int main ( int argc, char **argv )
+{
+   int errors = 0;
+   vector<char> encoded( BackupCodec::getMaxEncodedSize( FRAME_SIZE ) );
+   vector<char> decoded( FRAME_SIZE );
+
+   for ( unsigned seed = 0; seed < 32; seed++ ) {
+      // Lengths that are not a multiple of the word size leave a literal tail
+      vector<char> data( FRAME_SIZE - seed * 7 );
+      fill( data, seed );
+
+      size_t size = BackupCodec::encode( &data[0], data.size(), &encoded[0] );
+      if ( size == 0 ) {
+         cout << "Seed " << seed << ": sparse data was not compressed" << endl;
+         errors++;
+         continue;
+      }
+
+      BackupCodec::decode( &encoded[0], size, 0, &decoded[0], data.size() );
+      if ( memcmp( &data[0], &decoded[0], data.size() ) != 0 ) {
+         cout << "Seed " << seed << ": wrong round trip" << endl;
+         errors++;
+      }
+
+      // Any range must be decoded without the data that precedes it
+      for ( unsigned i = 0; i < 64; i++ ) {
+         size_t offset = rand() % data.size();
+         size_t length = rand() % ( data.size() - offset ) + 1;
+         memset( &decoded[0], 0x55, length );
+         BackupCodec::decode( &encoded[0], size, offset, &decoded[0], length );
+         if ( memcmp( &data[offset], &decoded[0], length ) != 0 ) {
+            cout << "Seed " << seed << ": wrong range [" << offset << ", " << offset + length << ")" << endl;
+            errors++;
+            break;
+         }
+      }
+
+      // Bytes past the encoded data are zero
+      BackupCodec::decode( &encoded[0], size, data.size(), &decoded[0], 16 );
+      for ( size_t i = 0; i < 16; i++ )
+         if ( decoded[i] != 0 ) { cout << "Seed " << seed << ": data past the end" << endl; errors++; break; }
+   }
+
+   // Random data is not worth compressing
+   vector<char> dense( FRAME_SIZE );
+   for ( size_t i = 0; i < dense.size(); i++ )
+      dense[i] = (char) rand();
+   if ( BackupCodec::encode( &dense[0], dense.size(), &encoded[0] ) != 0 ) {
+      cout << "Dense data was compressed" << endl;
+      errors++;
+   }
+
+   cout << "Backup codec: " << ( errors == 0 ? "OK" : "FAILED" ) << endl;
+   return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "config.hpp"
+#include "system.hpp"
+#include "smpdd.hpp"
+#include "atomic.hpp"
+#include "backuppool.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define POOL_SIZE ( 64 * 1024 * 1024 )
+#define NUM_TASKS 64
+#define LIVE_BLOCKS 64
+#define ROUNDS 2000
+
+static BackupPool *pool;
+static Atomic<int> errors( 0 );
+
+// Every block is filled with the id of its owner, which must still be there when it is freed
+static void fill( unsigned char *block, size_t size, unsigned char owner )
+{
+   memset( block, owner, size );
+}
+
+static bool intact( unsigned char const *block, size_t size, unsigned char owner )
+{
+   for ( size_t i = 0; i < size; i++ )
+      if ( block[i] != owner ) return false;
+   return true;
+}
+
+static void worker( void *args )
+{
+   unsigned id = *static_cast<unsigned*>( args );
+   unsigned char owner = (unsigned char) ( id + 1 );
+   unsigned seed = id;
+   unsigned char *blocks[LIVE_BLOCKS];
+   size_t sizes[LIVE_BLOCKS];
+   memset( blocks, 0, sizeof(blocks) );
+
+   for ( unsigned r = 0; r < ROUNDS; r++ ) {
+      unsigned slot = rand_r( &seed ) % LIVE_BLOCKS;
+      if ( blocks[slot] != NULL ) {
+         if ( !intact( blocks[slot], sizes[slot], owner ) ) errors++;
+         pool->deallocate( blocks[slot] );
+         blocks[slot] = NULL;
+      } else {
+         // Mostly small blocks, of every size class, and a few large ones
+         sizes[slot] = ( r % 97 == 0 ) ? 100000 + rand_r( &seed ) % 100000 : 1 + rand_r( &seed ) % 20000;
+         blocks[slot] = static_cast<unsigned char*>( pool->allocate( sizes[slot] ) );
+         if ( blocks[slot] == NULL ) errors++;
+         else fill( blocks[slot], sizes[slot], owner );
+      }
+   }
+   for ( unsigned slot = 0; slot < LIVE_BLOCKS; slot++ ) {
+      if ( blocks[slot] == NULL ) continue;
+      if ( !intact( blocks[slot], sizes[slot], owner ) ) errors++;
+      pool->deallocate( blocks[slot] );
+   }
+}
+
+int main ( int argc, char **argv )
+{
+   bool ok = true;
+   void *memory = mmap( NULL, POOL_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+   pool = new BackupPool( memory, POOL_SIZE, sys.getSMPPlugin()->getNumThreads() );
+
+   WD *wg = getMyThreadSafe()->getCurrentWD();
+   unsigned ids[NUM_TASKS];
+   for ( unsigned i = 0; i < NUM_TASKS; i++ ) {
+      ids[i] = i;
+      WD *wd = new WD( new ext::SMPDD( worker ), sizeof(unsigned), __alignof__(unsigned), &ids[i] );
+      wg->addWork( *wd );
+      sys.submit( *wd );
+   }
+   wg->waitCompletion();
+
+   if ( errors.value() > 0 ) {
+      cout << errors.value() << " blocks were not allocated or were overwritten" << endl;
+      ok = false;
+   }
+
+   BackupPool::Stats stats;
+   pool->getStats( stats );
+   if ( stats.used != 0 ) {
+      cout << stats.used << " bytes still in use" << endl;
+      ok = false;
+   }
+   if ( stats.threadHits == 0 ) {
+      cout << "no allocation was served by a thread magazine" << endl;
+      ok = false;
+   }
+   if ( stats.large == 0 || stats.requested > stats.allocated || stats.highWater > stats.capacity ) {
+      cout << "inconsistent counters: " << stats.large << " large, " << stats.requested << " of "
+           << stats.allocated << " bytes requested, high water " << stats.highWater << endl;
+      ok = false;
+   }
+
+   // Requests that do not fit are refused
+   if ( pool->allocate( 2 * POOL_SIZE ) != NULL ) {
+      cout << "allocation larger than the pool did not fail" << endl;
+      ok = false;
+   }
+   pool->getStats( stats );
+   if ( stats.failures != 1 ) {
+      cout << stats.failures << " failed allocations, expected 1" << endl;
+      ok = false;
+   }
+
+   delete pool;
+   munmap( memory, POOL_SIZE );
+
+   if ( !ok ) return 1;
+   cout << "Backup pool: OK" << endl;
+   return 0;
+}
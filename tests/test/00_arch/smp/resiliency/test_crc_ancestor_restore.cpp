@@ -0,0 +1,172 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator -a \"--no-lazy-checkpoint|--lazy-checkpoint\""
+ test_ENV="NX_ENABLE_CRC=yes"
+ </testinfo>
+ */
+
+#include <iostream>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include "backuplazycopy_decl.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define PAGE 4096
+#define SIZE ( 4 * PAGE )
+
+typedef struct {
+   unsigned char *data;
+} task_args;
+
+static unsigned char data[SIZE] __attribute__(( aligned( PAGE ) ));
+static long result;
+static int enclosingExecutions;
+
+static unsigned char value( size_t i )
+{
+   return (unsigned char) ( i * 13 + 1 );
+}
+
+static void produce( void *ptr );
+static void enclose( void *ptr );
+static void consume( void *ptr );
+
+static nanos_smp_args_t produce_device = { produce };
+static nanos_smp_args_t enclose_device = { enclose };
+static nanos_smp_args_t consume_device = { consume };
+
+typedef struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} task_definition;
+
+static task_definition produce_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(task_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &produce_device } }
+};
+static task_definition enclose_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(task_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &enclose_device } }
+};
+static task_definition consume_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(task_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &consume_device } }
+};
+
+//! Creates a recoverable task that accesses the whole data array.
+static void submit( task_definition &definition, bool input, bool output )
+{
+   task_args *args = NULL;
+   nanos_copy_data_t *copies = NULL;
+   nanos_region_dimension_internal_t *dimensions = NULL;
+   nanos_wd_t wd = NULL;
+   nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+   dyn_props.flags.is_recover = true;
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &definition.base, &dyn_props, sizeof(task_args),
+                                        (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+   args->data = data;
+
+   dimensions[0].size = SIZE;
+   dimensions[0].lower_bound = 0;
+   dimensions[0].accessed_length = SIZE;
+   copies[0].address = data;
+   copies[0].sharing = NANOS_SHARED;
+   copies[0].flags.input = input;
+   copies[0].flags.output = output;
+   copies[0].dimension_count = 1;
+   copies[0].dimensions = dimensions;
+   copies[0].offset = 0;
+
+   nanos_data_access_t dependence = nanos_data_access_t();
+   dependence.address = data;
+   dependence.flags.input = input;
+   dependence.flags.output = output;
+   dependence.dimension_count = 1;
+   dependence.dimensions = dimensions;
+   dependence.offset = 0;
+
+   NANOS_SAFE( nanos_submit( wd, 1, &dependence, NULL ) );
+}
+
+static void produce( void *ptr )
+{
+   task_args *args = (task_args *) ptr;
+   for ( size_t i = 0; i < SIZE; i++ )
+      args->data[i] = value( i );
+}
+
+static void enclose( void *ptr )
+{
+   task_args *args = (task_args *) ptr;
+   enclosingExecutions++;
+
+   // A bit flips after this task made its backup (or write-protected its input): its child finds it
+   if ( enclosingExecutions == 1 )
+      args->data[SIZE / 2] ^= 0x10;
+
+   submit( consume_definition, true, false );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+}
+
+static void consume( void *ptr )
+{
+   task_args *args = (task_args *) ptr;
+   long sum = 0;
+   for ( size_t i = 0; i < SIZE; i++ )
+      sum += args->data[i] == value( i );
+   result = sum;
+}
+
+int main ( int argc, char **argv )
+{
+   submit( produce_definition, false, true );
+   // Inout data gets a private backup, that its child does not share. Lazy backups are only made
+   // for read-only inputs, and are kept apart by copying the pages when they are written
+   submit( enclose_definition, true, !sys.isLazyCheckpointEnabled() );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   bool error = false;
+   if ( result != SIZE ) {
+      cout << "The input was not restored: " << SIZE - result << " wrong bytes" << endl;
+      error = true;
+   }
+   // The restored pages, and those left in place, match the CRC of the input: nothing runs again
+   if ( enclosingExecutions != 1 ) {
+      cout << "The enclosing task ran " << enclosingExecutions << " times" << endl;
+      error = true;
+   }
+   if ( sys.isLazyCheckpointEnabled() ) {
+      BackupLazyCopy::Stats stats;
+      BackupLazyCopy::getStats( stats );
+      if ( stats.inputs == 0 || stats.copiedPages == 0 ) {
+         cout << stats.inputs << " lazy backups, " << stats.copiedPages << " pages copied on write" << endl;
+         error = true;
+      }
+   }
+
+   cout << "CRC ancestor restore: " << ( error ? "FAILED" : "OK" ) << endl;
+   return error ? 1 : 0;
+}
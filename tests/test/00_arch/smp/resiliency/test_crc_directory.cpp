@@ -0,0 +1,300 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <string.h>
+#include "config.hpp"
+#include "system.hpp"
+#include "copydata.hpp"
+#include "globalregt.hpp"
+#include "regiondict.hpp"
+#include "version.hpp"
+#include "crcdirectory_decl.hpp"
+#include "crc/crc32c.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define ROWS 16
+#define COLS 64
+
+static double matrix[ROWS][COLS];
+
+static nanos_region_dimension_internal_t dims[2];
+
+/*! \brief Builds the CopyData of the block [row, row+rows) x [col, col+cols) of matrix.
+ *  Only one block can be used at a time, as they share their dimensions.
+ */
+static CopyData block( size_t row, size_t rows, size_t col, size_t cols )
+{
+   dims[0].size = COLS * sizeof(double);
+   dims[0].lower_bound = col * sizeof(double);
+   dims[0].accessed_length = cols * sizeof(double);
+   dims[1].size = ROWS;
+   dims[1].lower_bound = row;
+   dims[1].accessed_length = rows;
+   return CopyData( (void *) matrix, NANOS_SHARED, true, true, 2, dims );
+}
+
+/*! \brief Checks a region against the directory. \returns true if corruption was found. */
+static bool verify( CRCDirectory &directory, CopyData const &cd )
+{
+   CRCDirectory::RunList runs;
+   CRCDirectory::getRuns( cd, runs );
+   bool corrupted = false;
+   for ( CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it )
+      corrupted |= directory.verify( global_reg_t(), *it );
+   return corrupted;
+}
+
+static void update( CRCDirectory &directory, CopyData const &cd )
+{
+   CRCDirectory::RunList runs;
+   CRCDirectory::getRuns( cd, runs );
+   for ( CRCDirectory::RunList::const_iterator it = runs.begin(); it != runs.end(); ++it )
+      directory.update( global_reg_t(), *it );
+}
+
+int main ( int argc, char **argv )
+{
+   bool errors = false;
+   CRCDirectory directory;
+
+   for ( int i = 0; i < ROWS; i++ )
+      for ( int j = 0; j < COLS; j++ )
+         matrix[i][j] = i * COLS + j;
+
+   // Full rows are contiguous and must be merged into a single run
+   CRCDirectory::RunList runs;
+   CRCDirectory::getRuns( block( 2, 4, 0, COLS ), runs );
+   if ( runs.size() != 1 || runs[0].address != (uint64_t) &matrix[2][0] || runs[0].length != 4 * COLS * sizeof(double) ) {
+      cerr << "Error: full rows were not merged into one run." << endl;
+      errors = true;
+   }
+
+   // Partial rows use the leading dimension as stride
+   runs.clear();
+   CRCDirectory::getRuns( block( 1, 3, 8, 16 ), runs );
+   if ( runs.size() != 3 || runs[2].address != (uint64_t) &matrix[3][8] || runs[2].length != 16 * sizeof(double) ) {
+      cerr << "Error: wrong runs for a partial block." << endl;
+      errors = true;
+   }
+
+   // A producer writes the whole matrix, consumers read blocks of a different shape
+   update( directory, block( 0, ROWS, 0, COLS ) );
+   if ( verify( directory, block( 4, 4, 0, COLS ) ) || verify( directory, block( 0, ROWS, 0, COLS ) ) ) {
+      cerr << "Error: false positive on unmodified data." << endl;
+      errors = true;
+   }
+
+   // A producer rewrites a sub-block: only that sub-block is rehashed
+   matrix[5][3] = -1.0;
+   update( directory, block( 4, 2, 0, COLS ) );
+   if ( verify( directory, block( 4, 2, 0, COLS ) ) ) {
+      cerr << "Error: false positive after updating a sub-block." << endl;
+      errors = true;
+   }
+
+   // Silent corruption of a protected sub-block must be detected
+   matrix[4][10] = 42.0;
+   if ( !verify( directory, block( 4, 2, 0, COLS ) ) ) {
+      cerr << "Error: corruption not detected." << endl;
+      errors = true;
+   }
+   // The checksum of the good data is kept until the data is restored
+   if ( !verify( directory, block( 4, 2, 0, COLS ) ) ) {
+      cerr << "Error: corruption forgotten after being detected." << endl;
+      errors = true;
+   }
+
+   // Checksums computed elsewhere are checked by combining the stored pieces
+   CRCDirectory other;
+   update( other, block( 0, 2, 0, COLS ) );
+   update( other, block( 2, 2, 0, COLS ) );
+   crc::Crc32c crc;
+   crc.update( matrix, 4 * COLS * sizeof(double) );
+   bool mismatch = true;
+   CRCDirectory::Run whole( (uint64_t) matrix, 4 * COLS * sizeof(double) );
+   if ( !other.check( global_reg_t(), whole, crc.finalize(), mismatch ) || mismatch ) {
+      cerr << "Error: combined checksum does not match." << endl;
+      errors = true;
+   }
+
+   // Objects are told apart by their base address, not by their dictionary, which may be replaced
+   static nanos_region_dimension_internal_t rowDims[1] = { { COLS * sizeof(double), 0, COLS * sizeof(double) } };
+   CRCDirectory::Run rowRun( (uint64_t) matrix[8], COLS * sizeof(double) );
+   GlobalRegionDictionary *dictionary = new GlobalRegionDictionary( CopyData( (void *) matrix[8], NANOS_SHARED, true, true, 1, rowDims ) );
+   CRCDirectory replaced;
+   replaced.update( global_reg_t( 1, dictionary ), rowRun );
+   delete dictionary;
+   dictionary = new GlobalRegionDictionary( CopyData( (void *) matrix[8], NANOS_SHARED, true, true, 1, rowDims ) );
+   crc::Crc32c rowCRC;
+   rowCRC.update( matrix[8], COLS * sizeof(double) );
+   if ( !replaced.check( global_reg_t( 1, dictionary ), rowRun, rowCRC.finalize(), mismatch ) || mismatch ) {
+      cerr << "Error: checksum lost when the region dictionary was replaced." << endl;
+      errors = true;
+   }
+   delete dictionary;
+
+   // Many data objects: the object table must grow without losing any of them
+   CRCDirectory objects;
+   static char keys[1000];
+   static nanos_region_dimension_internal_t keyDims[1] = { { 1, 0, 1 } };
+   GlobalRegionDictionary *dictionaries[1000];
+   for ( int i = 0; i < 1000; i++ ) {
+      dictionaries[i] = new GlobalRegionDictionary( CopyData( (void *) &keys[i], NANOS_SHARED, true, true, 1, keyDims ) );
+      objects.update( global_reg_t( 1, dictionaries[i] ), CRCDirectory::Run( (uint64_t) matrix[i % ROWS], COLS * sizeof(double) ) );
+   }
+   // Dictionaries replaced after the update must still find the checksums of their object
+   for ( int i = 0; i < 1000; i++ ) {
+      delete dictionaries[i];
+      dictionaries[i] = new GlobalRegionDictionary( CopyData( (void *) &keys[i], NANOS_SHARED, true, true, 1, keyDims ) );
+   }
+   for ( int i = 0; i < 1000; i++ ) {
+      crc::Crc32c row;
+      row.update( matrix[i % ROWS], COLS * sizeof(double) );
+      if ( !objects.check( global_reg_t( 1, dictionaries[i] ), CRCDirectory::Run( (uint64_t) matrix[i % ROWS], COLS * sizeof(double) ), row.finalize(), mismatch ) || mismatch ) {
+         cerr << "Error: checksum of object " << i << " lost." << endl;
+         errors = true;
+         break;
+      }
+   }
+   CRCDirectory::Stats stats;
+   objects.getStats( stats );
+   if ( stats.hits != 1000 || stats.mismatches != 0 ) {
+      cerr << "Error: wrong directory counters." << endl;
+      errors = true;
+   }
+   for ( int i = 0; i < 1000; i++ )
+      delete dictionaries[i];
+
+   // Large runs are hashed in chunks, possibly by other threads, and then combined
+   CRCJob job;
+   job.addRun( global_reg_t(), whole, 100 );
+   job.addRun( global_reg_t(), CRCDirectory::Run( (uint64_t) matrix[4], COLS * sizeof(double) ), 100 );
+   if ( !objects.share( job ) || !objects.help() ) {
+      cerr << "Error: shared job could not be helped." << endl;
+      errors = true;
+   }
+   objects.join( job );
+   crc::Crc32c row4;
+   row4.update( matrix[4], COLS * sizeof(double) );
+   if ( job.getCRC( 0 ) != crc.finalize() || job.getCRC( 1 ) != row4.finalize() ) {
+      cerr << "Error: chunked checksum does not match." << endl;
+      errors = true;
+   }
+
+   // Output checksums can be stored later, readers wait for them
+   CRCDirectory outputs;
+   CRCJob *output = new CRCJob();
+   output->addRun( global_reg_t(), whole, 100 );
+   outputs.submit( output, true );
+   outputs.wait( global_reg_t() );
+   if ( !outputs.check( global_reg_t(), whole, crc.finalize(), mismatch ) || mismatch ) {
+      cerr << "Error: deferred output checksum does not match." << endl;
+      errors = true;
+   }
+
+   // Deferred jobs on disjoint runs of one object may be stored in any order
+   CRCDirectory::Run row0( (uint64_t) matrix[0], COLS * sizeof(double) );
+   CRCDirectory::Run row1( (uint64_t) matrix[1], COLS * sizeof(double) );
+   CRCDirectory unordered;
+   unordered.update( global_reg_t(), row0 );
+   matrix[0][0] += 1.0;
+   CRCJob *older = new CRCJob();
+   older->addRun( global_reg_t(), row0, 100 );
+   unordered.submit( older, true );
+   CRCJob *newer = new CRCJob();
+   newer->addRun( global_reg_t(), row1, 100 );
+   unordered.submit( newer, true );
+   unordered.join( *newer );
+   unordered.join( *older );
+   delete newer;
+   delete older;
+   crc::Crc32c written;
+   written.update( matrix[0], COLS * sizeof(double) );
+   if ( !unordered.check( global_reg_t(), row0, written.finalize(), mismatch ) || mismatch ) {
+      cerr << "Error: checksum of a deferred output lost to a newer job on another run." << endl;
+      errors = true;
+   }
+   matrix[0][0] -= 1.0;
+
+   // Large outputs keep the checksums of their blocks, and readers can check only some of them
+   static char large[64 * 1024];
+   for ( size_t i = 0; i < sizeof(large); i++ )
+      large[i] = (char) i;
+   CRCDirectory sampling;
+   sampling.setBlocks( 4096, 16 * 1024 );
+   sampling.enableSampling( 4 );
+   CRCDirectory::Run largeRun( (uint64_t) large, sizeof(large) );
+   CRCJob *blocks = new CRCJob();
+   sampling.addOutput( *blocks, global_reg_t(), largeRun, 100 );
+   sampling.submit( blocks, false );
+   if ( !sampling.isSampled( largeRun ) || !sampling.sample( global_reg_t(), largeRun, mismatch ) || mismatch ) {
+      cerr << "Error: sampled check of unmodified data failed." << endl;
+      errors = true;
+   }
+   sampling.getStats( stats );
+   if ( stats.sampled != 1 || stats.sampledTotal != sizeof(large) || stats.sampledBytes * 4 != sizeof(large) ) {
+      cerr << "Error: wrong sampling counters." << endl;
+      errors = true;
+   }
+   // Only runs stored in blocks can be sampled
+   if ( sampling.sample( global_reg_t(), CRCDirectory::Run( (uint64_t) large, 32 * 1024 ), mismatch ) ) {
+      cerr << "Error: sampled a run that was not stored in blocks." << endl;
+      errors = true;
+   }
+   // Every sampled check picks a block in each stride
+   for ( size_t i = 0; i < sizeof(large); i += 4096 )
+      large[i + 7] ^= 1;
+   if ( !sampling.sample( global_reg_t(), largeRun, mismatch ) || !mismatch ) {
+      cerr << "Error: corruption not detected by sampling." << endl;
+      errors = true;
+   }
+
+   // Damage is located block by block, with the checksum each block has to be restored to
+   CRCDirectory::DamageList damage;
+   sampling.locate( global_reg_t(), largeRun, damage );
+   large[7] ^= 1;
+   crc::Crc32c restored;
+   restored.update( large, 4096 );
+   if ( damage.size() != sizeof(large) / 4096 || damage[0].run.length != 4096 || damage[0].crc != restored.finalize() ) {
+      cerr << "Error: corrupted blocks not located." << endl;
+      errors = true;
+   }
+   damage.clear();
+   sampling.locate( global_reg_t(), largeRun, damage );
+   if ( damage.size() != sizeof(large) / 4096 - 1 ) {
+      cerr << "Error: restored block still located as corrupted." << endl;
+      errors = true;
+   }
+
+   if ( errors ) {
+      cout << "end: errors detected" << endl;
+      return -1;
+   }
+   cout << "end: success" << endl;
+   return 0;
+}
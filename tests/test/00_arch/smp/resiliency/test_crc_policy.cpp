@@ -0,0 +1,139 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ </testinfo>
+ */
+
+#include <iostream>
+#include "config.hpp"
+#include "system.hpp"
+#include "copydata.hpp"
+#include "smpdd.hpp"
+#include "crcpolicy_decl.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define SMALL 1024
+#define LARGE ( 1024 * 1024 )
+
+static char smallBuffer[SMALL];
+static char largeBuffer[LARGE];
+
+static nanos_region_dimension_internal_t smallDims[1] = { { SMALL, 0, SMALL } };
+static nanos_region_dimension_internal_t largeDims[1] = { { LARGE, 0, LARGE } };
+
+// Task types are told apart by their outline function: keep the bodies different
+static volatile int executions;
+static void cheapTask( void *args ) { executions += 1; }
+static void longTask( void *args ) { executions += 2; }
+static void shortTask( void *args ) { executions += 3; }
+
+static const char * modeName( CRCPolicy::Mode mode )
+{
+   return mode == CRCPolicy::CHECKSUM ? "checksum" : ( mode == CRCPolicy::SAMPLE ? "sample" : "skip" );
+}
+
+static bool expect( char const *what, CRCPolicy::Mode mode, CRCPolicy::Mode expected )
+{
+   if ( mode == expected ) return true;
+   cout << what << ": got " << modeName( mode ) << ", expected " << modeName( expected ) << endl;
+   return false;
+}
+
+int main ( int argc, char **argv )
+{
+   bool ok = true;
+   CRCPolicy policy;
+   policy.enable( 3.0f );
+
+   CopyData copies[2] = {
+      CopyData( (void *) smallBuffer, NANOS_SHARED, true, false, 1, smallDims ),
+      CopyData( (void *) largeBuffer, NANOS_SHARED, true, true, 1, largeDims )
+   };
+   WD *slow = new WD( new ext::SMPDD( longTask ), 0, 1, NULL, 2, copies );
+   WD *fast = new WD( new ext::SMPDD( shortTask ), 0, 1, NULL, 1, &copies[1] );
+   WD *cheap = new WD( new ext::SMPDD( cheapTask ), 0, 1, NULL, 1, &copies[0] );
+
+   // 1MB hashed in 100us
+   policy.hashed( LARGE, 100.0 );
+
+   // Every copy is protected until the task types have been measured
+   for ( int i = 0; i < 7; i++ ) {
+      policy.taskRan( *slow, 1000.0 );
+      policy.taskRan( *fast, 10.0 );
+      policy.taskRan( *cheap, 10.0 );
+   }
+   ok &= expect( "warm-up", policy.getMode( *fast, 0 ), CRCPolicy::CHECKSUM );
+   policy.taskRan( *slow, 1000.0 );
+   policy.taskRan( *fast, 10.0 );
+   policy.taskRan( *cheap, 10.0 );
+
+   // A 3% budget of 1000us is 30us: the small copy fits, the large one (100us) has to be sampled
+   ok &= expect( "small copy of a long task", policy.getMode( *slow, 0 ), CRCPolicy::CHECKSUM );
+   ok &= expect( "large copy of a long task", policy.getMode( *slow, 1 ), CRCPolicy::SAMPLE );
+   // A 3% budget of 10us only fits 0.3us of hashing
+   ok &= expect( "large copy of a short task", policy.getMode( *fast, 0 ), CRCPolicy::SKIP );
+   ok &= expect( "small copy of a short task", policy.getMode( *cheap, 0 ), CRCPolicy::CHECKSUM );
+
+   // Sampled copies are protected in some executions only, always the same ones
+   unsigned sampled = 0;
+   for ( unsigned id = 0; id < 1000; id++ ) {
+      slow->setId( id );
+      const bool protect = policy.protect( *slow, 1 );
+      if ( protect != policy.protect( *slow, 1 ) ) {
+         cout << "sampling is not deterministic" << endl;
+         ok = false;
+      }
+      if ( protect ) sampled++;
+      if ( !policy.protect( *slow, 0 ) || policy.protect( *fast, 0 ) ) {
+         cout << "checksum or skip decision not honored" << endl;
+         ok = false;
+      }
+   }
+   if ( sampled < 150 || sampled > 350 ) {
+      cout << "large copy protected in " << sampled << " executions out of 1000" << endl;
+      ok = false;
+   }
+
+   // Corruption found: the task type is protected completely again
+   policy.corrupted( *fast );
+   ok &= expect( "corrupted task type", policy.getMode( *fast, 0 ), CRCPolicy::CHECKSUM );
+   for ( int i = 0; i < 32; i++ )
+      policy.taskRan( *fast, 10.0 );
+   ok &= expect( "corrupted task type, later", policy.getMode( *fast, 0 ), CRCPolicy::CHECKSUM );
+
+   CRCPolicy::Stats stats;
+   policy.getStats( stats );
+   if ( stats.types != 3 ) {
+      cout << stats.types << " task types, expected 3" << endl;
+      ok = false;
+   }
+
+   delete slow;
+   delete fast;
+   delete cheap;
+
+   if ( !ok ) return 1;
+   cout << "CRC policy: OK" << endl;
+   return 0;
+}
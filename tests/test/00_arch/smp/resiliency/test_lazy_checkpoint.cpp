@@ -0,0 +1,142 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ test_ENV="NX_LAZY_CHECKPOINT=yes NX_TASK_RETRIALS=2"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <string.h>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include "backuplazycopy_decl.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define PAGE 4096
+#define NUM_PAGES 16
+// Not aligned: the first and last pages of the input are shared with other data
+#define OFFSET 100
+
+typedef struct {
+   unsigned char *input;
+   long *result;
+   int executions;
+} consume_args;
+
+static unsigned char data[( NUM_PAGES + 1 ) * PAGE] __attribute__(( aligned( PAGE ) ));
+static long result;
+
+static unsigned char value( size_t i )
+{
+   return (unsigned char) ( i * 7 + 3 );
+}
+
+// Try to write to an invalid address: SIGSEGV
+static void fail()
+{
+   volatile int *a = 0;
+   *a = 1;
+}
+
+static void consume( void *ptr )
+{
+   consume_args *args = (consume_args *) ptr;
+   args->executions++;
+
+   // The first execution corrupts part of its read-only input before failing
+   if ( args->executions == 1 ) {
+      memset( args->input + 3 * PAGE, 0, 4 * PAGE );
+      args->input[0] = 0;
+      fail();
+   }
+
+   long sum = 0;
+   for ( size_t i = 0; i < NUM_PAGES * PAGE; i++ )
+      sum += args->input[i] == value( i );
+   *args->result = sum;
+}
+
+static nanos_smp_args_t consume_device = { consume };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} consume_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(consume_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &consume_device } }
+};
+
+int main ( int argc, char **argv )
+{
+   unsigned char *input = data + OFFSET;
+   for ( size_t i = 0; i < NUM_PAGES * PAGE; i++ )
+      input[i] = value( i );
+
+   consume_args *args = NULL;
+   nanos_copy_data_t *copies = NULL;
+   nanos_region_dimension_internal_t *dimensions = NULL;
+   nanos_wd_t wd = NULL;
+   nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+   dyn_props.flags.is_recover = true;
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &consume_definition.base, &dyn_props, sizeof(consume_args),
+                                        (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+   args->input = input;
+   args->result = &result;
+   args->executions = 0;
+
+   dimensions[0].size = NUM_PAGES * PAGE;
+   dimensions[0].lower_bound = 0;
+   dimensions[0].accessed_length = NUM_PAGES * PAGE;
+   copies[0].address = input;
+   copies[0].sharing = NANOS_SHARED;
+   copies[0].flags.input = true;
+   copies[0].flags.output = false;
+   copies[0].dimension_count = 1;
+   copies[0].dimensions = dimensions;
+   copies[0].offset = 0;
+
+   NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   BackupLazyCopy::Stats stats;
+   BackupLazyCopy::getStats( stats );
+
+   bool error = false;
+   if ( result != NUM_PAGES * PAGE ) {
+      cout << "The input was not restored: " << NUM_PAGES * PAGE - result << " wrong bytes" << endl;
+      error = true;
+   }
+   // Only the written pages that are fully covered by the input are copied on write
+   if ( stats.inputs != 1 || stats.copiedPages != 5 ) {
+      cout << stats.inputs << " lazy backups, " << stats.copiedPages << " pages copied on write" << endl;
+      error = true;
+   }
+   // The input can be written again once the task is done
+   input[PAGE] = 0;
+
+   cout << "Lazy checkpoint: " << ( error ? "FAILED" : "OK" ) << endl;
+   return error ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ test_ENV="NX_TASK_REDUNDANCY=all"
+ </testinfo>
+ */
+
+#include <iostream>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define NUM_TASKS 8
+#define BLOCK_SIZE ( 64 * 1024 )
+//! This task updates its block through a child task
+#define NESTED_TASK ( NUM_TASKS - 1 )
+
+typedef struct {
+   unsigned char *output;
+   int task;
+} update_args;
+
+static unsigned char data[NUM_TASKS][BLOCK_SIZE];
+static int executions[NUM_TASKS];
+static nanos_wd_t runners[NUM_TASKS][3];  //!< WD seen by each execution
+static int childExecutions;
+
+static void update( void *ptr );
+static void child( void *ptr );
+
+static nanos_smp_args_t update_device = { update };
+static nanos_smp_args_t child_device = { child };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} update_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(update_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &update_device } }
+}, child_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(update_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &child_device } }
+};
+
+static void submit( nanos_const_wd_definition_t *definition, unsigned char *output, int task )
+{
+   update_args *args = NULL;
+   nanos_copy_data_t *copies = NULL;
+   nanos_region_dimension_internal_t *dimensions = NULL;
+   nanos_wd_t wd = NULL;
+   nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, definition, &dyn_props, sizeof(update_args),
+                                        (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+   args->output = output;
+   args->task = task;
+
+   dimensions[0].size = BLOCK_SIZE;
+   dimensions[0].lower_bound = 0;
+   dimensions[0].accessed_length = BLOCK_SIZE;
+   copies[0].address = output;
+   copies[0].sharing = NANOS_SHARED;
+   copies[0].flags.input = true;
+   copies[0].flags.output = true;
+   copies[0].dimension_count = 1;
+   copies[0].dimensions = dimensions;
+   copies[0].offset = 0;
+
+   NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+}
+
+static void child( void *ptr )
+{
+   update_args *args = (update_args *) ptr;
+
+   __sync_fetch_and_add( &childExecutions, 1 );
+   for ( size_t i = 0; i < BLOCK_SIZE; i++ )
+      args->output[i] += 1;
+}
+
+static void update( void *ptr )
+{
+   update_args *args = (update_args *) ptr;
+
+   const int execution = __sync_fetch_and_add( &executions[args->task], 1 );
+   if ( execution < 3 ) runners[args->task][execution] = nanos_current_wd();
+
+   // The replica waits for its own child, which updates the private buffer
+   if ( args->task == NESTED_TASK ) {
+      submit( &child_definition.base, args->output, args->task );
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+      return;
+   }
+
+   // The first execution of the first task computes a wrong result: the other two outvote it
+   const int increment = ( args->task == 0 && execution == 0 ) ? 2 : 1;
+
+   for ( size_t i = 0; i < BLOCK_SIZE; i++ )
+      args->output[i] += increment;
+}
+
+int main ( int argc, char **argv )
+{
+   for ( int b = 0; b < NUM_TASKS; b++ )
+      submit( &update_definition.base, data[b], b );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   bool error = false;
+   for ( int b = 0; b < NUM_TASKS && !error; b++ ) {
+      for ( size_t i = 0; i < BLOCK_SIZE && !error; i++ ) {
+         if ( data[b][i] != 1 ) {
+            cout << "Block " << b << " was updated by " << (int) data[b][i] << endl;
+            error = true;
+         }
+      }
+      if ( executions[b] != ( b == 0 ? 3 : 2 ) ) {
+         cout << "Task " << b << " was executed " << executions[b] << " times" << endl;
+         error = true;
+      }
+      if ( runners[b][0] == runners[b][1] || runners[b][0] == NULL || runners[b][1] == NULL ) {
+         cout << "The replica of task " << b << " did not run as a WD of its own" << endl;
+         error = true;
+      }
+   }
+
+   // Both children of the nested task are replicated in turn
+   if ( childExecutions != 4 ) {
+      cout << "The children of task " << NESTED_TASK << " were executed " << childExecutions << " times" << endl;
+      error = true;
+   }
+
+   RedundantExecution::Stats stats;
+   sys.getRedundancy().getStats( stats );
+   if ( stats.replicated != NUM_TASKS + 2 || stats.outvoted != 1 || stats.unresolved != 0 || stats.skipped != 0 ) {
+      cout << stats.replicated << " tasks replicated, " << stats.outvoted << " outvoted, " << stats.unresolved
+           << " unresolved, " << stats.skipped << " skipped" << endl;
+      error = true;
+   }
+
+   cout << "Redundant execution: " << ( error ? "FAILED" : "OK" ) << endl;
+   return error ? 1 : 0;
+}
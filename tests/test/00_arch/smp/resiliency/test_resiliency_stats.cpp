@@ -0,0 +1,153 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator="gens/resiliency-generator"
+ test_ENV="NX_TASK_RETRIALS=2"
+ </testinfo>
+ */
+
+#include <iostream>
+#include <string.h>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+
+using namespace std;
+using namespace nanos;
+
+#define NUM_TASKS 8
+#define BLOCK_SIZE ( 64 * 1024 )
+
+typedef struct {
+   unsigned char *input;
+   int executions;
+} update_args;
+
+static unsigned char data[NUM_TASKS][BLOCK_SIZE];
+
+// Try to write to an invalid address: SIGSEGV
+static void fail()
+{
+   volatile int * volatile a = 0;
+   *a = 1;
+}
+
+static void update( void *ptr )
+{
+   update_args *args = (update_args *) ptr;
+   args->executions++;
+
+   // The first execution of the first task fails: it is restored and run again
+   if ( args->input == data[0] && args->executions == 1 )
+      fail();
+
+   for ( size_t i = 0; i < BLOCK_SIZE; i++ )
+      args->input[i]++;
+}
+
+static nanos_smp_args_t update_device = { update };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} update_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(update_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &update_device } }
+};
+
+int main ( int argc, char **argv )
+{
+   for ( size_t b = 0; b < NUM_TASKS; b++ ) {
+      update_args *args = NULL;
+      nanos_copy_data_t *copies = NULL;
+      nanos_region_dimension_internal_t *dimensions = NULL;
+      nanos_wd_t wd = NULL;
+      nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+      dyn_props.flags.is_recover = true;
+
+      NANOS_SAFE( nanos_create_wd_compact( &wd, &update_definition.base, &dyn_props, sizeof(update_args),
+                                           (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+      args->input = data[b];
+      args->executions = 0;
+
+      dimensions[0].size = BLOCK_SIZE;
+      dimensions[0].lower_bound = 0;
+      dimensions[0].accessed_length = BLOCK_SIZE;
+      copies[0].address = data[b];
+      copies[0].sharing = NANOS_SHARED;
+      copies[0].flags.input = true;
+      copies[0].flags.output = true;
+      copies[0].dimension_count = 1;
+      copies[0].dimensions = dimensions;
+      copies[0].offset = 0;
+
+      NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+   }
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   bool error = false;
+   for ( size_t b = 0; b < NUM_TASKS && !error; b++ ) {
+      for ( size_t i = 0; i < BLOCK_SIZE && !error; i++ ) {
+         if ( data[b][i] != 1 ) {
+            cout << "Block " << b << " was updated " << (int) data[b][i] << " times" << endl;
+            error = true;
+         }
+      }
+   }
+
+   nanos_resiliency_stats_t total, type, thread;
+   NANOS_SAFE( nanos_resiliency_stats( &total, NULL, -1 ) );
+   NANOS_SAFE( nanos_resiliency_stats( &type, (void *) update, -1 ) );
+
+   // Every task backs up its block, and the failed one restores it and runs again
+   if ( total.bytes[NANOS_RESILIENCY_CHECKPOINT] < NUM_TASKS * BLOCK_SIZE
+        || total.bytes[NANOS_RESILIENCY_RESTORE] < BLOCK_SIZE
+        || total.count[NANOS_RESILIENCY_REEXECUTION] != 1 ) {
+      cout << total.bytes[NANOS_RESILIENCY_CHECKPOINT] << " bytes checkpointed, " << total.bytes[NANOS_RESILIENCY_RESTORE]
+           << " restored, " << total.count[NANOS_RESILIENCY_REEXECUTION] << " re-executions" << endl;
+      error = true;
+   }
+
+   // There is a single task type, and every operation is made by some thread
+   uint64_t threadBytes = 0;
+   for ( int id = 0; nanos_resiliency_stats( &thread, NULL, id ) == NANOS_OK; id++ )
+      threadBytes += thread.bytes[NANOS_RESILIENCY_CHECKPOINT];
+   NANOS_SAFE( nanos_resiliency_stats( &thread, NULL, NANOS_RESILIENCY_OTHER_THREADS ) );
+   threadBytes += thread.bytes[NANOS_RESILIENCY_CHECKPOINT];
+   for ( unsigned op = 0; op < NANOS_RESILIENCY_OPERATIONS; op++ ) {
+      if ( type.count[op] != total.count[op] || type.bytes[op] != total.bytes[op] ) {
+         cout << "Operation " << op << ": " << type.count[op] << " accounted in the task type, " << total.count[op] << " in total" << endl;
+         error = true;
+      }
+   }
+   if ( threadBytes != total.bytes[NANOS_RESILIENCY_CHECKPOINT] ) {
+      cout << threadBytes << " checkpoint bytes accounted in the threads, " << total.bytes[NANOS_RESILIENCY_CHECKPOINT] << " in total" << endl;
+      error = true;
+   }
+
+   if ( nanos_resiliency_stats( &total, (void *) update, 0 ) != NANOS_INVALID_PARAM ) {
+      cout << "Task types and threads can not be queried at once" << endl;
+      error = true;
+   }
+
+   cout << "Resiliency stats: " << ( error ? "FAILED" : "OK" ) << endl;
+   return error ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checking the object sizes and counters of the Allocator, with
+ * objects freed by the thread that allocated them and by another thread.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator"
+</testinfo>*/
+
+#include <iostream>
+#include <pthread.h>
+#include "allocator.hpp"
+
+using namespace nanos;
+
+#define OBJECTS 1000
+
+static void *objects[OBJECTS];
+
+static void * freeObjects ( void * )
+{
+   for ( int i = 0; i < OBJECTS; i++ ) Allocator::deallocate( objects[i] );
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   // Only the heap of this allocator is checked: runtime threads may be allocating from their own
+   Allocator my_allocator;
+   size_t sizes[] = { 1, 24, 100, 4000, 20000, 1<<20 };
+   for ( unsigned i = 0; i < sizeof(sizes)/sizeof(size_t); i++ ) {
+      void *ptr = my_allocator.allocate( sizes[i] );
+      if ( Allocator::getObjectSize( ptr ) < sizes[i] ) {
+         std::cout << "Object of " << sizes[i] << " bytes has only " << Allocator::getObjectSize( ptr ) << std::endl;
+         return -1;
+      }
+      Allocator::deallocate( ptr );
+   }
+
+   // Objects freed by another thread are reused by the owner
+   for ( int i = 0; i < OBJECTS; i++ ) objects[i] = my_allocator.allocate( 48 );
+   pthread_t thread;
+   pthread_create( &thread, NULL, freeObjects, NULL );
+   pthread_join( thread, NULL );
+   for ( int i = 0; i < OBJECTS; i++ ) objects[i] = my_allocator.allocate( 48 );
+   for ( int i = 0; i < OBJECTS; i++ ) Allocator::deallocate( objects[i] );
+
+   Allocator::Stats stats;
+   my_allocator.getHeapStats( stats );
+   if ( stats.allocations != 5 + 2 * OBJECTS ||
+        stats.remoteFrees != OBJECTS ||
+        stats.frees != 5 + OBJECTS ||
+        stats.bigObjects != 1 ) {
+      std::cout << "Wrong counters" << std::endl;
+      return -1;
+   }
+   return 0;
+}
@@ -0,0 +1,110 @@
+/*************************************************************************************/
+/*      Copyright 2016 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "crc/crc32c.hpp"
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace nanos;
+
+#define BUFFER_SIZE 8192
+
+static unsigned char buffer[BUFFER_SIZE + 64];
+
+/*! \brief Computes the reference CRC-32C of a buffer, one bit at a time. */
+static uint32_t referenceCrc ( uint32_t crc, unsigned char const* p, size_t length )
+{
+   for ( size_t i = 0; i < length; i++ ) {
+      crc ^= p[i];
+      for ( int k = 0; k < 8; k++ )
+         crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0x82F63B78 : crc >> 1;
+   }
+   return crc;
+}
+
+int main ( int argc, char **argv )
+{
+   bool error = false;
+
+   for ( size_t i = 0; i < sizeof(buffer); i++ )
+      buffer[i] = (unsigned char) rand();
+
+   for ( unsigned b = 0; b < crc::Crc32cEngine::getNumBackends(); b++ ) {
+      std::string name = crc::Crc32cEngine::getBackend(b).name;
+      if ( !crc::Crc32cEngine::select( name ) ) {
+         std::cout << name << ": not supported, skipping" << std::endl;
+         continue;
+      }
+
+      // Standard check value: crc32c("123456789")
+      uint32_t check = ~crc::Crc32cEngine::update( 0xFFFFFFFF, "123456789", 9 );
+      if ( check != 0xE3069283 ) {
+         std::cout << name << ": wrong check value " << std::hex << check << std::dec << std::endl;
+         error = true;
+      }
+
+      // Every length and alignment must match the reference implementation
+      for ( size_t offset = 0; offset < 8 && !error; offset++ ) {
+         for ( size_t length = 0; length <= BUFFER_SIZE && !error; length += ( length < 600 ? 1 : 61 ) ) {
+            uint32_t expected = referenceCrc( 0xFFFFFFFF, buffer + offset, length );
+            uint32_t computed = crc::Crc32cEngine::update( 0xFFFFFFFF, buffer + offset, length );
+            if ( expected != computed ) {
+               std::cout << name << ": mismatch at offset " << offset << ", length " << length << std::endl;
+               error = true;
+            }
+         }
+      }
+
+      // Streaming: splitting the message must not change the result
+      for ( size_t split = 0; split <= 300 && !error; split += 7 ) {
+         crc::Crc32c streamed;
+         streamed.update( buffer, split );
+         streamed.update( buffer + split, BUFFER_SIZE - split );
+         if ( streamed.finalize() != ~referenceCrc( 0xFFFFFFFF, buffer, BUFFER_SIZE ) ) {
+            std::cout << name << ": streaming mismatch at split " << split << std::endl;
+            error = true;
+         }
+      }
+      std::cout << name << ": " << ( error ? "FAILED" : "OK" ) << std::endl;
+   }
+
+   crc::Crc32cEngine::select( "auto" );
+
+   // Combining the CRCs of two pieces must match the CRC of the whole buffer
+   for ( size_t split = 0; split <= BUFFER_SIZE && !error; split += 509 ) {
+      uint32_t first = ~referenceCrc( 0xFFFFFFFF, buffer, split );
+      uint32_t second = ~referenceCrc( 0xFFFFFFFF, buffer + split, BUFFER_SIZE - split );
+      if ( crc::Crc32cEngine::combine( first, second, BUFFER_SIZE - split ) != ~referenceCrc( 0xFFFFFFFF, buffer, BUFFER_SIZE ) ) {
+         std::cout << "combine: mismatch at split " << split << std::endl;
+         error = true;
+      }
+   }
+
+   if ( error ) return 1;
+   return 0;
+}
@@ -0,0 +1,102 @@
+/*************************************************************************************/
+/*      Copyright 2016 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "lock.hpp"
+#include <iostream>
+#include <pthread.h>
+
+using namespace nanos;
+
+#define NUM_THREADS 4
+#define NUM_ITERS 20000
+
+static Lock lock;
+static volatile unsigned counter = 0;
+
+static void * increment ( void * )
+{
+   for ( unsigned i = 0; i < NUM_ITERS; i++ ) {
+      if ( i % 4 == 0 ) {
+         while ( !lock.tryAcquire() ) {}
+      } else {
+         lock.acquire();
+      }
+      // Not atomic: updates are lost if two threads hold the lock
+      counter = counter + 1;
+      lock.release();
+   }
+   return NULL;
+}
+
+int main ( int argc, char **argv )
+{
+   bool error = false;
+
+   if ( lock.getState() != NANOS_LOCK_FREE ) {
+      std::cout << "A new lock is not free" << std::endl;
+      error = true;
+   }
+   if ( !lock.tryAcquire() || lock.getState() != NANOS_LOCK_BUSY || lock.tryAcquire() ) {
+      std::cout << "tryAcquire does not take the lock once" << std::endl;
+      error = true;
+   }
+   lock.release();
+   if ( lock.getState() != NANOS_LOCK_FREE ) {
+      std::cout << "A released lock is not free" << std::endl;
+      error = true;
+   }
+
+   Lock busy( NANOS_LOCK_BUSY );
+   if ( busy.getState() != NANOS_LOCK_BUSY || busy.tryAcquire() ) {
+      std::cout << "A lock created busy is not held" << std::endl;
+      error = true;
+   }
+   busy.release();
+   if ( busy.getState() != NANOS_LOCK_FREE || !busy.tryAcquire() ) {
+      std::cout << "A lock created busy can not be taken after its release" << std::endl;
+      error = true;
+   }
+   busy.release();
+
+   pthread_t threads[NUM_THREADS];
+   for ( int i = 0; i < NUM_THREADS; i++ )
+      pthread_create( &threads[i], NULL, increment, NULL );
+   for ( int i = 0; i < NUM_THREADS; i++ )
+      pthread_join( threads[i], NULL );
+
+   if ( counter != NUM_THREADS * NUM_ITERS ) {
+      std::cout << "Counter is " << counter << " instead of " << NUM_THREADS * NUM_ITERS << std::endl;
+      error = true;
+   }
+
+   if ( error ) {
+      std::cout << "Lock test: ERROR" << std::endl;
+      return 1;
+   }
+   std::cout << "Lock test: OK" << std::endl;
+   return 0;
+}
@@ -0,0 +1,79 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "memory/softdirtytracker.hpp"
+#include <iostream>
+#include <vector>
+#include <sys/mman.h>
+
+using namespace nanos;
+using namespace nanos::memory;
+
+#define PAGES 8
+
+int main ( int argc, char **argv )
+{
+   SoftDirtyTracker tracker;
+   if ( !tracker.init() ) {
+      std::cout << "soft-dirty bits not supported, skipping" << std::endl;
+      return 0;
+   }
+
+   char *area = (char *) mmap( NULL, PAGES * MemoryPage::size(), PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0 );
+   for ( int i = 0; i < PAGES; i++ )
+      area[i * MemoryPage::size()] = 1;
+
+   const unsigned epoch = tracker.getEpoch();
+   tracker.clear();
+   if ( tracker.getEpoch() == epoch ) {
+      std::cout << "Error: clearing did not start a new epoch" << std::endl;
+      return 1;
+   }
+
+   // Write some pages, then check that only those are reported as dirty
+   area[1 * MemoryPage::size() + 10] = 2;
+   area[5 * MemoryPage::size()] = 2;
+
+   std::vector<bool> dirty;
+   if ( !tracker.getDirtyPages( MemoryChunk( Address( (uintptr_t) area ), PAGES * MemoryPage::size() ), dirty ) ) {
+      std::cout << "Error: could not read the soft-dirty bits" << std::endl;
+      return 1;
+   }
+   if ( dirty.size() != PAGES ) {
+      std::cout << "Error: expected " << PAGES << " pages, got " << dirty.size() << std::endl;
+      return 1;
+   }
+   for ( int i = 0; i < PAGES; i++ ) {
+      if ( dirty[i] != ( i == 1 || i == 5 ) ) {
+         std::cout << "Error: wrong soft-dirty bit for page " << i << std::endl;
+         return 1;
+      }
+   }
+
+   munmap( area, PAGES * MemoryPage::size() );
+   return 0;
+}
@@ -0,0 +1,125 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include "wddeque.hpp"
+#include <iostream>
+#include <pthread.h>
+
+using namespace nanos;
+
+#define NUM_THIEVES 3
+#define NUM_ITEMS 100000
+
+// The deque never dereferences its WDs: the address of each item stands for a WD
+static int items[NUM_ITEMS];
+static volatile int taken[NUM_ITEMS];
+
+static WDWorkStealingDeque *deque;
+static volatile bool finished = false;
+
+static WorkDescriptor * item ( int i ) { return (WorkDescriptor *) &items[i]; }
+
+static void take ( WorkDescriptor *wd )
+{
+   __sync_fetch_and_add( &taken[ (int *) wd - items ], 1 );
+}
+
+static void * thief ( void * )
+{
+   while ( !finished || !deque->empty() ) {
+      WorkDescriptor *wd = deque->steal();
+      if ( wd != NULL ) take( wd );
+   }
+   return NULL;
+}
+
+int main ( int argc, char **argv )
+{
+   bool error = false;
+
+   // Owner only: LIFO order, growing past the initial capacity
+   WDWorkStealingDeque small( 4 );
+   for ( int i = 0; i < 100; i++ )
+      small.push( item( i ) );
+   if ( small.size() != 100 ) {
+      std::cout << "Size is " << small.size() << " instead of 100 after growing" << std::endl;
+      error = true;
+   }
+   if ( small.steal() != item( 0 ) ) {
+      std::cout << "Steal does not take the oldest WD" << std::endl;
+      error = true;
+   }
+   for ( int i = 99; i > 0; i-- ) {
+      if ( small.pop() != item( i ) ) {
+         std::cout << "Pop does not return the last WD pushed (" << i << ")" << std::endl;
+         error = true;
+         break;
+      }
+   }
+   if ( small.pop() != NULL || small.steal() != NULL || !small.empty() ) {
+      std::cout << "An emptied deque still returns WDs" << std::endl;
+      error = true;
+   }
+
+   // The owner pushes and pops while the thieves steal: every WD must be taken exactly once
+   deque = new WDWorkStealingDeque( 16 );
+   pthread_t threads[NUM_THIEVES];
+   for ( int i = 0; i < NUM_THIEVES; i++ )
+      pthread_create( &threads[i], NULL, thief, NULL );
+
+   for ( int i = 0; i < NUM_ITEMS; i++ ) {
+      deque->push( item( i ) );
+      if ( i % 3 == 0 ) {
+         WorkDescriptor *wd = deque->pop();
+         if ( wd != NULL ) take( wd );
+      }
+   }
+   // A failed pop means a thief took the last WD
+   for ( WorkDescriptor *wd = deque->pop(); wd != NULL; wd = deque->pop() )
+      take( wd );
+   finished = true;
+
+   for ( int i = 0; i < NUM_THIEVES; i++ )
+      pthread_join( threads[i], NULL );
+
+   for ( int i = 0; i < NUM_ITEMS; i++ ) {
+      if ( taken[i] != 1 ) {
+         std::cout << "WD " << i << " was taken " << taken[i] << " times" << std::endl;
+         error = true;
+         break;
+      }
+   }
+   delete deque;
+
+   if ( error ) {
+      std::cout << "Work-stealing deque test: ERROR" << std::endl;
+      return 1;
+   }
+   std::cout << "Work-stealing deque test: OK" << std::endl;
+   return 0;
+}
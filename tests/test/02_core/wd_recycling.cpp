@@ -0,0 +1,118 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator -a \"--wd-recycling\""
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include <iostream>
+#include <string.h>
+
+#define NUM_ROUNDS    20
+#define NUM_TASKS     200
+
+int A[NUM_TASKS];
+int B[NUM_TASKS];
+
+typedef struct { int *p; int value; } small_data_t;
+typedef struct { int *p; int value; char payload[200]; } large_data_t;
+
+void small_task ( void *args );
+void large_task ( void *args );
+
+void small_task ( void *args )
+{
+   small_data_t *data = (small_data_t *) args;
+   *data->p += data->value;
+}
+
+void large_task ( void *args )
+{
+   large_data_t *data = (large_data_t *) args;
+   for ( unsigned i = 0; i < sizeof( data->payload ); i++ ) {
+      if ( data->payload[i] != (char) data->value ) return;
+   }
+   *data->p += data->value;
+}
+
+nanos_smp_args_t small_device_args = { small_task };
+nanos_smp_args_t large_device_args = { large_task };
+
+struct nanos_const_wd_definition_1
+{
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+};
+
+struct nanos_const_wd_definition_1 small_const = { { { true, false }, __alignof__( small_data_t ), 0, 1, 0, NULL },
+                                                   { { nanos_smp_factory, &small_device_args } } };
+struct nanos_const_wd_definition_1 large_const = { { { true, false }, __alignof__( large_data_t ), 0, 1, 0, NULL },
+                                                   { { nanos_smp_factory, &large_device_args } } };
+
+int main ( int argc, char **argv )
+{
+   nanos_wd_dyn_props_t dyn_props;
+   memset( &dyn_props, 0, sizeof( dyn_props ) );
+
+   // Tasks of both kinds are interleaved, so that their chunks are recycled at the same time
+   for ( int round = 0; round < NUM_ROUNDS; round++ ) {
+      for ( int i = 0; i < NUM_TASKS; i++ ) {
+         nanos_wd_t wd = NULL;
+         small_data_t *small = NULL;
+         NANOS_SAFE( nanos_create_wd_compact( &wd, &small_const.base, &dyn_props, sizeof( small_data_t ), (void **) &small,
+                                              nanos_current_wd(), NULL, NULL ) );
+         small->p = &A[i];
+         small->value = i;
+         NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+
+         wd = NULL;
+         large_data_t *large = NULL;
+         NANOS_SAFE( nanos_create_wd_compact( &wd, &large_const.base, &dyn_props, sizeof( large_data_t ), (void **) &large,
+                                              nanos_current_wd(), NULL, NULL ) );
+         large->p = &B[i];
+         large->value = i % 100;
+         memset( large->payload, i % 100, sizeof( large->payload ) );
+         NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+      }
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+      // The tasks of the first round have finished: the second one must have reused their chunks
+      if ( round == 1 ) {
+         nanos::WDRecycler::Stats stats;
+         nanos::sys.getWDRecycler().getStats( stats );
+         if ( stats.reused == 0 ) {
+            fprintf( stderr, "%s : no chunk reused in the second round\n", argv[0] );
+            return -1;
+         }
+      }
+   }
+
+   bool check = true;
+   for ( int i = 0; i < NUM_TASKS; i++ ) {
+      if ( A[i] != i * NUM_ROUNDS || B[i] != ( i % 100 ) * NUM_ROUNDS ) check = false;
+   }
+
+   fprintf( stderr, "%s : %s\n", argv[0], check ? "successful" : "unsuccessful" );
+   return check ? 0 : -1;
+}
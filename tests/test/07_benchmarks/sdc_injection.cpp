@@ -0,0 +1,202 @@
+/*************************************************************************************/
+/*      Copyright 2009 - 2016 Barcelona Supercomputing Center                        */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+ <testinfo>
+ test_generator='gens/resiliency-generator -m performance -a "--enable-crc --error-injection=bitflip --error-injection-seed=7"'
+ test_mode=performance
+ </testinfo>
+ */
+
+/*
+ * Silent data corruption benchmark.
+ *
+ * Every block of data is updated by a recoverable task that produces it (out)
+ * and then consumes it (in). The same updates are run three times:
+ *  1) without CRC protection (baseline),
+ *  2) with CRC protection and no errors (detection overhead),
+ *  3) with CRC protection, flipping a bit of one produced block out of
+ *     INJECTION_PERIOD before it is consumed (recovery cost).
+ * Bits are flipped by the error injection policy selected with
+ * --error-injection; only "bitflip" produces silent corruptions.
+ */
+
+#include <stdio.h>
+#include <sys/time.h>
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include "exception/failurestats.hpp"
+#include "error-injection/errorinjectioninterface.hpp"
+
+using namespace nanos;
+
+#define NUM_BLOCKS         32
+// Smaller than the CRC chunk size: outputs are hashed before successors run
+#define BLOCK_SIZE         ( 128 * 1024 )
+#define ITERATIONS         16
+#define INJECTION_PERIOD   8
+
+enum TaskKind { PRODUCE, CONSUME, UPDATE };
+
+typedef struct {
+   int kind;
+   unsigned block;
+   unsigned iteration;
+   bool inject;
+} update_args;
+
+static unsigned char data[NUM_BLOCKS][BLOCK_SIZE];
+static long results[NUM_BLOCKS];
+
+static void create_task( TaskKind kind, unsigned block, unsigned iteration, bool inject );
+
+static unsigned char value( unsigned block, unsigned iteration, size_t i )
+{
+   return (unsigned char) ( i * 31 + block * 7 + iteration );
+}
+
+static long expected( unsigned block, unsigned iteration )
+{
+   long sum = 0;
+   for ( size_t i = 0; i < BLOCK_SIZE; i++ ) sum += value( block, iteration, i );
+   return sum;
+}
+
+static void update( void *ptr )
+{
+   update_args *args = (update_args *) ptr;
+   unsigned char *block = data[args->block];
+
+   if ( args->kind == PRODUCE ) {
+      for ( size_t i = 0; i < BLOCK_SIZE; i++ ) block[i] = value( args->block, args->iteration, i );
+   } else if ( args->kind == CONSUME ) {
+      long sum = 0;
+      for ( size_t i = 0; i < BLOCK_SIZE; i++ ) sum += block[i];
+      results[args->block] = sum;
+   } else {
+      create_task( PRODUCE, args->block, args->iteration, false );
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+      // Only the first execution is corrupted: re-executions must fix the data
+      if ( args->inject ) {
+         args->inject = false;
+         error::ErrorInjectionInterface::injectError( block );
+      }
+      create_task( CONSUME, args->block, args->iteration, false );
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+   }
+}
+
+static nanos_smp_args_t update_device = { update };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} update_definition = {
+   { { true, false, false, false, false, false, false, false }, __alignof__(update_args), 1, 1, 1, NULL },
+   { { nanos_smp_factory, &update_device } }
+};
+
+static void create_task( TaskKind kind, unsigned block, unsigned iteration, bool inject )
+{
+   update_args *args = NULL;
+   nanos_copy_data_t *copies = NULL;
+   nanos_region_dimension_internal_t *dimensions = NULL;
+   nanos_wd_t wd = NULL;
+   nanos_wd_dyn_props_t dyn_props = nanos_wd_dyn_props_t();
+   dyn_props.flags.is_recover = true;
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &update_definition.base, &dyn_props, sizeof(update_args),
+                                        (void **) &args, nanos_current_wd(), &copies, &dimensions ) );
+   args->kind = kind;
+   args->block = block;
+   args->iteration = iteration;
+   args->inject = inject;
+
+   dimensions[0].size = BLOCK_SIZE;
+   dimensions[0].lower_bound = 0;
+   dimensions[0].accessed_length = BLOCK_SIZE;
+   copies[0].address = data[block];
+   copies[0].sharing = NANOS_SHARED;
+   copies[0].flags.input = kind != PRODUCE;
+   copies[0].flags.output = kind != CONSUME;
+   copies[0].dimension_count = 1;
+   copies[0].dimensions = dimensions;
+   copies[0].offset = 0;
+
+   NANOS_SAFE( nanos_submit( wd, 0, NULL, NULL ) );
+}
+
+static double get_usecs()
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return tv.tv_sec * 1.0e6 + tv.tv_usec;
+}
+
+//! Runs all the updates, returns the time per iteration (us) and the number of wrong results.
+static double run( bool inject, unsigned &wrong )
+{
+   wrong = 0;
+   double start = get_usecs();
+   for ( unsigned iteration = 0; iteration < ITERATIONS; iteration++ ) {
+      for ( unsigned block = 0; block < NUM_BLOCKS; block++ ) {
+         create_task( UPDATE, block, iteration, inject && ( iteration * NUM_BLOCKS + block ) % INJECTION_PERIOD == 0 );
+      }
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+      for ( unsigned block = 0; block < NUM_BLOCKS; block++ ) {
+         if ( results[block] != expected( block, iteration ) ) wrong++;
+      }
+   }
+   return ( get_usecs() - start ) / ITERATIONS;
+}
+
+int main ( int argc, char **argv )
+{
+   unsigned wrong;
+   const bool protect = sys._crc_enabled;
+
+   // Warm-up
+   run( false, wrong );
+
+   sys._crc_enabled = false;
+   const double baseline = run( false, wrong );
+   sys._crc_enabled = protect;
+   const double clean = run( false, wrong );
+
+   const unsigned injected = error::FailureStats<error::ErrorInjection>::get();
+   const unsigned detected = error::FailureStats<error::SilentDataCorruption>::get();
+   const unsigned reexecuted = error::FailureStats<error::TaskRecovery>::get();
+   const double corrupted = run( true, wrong );
+   const unsigned errors = error::FailureStats<error::ErrorInjection>::get() - injected;
+
+   printf( "SDC benchmark: %d blocks of %d bytes, %d iterations, injection policy \"%s\", CRC %s\n",
+           NUM_BLOCKS, BLOCK_SIZE, ITERATIONS, sys.getInjectionPolicy().c_str(), protect ? "enabled" : "disabled" );
+   printf( "   baseline:            %10.1f us/iteration\n", baseline );
+   printf( "   detection overhead:  %10.1f us/iteration (%.1f%%)\n", clean - baseline, 100.0 * ( clean - baseline ) / baseline );
+   printf( "   injected errors:     %10u\n", errors );
+   if ( errors > 0 ) {
+      printf( "   detected errors:     %10u\n", error::FailureStats<error::SilentDataCorruption>::get() - detected );
+      printf( "   recovery time:       %10.1f us/error\n", ( corrupted - clean ) * ITERATIONS / errors );
+      printf( "   tasks re-executed:   %10.2f per error\n", (double) ( error::FailureStats<error::TaskRecovery>::get() - reexecuted ) / errors );
+      printf( "   wrong results:       %10u\n", wrong );
+   }
+
+   return 0;
+}